@@ -31,6 +31,9 @@
 #define LW_CONFIRMED_UPLINKS 0
 // Port utilitzat per defecte per enviar uplinks a lorawan
 #define LW_DEFAULT_UPLINK_PORT 1
+// Temps que la ràdio queda en mode LoRaWAN per cada uplink (transmissió i les dues finestres de recepció), en ms.
+// Mentre dura, el node no pot rebre frames de la xarxa LoRa. Amb RX1 a 1 s i RX2 a 2 s (EU868), més la finestra de RX2
+#define LW_UPLINK_DEAF_MS 4000
 
 /* ======= */
 /*   MAC   */
@@ -40,20 +43,153 @@
 // ja que camp que indica reintents a PDU és de 2 bits (i per tant valor màxim 3)
 #define MAC_MAX_RETRIES 3
 
+// Repeticions cegues addicionals dels frames sense ACK (broadcast, i entrega sense garanties). 0 per enviar-los una única vegada
+// Igual que MAC_MAX_RETRIES, màxim 3 (s'indica al camp de reintents de la PDU)
+#define MAC_BROADCAST_REPEATS 0
+
 // Valor màxim de reintents de backoff (Backoff seguirà fent-se, però no augmentarà més, per evitar desbordar uint32 i temps excessiu)
 // Per valor de 10 s'obté un temps màxim aproximat de 100 segons (2^10*100/1000)
 #define MAC_MAX_BEB_RETRY 10
 
 // Slots de temps en ms per BEB. Per MAC_MAX_BEB_RETRY, el temps màxim serà MAC_BEB_SLOT_MS * 2^MAC_MAX_BEB_RETRY
-#define MAC_BEB_SLOT_MS 100 
+// Amb MAC_ADAPTIVE_CSMA no s'utilitza: el slot es calcula segons l'airtime
+#define MAC_BEB_SLOT_MS 100
+
+// CSMA adaptatiu: slot proporcional a l'airtime d'un ACK (segons SF, BW i CR), p-persistència segons
+// l'ocupació observada del canal, i finestra de contenció ajustada segons col·lisions (ACK no rebut).
+// Comentar per utilitzar BEB amb slot fix de MAC_BEB_SLOT_MS
+#define MAC_ADAPTIVE_CSMA
+
+// Mida del slot en nombre d'airtimes d'ACK
+#define MAC_CSMA_SLOT_FACTOR 1
+
+// Límits de la finestra de contenció, en slots. Es duplica amb cada col·lisió, i es divideix per 2 amb cada èxit
+#define MAC_CSMA_CW_MIN 4
+#define MAC_CSMA_CW_MAX 256
+
+// Probabilitat mínima de transmetre amb canal lliure, en %. Amb canal sempre ocupat, evita no transmetre mai
+#define MAC_CSMA_MIN_PERSISTENCE 20
+
+// Detecció virtual de portadora (NAV): en escoltar un frame de dades per un altre node, es considera el canal ocupat
+// fins al seu ACK, i no s'intenta transmetre (ni es fa CAD) fins llavors. Evita col·lisionar amb l'ACK d'un intercanvi
+// que el CAD no detecta (mentre el receptor el prepara). Comentar per utilitzar només CAD
+#define MAC_NAV
+
+// RTS/CTS per frames llargs: abans d'enviar un frame de dades de mida MAC_RTS_THRESHOLD o superior, s'envia un RTS curt
+// amb la seva mida, i les dades només s'envien si el receptor respon amb CTS. Els nodes que escolten l'RTS o el CTS (com
+// el node ocult a l'altra banda del receptor, que el CAD no detecta) reserven el canal (NAV) fins a l'ACK de les dades.
+// Així, una col·lisió només fa perdre l'RTS, i no tot el frame. Requereix MAC_NAV. No definir per enviar sempre directament
+// #define MAC_RTS_CTS
+
+// Mida mínima del frame de dades (headers inclosos) per enviar-lo amb RTS/CTS, en bytes. En frames curts, l'RTS/CTS costa
+// més que la col·lisió que evita. L'airtime perdut per col·lisions de cada enllaç (`MAC_getLinkStats`) permet ajustar-la
+#define MAC_RTS_THRESHOLD 100
+
+// Oportunitat de transmissió (TXOP): el node que obté el canal amb CSMA pot enviar-hi seguits fins a MAC_TXOP_MAX_FRAMES
+// frames de la cua (o durant MAC_TXOP_MAX_MS), separats només pel seu ACK, sense CAD ni backoff entre ells. El flag `more`
+// indica als veïns que en segueix un altre, i mantenen el NAV. Útil per nodes intermedis que buiden ràfegues cap al gateway.
+// Un reintent finalitza la TXOP. Requereix MAC_NAV, i no és compatible amb MAC_DUTY_CYCLE. No definir per competir per cada frame
+// #define MAC_TXOP
+
+// Nombre màxim de frames d'una TXOP, inclòs el primer
+#define MAC_TXOP_MAX_FRAMES 4
+
+// Durada màxima d'una TXOP, en ms. Un cop superada, no s'hi afegeixen més frames
+#define MAC_TXOP_MAX_MS 3000
+
+// Reenviament en pipeline per cadenes lineals: el temps es divideix en fases de la durada d'un intercanvi complet (frame
+// màxim i ACK), i cada node només inicia transmissions de dades a la fase que li correspon per la seva posició a la cadena
+// (hop % MAC_PIPELINE_PHASES). Així, nodes adjacents no competeixen, i els que estan a MAC_PIPELINE_PHASES salts transmeten
+// alhora. Una ràfega avança per la cadena a un salt per fase (prop d'1/3 de la capacitat d'un enllaç, en lloc de col·lapsar).
+// Cal establir-ne la referència de temps comuna i la posició (`MAC_setPipeline`); amb SLEEP_TDMA, ho fa l'aplicació de SLEEP
+// en rebre el SYNC. No definir per transmetre sempre que el canal estigui lliure
+// #define MAC_PIPELINE
+
+// Nombre de fases del pipeline. Amb abast d'un salt, un receptor rep interferència dels nodes a 2 salts: cal que
+// els nodes que transmeten alhora estiguin com a mínim a 3 salts
+#define MAC_PIPELINE_PHASES 3
+
+// Descart anticipat en recepció: primer es llegeix només el header del frame, i si no és per nosaltres (ni cal per ACK
+// implícit o RTS/CTS), es descarta sense transferir-ne les dades ni calcular-ne el CRC. El CRC de capa física garanteix
+// el header; se'n comprova també la coherència (adreces, mida). Continua alimentant el NAV i les estadístiques de veïns.
+// Comentar per llegir sempre els frames sencers
+#define MAC_EARLY_DISCARD
+
+// Qualitat d'enllaç als ACK: cada ACK porta l'RSSI i l'SNR amb què el receptor ha rebut el frame (2 bytes). L'emissor
+// la guarda per cada veí (`MAC_getLinkStats`), i així coneix la qualitat de l'enllaç d'anada, i no només la de tornada.
+// Els nodes sense l'opció també interpreten els ACK que la porten. No definir per enviar ACK sense dades
+// #define MAC_ACK_LINK_INFO
 
 // Factor de temps addicional per recepció d'ACK, en funció de time on air de la mida d'un ACK enviat (mida headers MAC)
 // Si factor és 5 i time on air és 1ms, el timeout serà de 5 ms (dues vegades el temps esperat, anada+tornada)
-// Inici de TOUT es genera després de realitzat la transmissió
+// Inici de TOUT es genera després de realitzat la transmissió (s'hi afegeix MAC_ACK_IFS_MS)
 #define MAC_ACK_TIMEOUT_FACTOR 3
 
-// Número d'IDs de frames anteriors rebuts guardats (per si cal enviar "ACK")
-#define MAC_QUEUE_SIZE 5
+// Temps entre la fi de la recepció d'un frame i l'inici de la transmissió del seu ACK (IFS), en ms.
+// Ha de superar el temps de processament del receptor i el canvi de TX a RX de l'emissor. Els ACK s'envien sense CAD
+#define MAC_ACK_IFS_MS 5
+
+// ACK implícit en cadenes lineals: si un frame rebut es reenvia de seguida (durant la mateixa recepció) cap a un altre node,
+// el reenviament porta l'ID del frame rebut i l'emissor anterior, que l'escolta, el pren com a ACK.
+// Els frames que la capa d'encaminament no reenviarà (destí final, sense ruta...) es reconeixen amb ACK explícit abans de
+// lliurar-los, amb el temps de resposta habitual; si el reenviament falla, l'ACK explícit surt tard. Estalvia una transmissió
+// per salt, a canvi d'allargar el timeout d'ACK. Tots els nodes de la xarxa l'han de tenir igual.
+// No definir per reconèixer sempre amb ACK explícit.
+// #define MAC_IMPLICIT_ACK
+
+// Marge addicional d'espera d'ACK quan el següent salt pot reconèixer amb el reenviament (processament i CSMA), en ms
+#define MAC_IMPLICIT_ACK_MARGIN_MS 100
+
+// Mida de la finestra de seqüències rebudes per cada veí (per detectar duplicats i tornar a enviar "ACK")
+// Màxim 32 (mida del bitmap). Frames més antics que la finestra es consideren nous (reinici de l'emissor)
+#define MAC_DEDUP_WINDOW 32
+
+// Nombre màxim de fragments en què es pot dividir un frame que no cap en un únic frame LoRa (fins a 15)
+// Amb 1 no es fragmenta mai, i la mida màxima de dades és la d'un únic frame
+// Amb més d'1, el camp de mida dels headers estàndard d'encaminament i transport passa a ocupar 2 bytes (incompatible
+// amb nodes sense fragmentació), i cada frame de la cua de RX reserva MAC_FRAG_MAX_FRAGMENTS frames de dades.
+// Tots els nodes de la xarxa l'han de tenir igual
+#define MAC_FRAG_MAX_FRAGMENTS 1
+
+// Nombre de frames fragmentats que es poden reassemblar simultàniament (de qualsevol emissor)
+// Cada un reserva, mentre dura, fins a MAC_FRAG_MAX_FRAGMENTS fragments de memòria
+#define MAC_FRAG_POOL_SIZE 2
+
+// Temps màxim sense rebre cap fragment d'un frame en reassemblatge abans de descartar-lo, en ms
+#define MAC_FRAG_TIMEOUT_MS 10000
+
+// Gestió activa de la cua de TX (CoDel): si el temps que els frames esperen a la cua supera l'objectiu durant tot
+// un interval, se'n descarten (notificant `MAC_onTxDropped()`) per mantenir la latència acotada. Descarta frames que sense AQM
+// s'entregarien: l'objectiu s'ha d'ajustar a l'airtime de la configuració LoRa abans d'activar-lo.
+// No definir per no descartar-ne mai
+// #define MAC_AQM
+
+// Temps objectiu d'espera a la cua de TX, en ms. Ha de permetre uns quants intercanvis complets (amb reintents):
+// amb SF alts (10-12), uns quants frames a la cua amb reintents ja superen els 5 s
+#define MAC_AQM_TARGET_MS 5000
+
+// Interval d'observació, en ms. De l'ordre del temps de reacció de capes superiors (TRANSPORT_RETRY_DELAY)
+#define MAC_AQM_INTERVAL_MS 10000
+
+// Fallada ràpida cap a veïns inaccessibles: després de MAC_FAST_FAIL_THRESHOLD frames seguits que esgoten reintents cap a
+// un veí, es marca com a inaccessible, i els frames que s'hi envien fallen immediatament (`MAC_ERR_UNREACHABLE`, o `onTxFailed`
+// si ja eren a la cua) en lloc de recórrer tots els reintents. Se li envia un sondeig cada MAC_PROBE_INTERVAL_MS, i qualsevol
+// frame rebut del veí el torna a marcar com a accessible. Comentar per intentar sempre cada frame
+#define MAC_FAST_FAIL
+
+// Frames seguits sense ACK (després de tots els reintents) per marcar un veí com a inaccessible
+#define MAC_FAST_FAIL_THRESHOLD 3
+
+// Interval entre sondejos a veïns inaccessibles, en ms. Amb diversos veïns inaccessibles, se'n sondeja un a cada interval
+#define MAC_PROBE_INTERVAL_MS 30000
+
+// Avís d'indisponibilitat: abans d'un uplink LoRaWAN, el gateway envia en broadcast un frame de control amb el temps que no
+// podrà rebre (LW_UPLINK_DEAF_MS), i els veïns ajornen fins llavors els frames que li envien, sense consumir-ne reintents.
+// Els avisos rebuts es respecten sempre. Comentar per no enviar-ne
+#define MAC_DEAF_NOTICE
+
+// Resolució del temps d'indisponibilitat a l'avís (un byte), en ms. Es pot anunciar fins a 255 unitats
+#define MAC_DEAF_UNIT_MS 100
 
 // Polinomi per CRC8 (x^8+x^2+1). 
 #define MAC_CRC8_POLY 0x07
@@ -68,6 +204,79 @@
 // TTL per a cada paquet. Es descarta si arriba a 0.
 #define ROUTING_MAX_TTL 5
 
+// Registres de canvis de la taula de rutes que s'acumulen al diari de NVS abans de compactar-los a la còpia sencera.
+// Cada canvi és una única escriptura petita; la compactació reescriu tota la taula
+#define ROUTING_TABLE_JOURNAL_SIZE 32
+
+// Rutes per rang (i ruta per defecte) que pot tenir la taula de rutes
+#define ROUTING_TABLE_MAX_RANGES 8
+
+// Salts alternatius per destí, i destins que en poden tenir
+#define ROUTING_TABLE_MAX_BACKUPS 2
+#define ROUTING_TABLE_MAX_BACKUP_ROUTES 16
+
+// Failover als salts alternatius: quan MAC no pot entregar un paquet al següent salt, s'envia de nou pel següent
+// alternatiu de la ruta, i el salt que ha fallat passa per darrere dels alternatius durant ROUTING_FAILOVER_COOLDOWN_MS.
+// Només afecta destins amb salts alternatius. No definir per notificar directament l'error
+#define ROUTING_FAILOVER
+
+// Temps que un salt que ha fallat queda per darrere dels alternatius, en ms
+#define ROUTING_FAILOVER_COOLDOWN_MS 60000
+
+// Salts que poden estar degradats alhora (si n'hi ha més, es substitueix el que acaba abans)
+#define ROUTING_FAILOVER_MAX_DEMOTED 8
+
+// Paquets enviats per MAC a destins amb alternatius que es guarden per reenviar-los si fallen. Cadascun ocupa un routing_pdu_t
+#define ROUTING_FAILOVER_PENDING 4
+
+// Aprenentatge de rutes per vector de distàncies: cada node anuncia periòdicament en broadcast les seves rutes, i
+// cada veí instal·la a la taula de rutes (`RoutingTable_updateRoute()`) el veí amb menor ETX fins a cada destí.
+// Les rutes apreses substitueixen les estàtiques del mateix destí. Tots els nodes l'han de tenir igual.
+// No definir per utilitzar només les rutes configurades
+// #define ROUTING_DV
+
+// Interval entre anuncis de rutes, en ms. S'hi afegeix fins a un 25% aleatori
+#define ROUTING_DV_INTERVAL_MS 60000
+
+// Temps sense notícies del camí actual a partir del qual es considera inaccessible, i es canvia pel primer alternatiu, en ms
+#define ROUTING_DV_ROUTE_TIMEOUT_MS (4 * ROUTING_DV_INTERVAL_MS)
+
+// Millora mínima d'ETX per canviar de següent salt, per evitar oscil·lacions: en 1/8 de transmissió, i en % del cost actual
+#define ROUTING_DV_HYSTERESIS 8
+#define ROUTING_DV_HYSTERESIS_PERCENT 25
+
+// Cost màxim d'un camí, en transmissions (ETX). Per sobre, el destí es considera inaccessible: com més baix, abans es
+// trenquen els bucles de rutes després d'una fallada, però ha de superar el cost del camí vàlid més llarg, també en
+// arrencar (ETX inicial de 4 per enllaç). Fins a 31; amb menys, una línia de 20 nodes triga més a convergir (tests/simulacioDV)
+#define ROUTING_DV_MAX_ETX 31
+
+// Destins i veïns que es poden aprendre
+#define ROUTING_DV_MAX_ROUTES 32
+#define ROUTING_DV_MAX_NEIGHBORS 8
+
+// Codificació de xarxa (XOR) als nodes intermedis: dos paquets a reenviar en sentits contraris (A cap a la dreta, B cap a
+// l'esquerra) s'envien en un únic broadcast A xor B, i cada veí el descodifica amb el paquet que va enviar.
+// Els paquets a reenviar esperen a la cua de codificació mentre MAC està ocupada. Tots els nodes l'han de tenir igual.
+// El paquet codificat s'envia en broadcast (sense ACK de MAC). No definir per reenviar sempre per separat
+// #define ROUTING_NETWORK_CODING
+
+// Paquets a reenviar que poden esperar a la cua de codificació
+#define ROUTING_NC_QUEUE_SIZE 4
+
+// Paquets enviats que es retenen per poder descodificar paquets codificats
+#define ROUTING_NC_RETAIN_SIZE 4
+
+// Interval per tornar a comprovar si MAC ja és lliure per enviar la cua de codificació, en ms
+#define ROUTING_NC_FLUSH_RETRY_MS 500
+
+// Reenviament directe (cut-through): els paquets per altres nodes es reenvien des de la recepció a MAC, reescrivint el
+// TTL (i les adreces omeses) a la PDU rebuda, sense passar per la cua de RX ni tornar-los a serialitzar (sí que es copien
+// a la cua de TX).
+// Els paquets cap a LoRaWAN o a destins amb salts alternatius (ROUTING_FAILOVER) segueixen el camí normal.
+// S'ignora amb ROUTING_NETWORK_CODING (els paquets a reenviar han d'esperar a la cua de codificació).
+// No definir per reenviar sempre des de capa d'encaminament
+#define ROUTING_CUT_THROUGH
+
 /* ============= */
 /*   TRANSPORT   */
 /* ============= */
@@ -115,6 +324,15 @@
 // Es recomana que sigui major per facilitar la tasca d'afegir-ne de nous, i evitar haver de programar-los tots de nou
 #define SLEEP_QUANTITAT_DISPOSITIUS 5
 
+// Mode TDMA: cada node reenvia el SYNC dins d'un slot propi, segons la seva posició a la cadena (hop index),
+// sense CAD ni backoff. Cada node només es desperta per rebre el slot de l'anterior, amb una guarda segons
+// l'error de sincronització mesurat, en lloc d'esperar el pitjor cas de tots els nodes anteriors.
+// No definir per utilitzar CSMA durant tot el cicle actiu.
+// #define SLEEP_TDMA
+
+// Guarda mínima de cada slot TDMA, en `ms`. S'amplia fins al doble de l'error de sincronització mesurat
+#define SLEEP_TDMA_MIN_GUARD_MS 50
+
 /* =========== */
 /*   GENERAL   */
 /* =========== */
@@ -126,4 +344,9 @@
 // Especifica si té capacitats LoRaWAN (extensió de gateway)
 #define IS_GATEWAY false  
 
+// Format compacte de headers (MAC, encaminament i transport): elimina camps de mida redundants,
+// empaqueta TTL i omet adreces que coincideixen amb les de MAC. Tots els nodes d'una xarxa l'han de tenir igual.
+// No definir per utilitzar el format estàndard.
+// #define COMPACT_HEADERS
+
 #endif
@@ -23,8 +23,30 @@ void LoRaRAW_deinit();
 /// @brief Envia dades a través de LoRa en mode RAW.
 /// @param data Dades a enviar
 /// @param length Longitud de les dades
+/// @param checkChannel Si cal comprovar que el canal està lliure (CAD) abans d'enviar
 /// @return lora_tx_error_t amb estat de transmissió
-lora_tx_error_t LoRaRAW_send(const lora_data_t data, size_t length); 
+lora_tx_error_t LoRaRAW_send(const lora_data_t data, size_t length, bool checkChannel = true); 
+
+/// @brief Envia dades immediatament, sense CAD ni traces. Per respostes dins d'un intercanvi que ja reserva el canal (ACK)
+/// @param data Dades a enviar
+/// @param length Longitud de les dades
+/// @return lora_tx_error_t amb estat de transmissió
+lora_tx_error_t LoRaRAW_sendImmediate(const lora_data_t data, size_t length);
+
+/// @brief Obté l'instant en què ha finalitzat l'última recepció (RxDone)
+/// @return Instant de fi de recepció, en `us` (`micros()`)
+unsigned long LoRaRAW_getLastRxTime();
+
+/// @brief Obté només els primers bytes de l'última recepció, sense transferir-ne la resta ni reiniciar la recepció.
+/// Després, cal obtenir-la sencera amb `LoRaRAW_receive()`, o descartar-la amb `LoRaRAW_discard()`
+/// @param data Apuntador a l'espai on guardar els bytes llegits
+/// @param maxLength Bytes a llegir, com a màxim
+/// @param length Apuntador a la longitud total de les dades rebudes
+/// @return `false` si no s'han pogut llegir (error de CRC de capa física, inclòs); llavors, la recepció ja es reinicia
+bool LoRaRAW_receiveHeader(uint8_t* data, size_t maxLength, size_t* length);
+
+/// @brief Descarta l'última recepció sense llegir-la sencera, tornant a recepció
+void LoRaRAW_discard();
 
 /// @brief Obté les últimes dades rebudes per lora
 /// @param data Apuntador a l'espai on guardar les dades rebudes
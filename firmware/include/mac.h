@@ -16,12 +16,35 @@
 #define MAC_ADDRESS_SIZE 1  // bytes per cada adreça
 #define MAC_CRC_SIZE 1      // bytes per FEC
 #define MAC_FLAGS_SIZE 1    // bytes per flags
+#ifdef COMPACT_HEADERS
+#define MAC_LENGTH_FIELD_SIZE 0 // La mida de dades es dedueix de la mida del frame LoRa
+#define MAC_ACK_ID_SIZE 1       // Els ACK només porten el byte baix de l'ID que reconeixen
+#else
 #define MAC_LENGTH_FIELD_SIZE 1
+#define MAC_ACK_ID_SIZE MAC_ID_SIZE
+#endif
 #define MAC_PDU_HEADER_SIZE (2*MAC_ADDRESS_SIZE + MAC_ID_SIZE + MAC_CRC_SIZE + MAC_FLAGS_SIZE + MAC_LENGTH_FIELD_SIZE)
-#define MAC_MAX_DATA_SIZE LORA_MAX_SIZE - MAC_PDU_HEADER_SIZE // @tx + @rx + crc + id + flags + lengthField
+#define MAC_ACK_SIZE (2*MAC_ADDRESS_SIZE + MAC_ACK_ID_SIZE + MAC_CRC_SIZE + MAC_FLAGS_SIZE + MAC_LENGTH_FIELD_SIZE) // Mida total d'un ACK
+#ifdef MAC_ACK_LINK_INFO
+#define MAC_ACK_LINK_INFO_SIZE 2 // RSSI i SNR (`mac_link_info_t`), al final de les dades de l'ACK
+#else
+#define MAC_ACK_LINK_INFO_SIZE 0
+#endif
+#define MAC_ACK_FRAME_SIZE (MAC_ACK_SIZE + MAC_ACK_LINK_INFO_SIZE) // Mida dels ACK enviats (de frames no fragmentats)
+#define MAC_MAX_FRAME_DATA_SIZE (LORA_MAX_SIZE - MAC_PDU_HEADER_SIZE) // Dades que caben en un únic frame LoRa
+
+// Fragmentació: cada fragment porta, al principi de les dades, un byte amb índex i nombre de fragments
+#define MAC_FRAG_HEADER_SIZE 1
+#define MAC_FRAG_DATA_SIZE (MAC_MAX_FRAME_DATA_SIZE - MAC_FRAG_HEADER_SIZE)
+#if MAC_FRAG_MAX_FRAGMENTS > 1
+#define MAC_MAX_DATA_SIZE (MAC_FRAG_MAX_FRAGMENTS * MAC_FRAG_DATA_SIZE)
+#else
+#define MAC_MAX_DATA_SIZE MAC_MAX_FRAME_DATA_SIZE
+#endif
 
 typedef uint8_t mac_crc_t;
 typedef uint16_t mac_id_t;
+typedef uint8_t mac_frame_data_t[MAC_MAX_FRAME_DATA_SIZE];
 typedef uint8_t mac_data_t[MAC_MAX_DATA_SIZE];
 
 
@@ -29,21 +52,117 @@ typedef uint8_t mac_data_t[MAC_MAX_DATA_SIZE];
 typedef struct {
     uint8_t isACK : 1;    // 0 = Data, 1 = ACK
     uint8_t retry : 2;    // Valor reintents (0-3)
+    uint8_t frag : 1;     // 1 = Fragment (primer byte de dades és `mac_frag_header_t`). En ACK, reconeix un fragment
+    uint8_t implicitAck : 1; // 1 = Frame que també reconeix (ACK implícit) el frame `ackedId` rebut de l'anterior node
+    uint8_t noAck : 1;    // 1 = Entrega sense garanties: no es reconeix amb ACK ni es reintenta (només repeticions cegues).
+                          // En ACK, 1 = porta la qualitat d'enllaç (`mac_link_info_t`) al final de les dades
+    uint8_t ctrl : 1;     // 1 = Frame de control (primer byte de dades és `mac_ctrl_type_t`). No es lliura a capa superior
+    uint8_t more : 1;     // 1 = Després de l'ACK, l'emissor enviarà un altre frame sense competir pel canal (TXOP)
     // uint8_t priority : 1; // Prioritat
-    // uint8_t frag : 1;     // 1 = Fragmentat
-    uint8_t reserved : 5; // Reservat ús futur i ocupar tot el byte
+    // Els nodes anteriors a `frag`..`more` els envien (reservats) tots a 1: en rebre'ls, es llegeixen a 0 (`_parseHeader`)
 } mac_pdu_flags_t;
 
+// Header d'un fragment. Tots els fragments d'un frame comparteixen ID
+typedef struct {
+    uint8_t index : 4;    // Índex del fragment (0 a count-1)
+    uint8_t count : 4;    // Nombre total de fragments del frame
+} mac_frag_header_t;
+
+// Qualitat amb què el receptor ha rebut un frame, que retorna a l'ACK
+typedef struct {
+    int8_t rssi;        // dBm
+    int8_t snr;         // dB
+} mac_link_info_t;
+
+// Frames de control: [TYPE|ARG]. Porten l'ID del frame de dades al qual fan referència
+#define MAC_CTRL_HEADER_SIZE 2
+#define MAC_CTRL_SIZE (MAC_PDU_HEADER_SIZE + MAC_CTRL_HEADER_SIZE) // Mida total d'un frame de control
+
+enum mac_ctrl_type_t : uint8_t {
+    MAC_CTRL_RTS = 1,   // Sol·licitud d'enviament. ARG: mida total del frame de dades
+    MAC_CTRL_CTS = 2,   // Resposta a l'RTS: el canal queda reservat per les dades. ARG: mida total del frame de dades
+    MAC_CTRL_PROBE = 3, // Sondeig a un veí inaccessible (MAC_FAST_FAIL). ARG: 0
+    MAC_CTRL_PROBE_REPLY = 4, // Resposta al sondeig, com un ACK. ARG: 0
+    MAC_CTRL_DEAF = 5,  // Avís en broadcast: l'emissor no pot rebre durant un temps. ARG: durada, en unitats de MAC_DEAF_UNIT_MS
+};
+
 typedef struct {
     node_address_t tx;
     node_address_t rx;
     mac_id_t id;
     mac_pdu_flags_t flags;
+    mac_id_t ackedId;   // ID del frame que es reconeix implícitament (només amb `flags.implicitAck`; s'envien MAC_ACK_ID_SIZE bytes)
     uint8_t dataLength; // Mida de dades. No podem utilitzar el '\0' com a separador, ja que potser capes superiors l'utilitzen al header o en mig de dades
-    mac_data_t data; // potser uint8_t data[MAC_MAX_DATA_SIZE+1];, per deixar de marge el caràcter final '\0' -> Ja no si tenim datalength
+    mac_frame_data_t data; // potser uint8_t data[MAC_MAX_DATA_SIZE+1];, per deixar de marge el caràcter final '\0' -> Ja no si tenim datalength
     mac_crc_t crc;
 } mac_pdu_t;
 
+// Frame complet rebut (un cop reassemblat, si anava fragmentat), pendent de lliurar a capa superior
+typedef struct {
+    node_address_t tx;
+    bool noAck;         // Si s'ha rebut sense ACK (entrega sense garanties)
+    uint16_t dataLength;
+    mac_data_t data;
+} mac_sdu_t;
+
+
+// Estadístiques de la capa MAC, per mesurar funcionament
+typedef struct {
+    uint32_t CRCErrors;
+    uint32_t failedTransmissions;
+    uint32_t succeededTransmissions;
+    uint32_t framesReceived;
+    uint32_t duplicates;        // Frames repetits descartats (l'emissor no havia rebut ACK)
+    uint32_t outOfWindow;       // Seqüències fora de finestra de duplicats (re-sincronitzacions)
+    uint32_t txFrames;          // Frames enviats per LoRa (dades, reintents i ACK)
+    uint32_t txBytes;           // Bytes enviats per LoRa (headers inclosos). Permet comparar formats de header
+    uint32_t fragmentsReceived; // Fragments nous rebuts
+    uint32_t reassembled;       // Frames fragmentats reassemblats correctament
+    uint32_t reassemblyTimeouts;// Reassemblatges descartats per no rebre tots els fragments a temps
+    uint32_t reassemblyDrops;   // Fragments descartats per no tenir espai de reassemblatge
+    uint32_t implicitAcksSent;  // Frames reconeguts amb el reenviament, sense ACK explícit
+    uint32_t implicitAcksReceived; // Frames propis reconeguts en escoltar-ne el reenviament
+    uint32_t acksSent;          // ACK explícits enviats
+    uint32_t acksLate;          // ACK enviats més tard de MAC_ACK_IFS_MS (processament massa llarg)
+    uint32_t ackTurnaroundMinUs;// Temps mínim entre fi de recepció i inici de transmissió d'ACK, en us
+    uint32_t ackTurnaroundMaxUs;// Temps màxim entre fi de recepció i inici de transmissió d'ACK, en us
+    uint64_t ackTurnaroundSumUs;// Suma dels temps de resposta, per obtenir-ne la mitjana amb `acksSent`
+    uint32_t rtsSent;           // RTS enviats
+    uint32_t ctsSent;           // CTS enviats en resposta a RTS
+    uint32_t ctsWithheld;       // RTS no respostos per tenir el canal reservat per un altre intercanvi
+    uint32_t txopBursts;        // TXOP amb més d'un frame
+    uint32_t txopFrames;        // Frames enviats dins d'una TXOP sense competir pel canal (sense comptar el primer)
+    uint32_t pipelineDeferrals; // Transmissions ajornades fins a la fase pròpia del pipeline
+    uint32_t earlyDiscards;     // Frames per altres nodes descartats només amb el header
+    uint32_t earlyDiscardBytes; // Bytes que no s'han hagut de transferir de la ràdio pels descarts anticipats
+    uint32_t neighborsDown;     // Veïns marcats com a inaccessibles
+    uint32_t neighborsUp;       // Veïns inaccessibles que s'han tornat a escoltar
+    uint32_t unreachableFails;  // Frames fallats immediatament per anar a un veí inaccessible
+    uint32_t probesSent;        // Sondejos enviats a veïns inaccessibles
+    uint32_t probeRepliesSent;  // Respostes a sondejos d'altres nodes
+    uint32_t deafNoticesSent;   // Avisos d'indisponibilitat enviats
+    uint32_t deafNoticesReceived; // Avisos d'indisponibilitat de veïns rebuts
+    uint32_t deafDeferrals;     // Transmissions ajornades per tenir el receptor indisponible
+    uint32_t deafRetriesSaved;  // Intents que quedaven als frames ajornats (els que s'haurien consumit sense l'avís)
+    uint32_t cutThroughFrames;  // Frames reenviats directament a la cua de TX, sense passar per capa superior (`MAC_onForward()`)
+    uint64_t cutThroughSumUs;   // Temps de processament dels reenviaments directes, des de la recepció fins a la cua de TX, en us
+    uint32_t deliveredFrames;   // Frames de dades (no fragmentats) lliurats a capa superior
+    uint64_t deliverySumUs;     // Temps de lliurament a capa superior, inclòs el reenviament que hi faci en notificar-la, en us
+} mac_stats_t;
+
+// Estadístiques d'un enllaç cap a un veí (com a emissor), per veure on hi ha col·lisions i si l'RTS/CTS hi compensa
+typedef struct {
+    uint32_t txAttempts;        // Intents d'enviar-hi dades amb ACK (amb RTS o directament)
+    uint32_t txNoAck;           // Intents sense ACK o sense CTS (col·lisió probable)
+    uint32_t rtsSent;           // Intents fets amb RTS
+    uint32_t ctsTimeouts;       // RTS sense resposta
+    uint32_t lostAirtimeMs;     // Airtime dels frames (dades o RTS) que no han obtingut resposta, en ms
+    bool hasForwardQuality;     // Si s'ha rebut algun ACK amb qualitat d'enllaç
+    mac_link_info_t forward;    // Qualitat de l'enllaç d'anada, mesurada pel veí (últim ACK que la portava)
+    mac_link_info_t reverse;    // Qualitat de l'enllaç de tornada, mesurada a l'últim frame rebut del veí
+    uint8_t consecutiveFails;   // Frames seguits que han esgotat reintents sense ACK
+    bool unreachable;           // Marcat com a inaccessible (MAC_FAST_FAIL): els frames hi fallen immediatament
+} mac_link_stats_t;
 
 enum mac_err_t{
     MAC_SUCCESS,
@@ -51,7 +170,8 @@ enum mac_err_t{
     MAC_ERR_INVALID_ADDR,
     MAC_ERR_MAX_RETRIES,
     MAC_ERR_MAX_LENGTH,
-    MAC_ERR_TX_PENDING
+    MAC_ERR_TX_PENDING,
+    MAC_ERR_UNREACHABLE     // El receptor està marcat com a inaccessible (MAC_FAST_FAIL)
 };
 
 
@@ -60,6 +180,11 @@ typedef void (*mac_rx_callback_t)();
 // ja que així no cal incloure mac; es queda fixat a 16 bits, i si mai es modifica mida de mac_id_t
 // no hauria de suposar un problema si es veu aquest identificador com un de diferent
 typedef void (*mac_tx_callback_t)(uint16_t); 
+// Reenviament directe d'un frame rebut: capa superior n'examina les dades i, si són per un altre node, les reescriu
+// al mateix buffer i retorna el següent salt. Retorna `NODE_ADDRESS_NULL` (sense modificar-les) per lliurar-lo normalment
+typedef node_address_t (*mac_forward_callback_t)(uint8_t* data, size_t* length, size_t maxLength, node_address_t tx);
+// Indica si capa superior reenviarà a un altre node un frame rebut en lliurar-lo, sense modificar-ne les dades
+typedef bool (*mac_transit_callback_t)(const uint8_t* data, size_t length, node_address_t tx);
 
 /// @brief Inicialitza la capa MAC. Ja inicialtiza automàticament capes inferiors
 /// @param selfAddr Adreça del node que s'està inicialitzant. Ha de ser única a la xarxa
@@ -70,17 +195,21 @@ bool MAC_init(node_address_t selfAddr);
 void MAC_deinit();
 
 /// @brief Envia dades a través de la capa MAC
-/// @param rx Adreça del node receptor. 
+/// @param rx Adreça del node receptor. Si és `NODE_ADDRESS_BROADCAST`, l'envia a tots els veïns sense esperar ACK
 /// @param data Dades a enviar
-/// @param length Longitud de les dades a enviar
+/// @param length Longitud de les dades a enviar. Si supera `MAC_MAX_FRAME_DATA_SIZE`, s'envia fragmentat
 /// @param ID Identificador del frame enviat. Si és `nullptr`, no es retorna cap ID
-mac_err_t MAC_send(node_address_t rx, const mac_data_t data, size_t length, uint16_t* ID = nullptr);
+/// @param noAck Entrega sense garanties: el receptor no envia ACK, i s'envia un únic cop (més MAC_BROADCAST_REPEATS repeticions cegues).
+/// La transmissió es dona per completada en acabar d'enviar-lo
+/// @return `MAC_ERR_UNREACHABLE` si el receptor està marcat com a inaccessible (no s'afegeix a la cua)
+mac_err_t MAC_send(node_address_t rx, const mac_data_t data, size_t length, uint16_t* ID = nullptr, bool noAck = false);
 
 /// @brief Obté l'últim frame rebut
 /// @param data Apuntador a l'espai on guardar les dades rebudes
 /// @param length Apuntador a la longitud de les dades rebudes
+/// @param noAck Si no és nul, indica si el frame s'ha enviat sense ACK (per reenviar-lo amb la mateixa classe d'entrega)
 /// @return Adreça del node emissor de l'últim frame rebut
-node_address_t MAC_receive(mac_data_t* data, size_t* length);
+node_address_t MAC_receive(mac_data_t* data, size_t* length, bool* noAck = nullptr);
 
 /// @brief Retorna el nombre de frames pendents de ser rebuts per la capa superior
 /// @return Nombre de frames pendents de ser rebuts
@@ -90,6 +219,48 @@ size_t MAC_toReceive();
 /// @return `true` si la capa MAC està disponible per enviar dades, `false` si no
 bool MAC_isAvailable();
 
+/// @brief Reserva un slot de temps (TDMA) per transmetre. Dins del slot, s'accedeix al canal sense CAD ni backoff,
+/// i abans que comenci, les transmissions s'esperen a l'inici. Un cop acabat, es torna a CSMA.
+/// @param startMs Inici del slot, en temps de `millis()`
+/// @param durationMs Durada del slot, en ms
+void MAC_setTxSlot(unsigned long startMs, uint32_t durationMs);
+
+/// @brief Elimina el slot de transmissió reservat, tornant a accedir al canal amb CSMA
+void MAC_clearTxSlot();
+
+/// @brief Estableix el pipeline de reenviament (MAC_PIPELINE): les transmissions de dades només s'inicien a la fase
+/// pròpia, `hop % MAC_PIPELINE_PHASES`, de fases de la durada d'un intercanvi complet. Fora del slot TDMA, si n'hi ha
+/// @param epochMs Inici de la primera fase, en temps de `millis()`. Ha de ser el mateix instant a tots els nodes
+/// @param hop Posició del node a la cadena
+/// @param guardMs Marge afegit a cada fase per l'error de sincronització entre nodes, en ms
+void MAC_setPipeline(unsigned long epochMs, uint8_t hop, uint32_t guardMs);
+
+/// @brief Elimina el pipeline de reenviament, tornant a transmetre sempre que el canal estigui lliure
+void MAC_clearPipeline();
+
+/// @brief Anuncia en broadcast (MAC_DEAF_NOTICE) que el node no podrà rebre durant un temps, per exemple abans d'un uplink LoRaWAN.
+/// S'envia immediatament, sense passar per la cua, i només amb MAC lliure i fora de slots (TDMA o pipeline) d'altres nodes.
+/// Els veïns ajornen fins llavors els frames que hi envien
+/// @param durationMs Temps que no es podrà rebre, en ms, a partir d'ara
+/// @return `MAC_ERR_TX_PENDING` si hi ha un intercanvi en curs o el canal és d'un altre node, i `MAC_ERR` si no s'ha
+/// pogut enviar (canal ocupat). Sense MAC_DEAF_NOTICE, no fa res
+mac_err_t MAC_announceDeaf(uint32_t durationMs);
+
+/// @brief Obté les estadístiques acumulades de la capa MAC
+/// @return Estadístiques de la capa MAC
+mac_stats_t MAC_getStats();
+
+/// @brief Obté les estadístiques de l'enllaç cap a un veí
+/// @param addr Adreça del veí
+/// @param linkStats Estadístiques de l'enllaç
+/// @return `false` si no s'hi ha enviat ni rebut mai res
+bool MAC_getLinkStats(node_address_t addr, mac_link_stats_t* linkStats);
+
+/// @brief Indica si un veí és accessible. Sense MAC_FAST_FAIL, o si no s'hi ha enviat mai res, ho és sempre
+/// @param addr Adreça del veí
+/// @return `false` si està marcat com a inaccessible, i els frames que s'hi enviïn fallaran immediatament
+bool MAC_isReachable(node_address_t addr);
+
 /// @brief Registra un callback per a la recepció de dades a la capa MAC
 /// @param cb Callback a executar quan es rebin dades
 void MAC_onReceive(mac_rx_callback_t cb);
@@ -97,7 +268,20 @@ void MAC_onReceive(mac_rx_callback_t cb);
 /// @param cb Callback a executar quan es completi l'enviament de dades
 void MAC_onSend(mac_tx_callback_t cb);
 /// @brief Registra un callback per a l'enviament fallit de dades a la capa MAC
-/// @param cb Callback a executar quan es produeixi un error en l'enviament de dades
+/// @param cb Callback a executar quan es produeixi un error en l'enviament de dades (reintents esgotats, o receptor inaccessible)
 void MAC_onTxFailed(mac_tx_callback_t cb);
+/// @brief Registra un callback pels frames descartats de la cua de TX per congestió (MAC_AQM), sense intentar-los enviar
+/// @param cb Callback a executar quan es descarti un frame. Si no n'hi ha, es notifiquen amb `MAC_onTxFailed()`
+void MAC_onTxDropped(mac_tx_callback_t cb);
+/// @brief Registra un callback per reenviar directament els frames de dades rebuts (cut-through). Si retorna un següent
+/// salt, MAC reescriu el header del mateix frame i l'afegeix a la cua de TX, sense passar-lo per la cua de RX ni
+/// notificar `MAC_onReceive()`. No s'aplica a broadcast ni a frames fragmentats
+/// @param cb Callback a executar amb les dades de cada frame rebut. `nullptr` per lliurar-los sempre
+void MAC_onForward(mac_forward_callback_t cb);
+/// @brief Registra un callback per saber, abans de lliurar un frame de dades rebut, si capa superior el reenviarà
+/// tot seguit. Amb MAC_IMPLICIT_ACK, només s'ajorna l'ACK dels frames que es reenviaran (el reenviament en fa d'ACK);
+/// la resta es reconeixen abans de lliurar-los. Sense callback, tots es reconeixen abans de lliurar-los
+/// @param cb Callback a executar amb les dades de cada frame rebut. `nullptr` per no ajornar cap ACK
+void MAC_onTransit(mac_transit_callback_t cb);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,26 @@
+#ifndef _MAC_AQM_H
+#define _MAC_AQM_H
+
+#include <stdint.h>
+#include "mac.h"
+
+// Estadístiques de la gestió de la cua de TX, per mesurar funcionament
+typedef struct {
+    uint32_t dequeued;          // Frames obtinguts de la cua de TX
+    uint32_t drops;             // Frames descartats per temps excessiu a la cua
+    uint32_t sojournLastMs;     // Temps a la cua de l'últim frame obtingut, en ms
+    uint32_t sojournMaxMs;      // Temps màxim a la cua, en ms
+    uint64_t sojournSumMs;      // Suma dels temps a la cua, per obtenir-ne la mitjana amb `dequeued`
+} mac_aqm_stats_t;
+
+/// @brief Decideix si un frame obtingut de la cua de TX s'ha de descartar, segons el temps que hi ha estat (CoDel)
+/// @param sojournMs Temps que el frame ha estat a la cua, en ms
+/// @param queueEmpty Si la cua ha quedat buida en obtenir-lo (no hi ha cua persistent)
+/// @return `true` si s'ha de descartar
+bool MACaqm_shouldDrop(uint32_t sojournMs, bool queueEmpty);
+
+/// @brief Obté les estadístiques acumulades de la cua de TX
+/// @return Estadístiques de la cua de TX
+mac_aqm_stats_t MACaqm_getStats();
+
+#endif
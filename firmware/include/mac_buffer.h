@@ -5,11 +5,23 @@
 #include "utils/LinkedFIFO.hpp"
 #include "mac.h"
 
+// Element de la cua de TX: PDU i instant en què s'hi ha afegit (per mesurar-ne el temps d'espera)
 typedef struct {
-    LinkedFIFO<mac_pdu_t> high;
-    LinkedFIFO<mac_pdu_t> low;
+    mac_pdu_t pdu;
+    unsigned long enqueuedAt;   // En `ms`
+} mac_tx_entry_t;
+
+typedef struct {
+    LinkedFIFO<mac_tx_entry_t> high;
+    LinkedFIFO<mac_tx_entry_t> low;
 } mac_buffer_t;
 
+// Cua de recepció: guarda frames complets (reassemblats), no fragments
+typedef struct {
+    LinkedFIFO<mac_sdu_t> high;
+    LinkedFIFO<mac_sdu_t> low;
+} mac_rx_buffer_t;
+
 enum mac_buffer_priority_t {MACBUFF_PRIORITY_NONE = -1, MACBUFF_PRIORITY_LOW, MACBUFF_PRIORITY_HIGH};
 
 /// @brief Retorna si cua TX està buid
@@ -22,8 +34,14 @@ bool MACbuff_isRxEmpty();
 
 /// @brief Obté un element de la cua de TX
 /// @param pdu PDU obtinguda
+/// @param enqueuedAt Si no és nul, instant en què s'havia afegit la PDU a la cua, en `ms`
 /// @return Prioritat del PDU obtingut, o `MACBUFF_PRIORITY_NONE` si no hi ha cap element
-mac_buffer_priority_t MACbuff_popTx(mac_pdu_t& pdu);
+mac_buffer_priority_t MACbuff_popTx(mac_pdu_t& pdu, unsigned long* enqueuedAt = nullptr);
+
+/// @brief Consulta el següent element de la cua de TX, sense treure'l
+/// @param pdu PDU obtinguda
+/// @return Prioritat del PDU obtingut, o `MACBUFF_PRIORITY_NONE` si no hi ha cap element
+mac_buffer_priority_t MACbuff_peekTx(mac_pdu_t& pdu);
 
 /// @brief Afegeix un element a la cua de TX
 /// @param pdu PDU a afegir a la cua
@@ -31,14 +49,14 @@ mac_buffer_priority_t MACbuff_popTx(mac_pdu_t& pdu);
 bool MACbuff_pushTx(mac_pdu_t& pdu, mac_buffer_priority_t priority);
 
 /// @brief Obté un element de la cua de RX
-/// @param pdu PDU obtinguda
-/// @return Prioritat del PDU obtingut, o `MACBUFF_PRIORITY_NONE` si no hi ha cap element
-mac_buffer_priority_t MACbuff_popRx(mac_pdu_t& pdu);
+/// @param sdu Frame obtingut
+/// @return Prioritat del frame obtingut, o `MACBUFF_PRIORITY_NONE` si no hi ha cap element
+mac_buffer_priority_t MACbuff_popRx(mac_sdu_t& sdu);
 
 /// @brief Afegeix un element a la cua de RX
-/// @param pdu PDU a afegir a la cua
-/// @param priority Prioritat del PDU a afegir
-bool MACbuff_pushRx(mac_pdu_t& pdu, mac_buffer_priority_t priority);
+/// @param sdu Frame a afegir a la cua
+/// @param priority Prioritat del frame a afegir
+bool MACbuff_pushRx(mac_sdu_t& sdu, mac_buffer_priority_t priority);
 
 /// @brief Retorna la mida de la cua de TX
 /// @return Mida de la cua de TX
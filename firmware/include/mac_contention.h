@@ -0,0 +1,72 @@
+#ifndef _MAC_CONTENTION_H
+#define _MAC_CONTENTION_H
+
+#include <stdint.h>
+#include "mac.h"
+
+// Estadístiques de l'accés al medi, per mesurar funcionament
+typedef struct {
+    uint32_t idleSamples;       // Comprovacions de canal lliure (CAD)
+    uint32_t busySamples;       // Comprovacions de canal ocupat (CAD)
+    uint32_t deferrals;         // Transmissions ajornades un slot per p-persistència
+    uint32_t collisions;        // Transmissions sense ACK (col·lisió probable)
+    uint16_t contentionWindow;  // Finestra de contenció actual, en slots
+    uint8_t busyRatio;          // Ocupació estimada del canal, en %
+    uint32_t slotMs;            // Mida del slot, en ms
+    uint32_t navSets;           // Reserves de canal (NAV) per frames escoltats d'altres nodes
+    uint32_t navDeferrals;      // Intents de transmissió ajornats per NAV, sense CAD
+    uint32_t navExtensions;     // Reserves allargades en escoltar un ACK d'una TXOP que continua
+} mac_contention_stats_t;
+
+/// @brief Inicialitza l'accés al medi, calculant el slot segons l'airtime actual. Cal que LoRa estigui inicialitzat
+void MACcont_init();
+
+/// @brief Retorna la mida del slot de contenció
+/// @return Mida del slot, en ms
+uint32_t MACcont_getSlotMs();
+
+/// @brief Registra l'estat del canal observat abans d'intentar transmetre
+/// @param busy `true` si el canal estava ocupat
+void MACcont_onChannelSample(bool busy);
+
+/// @brief Reserva el canal (NAV) per un intercanvi d'altres nodes, a partir d'un frame de dades escoltat.
+/// Si ja hi ha una reserva més llarga, es manté
+/// @param owner Emissor del frame escoltat (l'ACK que finalitza l'intercanvi va dirigit a ell)
+/// @param durationMs Temps que el canal estarà ocupat a partir d'ara, en ms
+/// @param moreMs Si l'emissor continuarà la TXOP després de l'ACK, temps estimat del següent intercanvi, en ms (0 si no)
+void MACcont_setNav(node_address_t owner, uint32_t durationMs, uint32_t moreMs = 0);
+
+/// @brief Registra un ACK escoltat per un altre node. Si finalitza l'intercanvi reservat, allibera el NAV;
+/// si l'emissor continua la TXOP, l'allarga pel següent intercanvi
+/// @param rx Receptor de l'ACK
+void MACcont_onAckOverheard(node_address_t rx);
+
+/// @brief Indica si hi ha una reserva de canal (NAV) activa, sense comptar-ho com a ajornament
+/// @return `true` si el canal està reservat per un altre intercanvi
+bool MACcont_isNavActive();
+
+/// @brief Obté el temps restant de la reserva de canal (NAV). Si n'hi ha, no cal fer CAD: el canal està ocupat.
+/// Si n'hi ha, es compta com a ajornament d'una transmissió (`navDeferrals`): per consultar-la, `MACcont_isNavActive()`
+/// @return Temps restant, en ms (0 si no hi ha reserva)
+uint32_t MACcont_getNavMs();
+
+/// @brief Decideix si transmetre amb canal lliure (p-persistència). Si no, cal esperar un slot i tornar-ho a provar
+/// @return `true` si s'ha de transmetre ara
+bool MACcont_shouldTransmit();
+
+/// @brief Calcula el temps d'espera amb canal ocupat
+/// @param attempt Nombre d'esperes consecutives pel mateix frame (només amb BEB clàssic)
+/// @return Temps d'espera, en ms
+uint32_t MACcont_getBackoffMs(uint8_t attempt);
+
+/// @brief Registra una transmissió reconeguda amb ACK
+void MACcont_onTxSuccess();
+
+/// @brief Registra una transmissió sense ACK (col·lisió o manca de cobertura)
+void MACcont_onTxCollision();
+
+/// @brief Obté les estadístiques acumulades de l'accés al medi
+/// @return Estadístiques d'accés al medi
+mac_contention_stats_t MACcont_getStats();
+
+#endif
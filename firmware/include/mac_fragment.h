@@ -0,0 +1,33 @@
+#ifndef _MAC_FRAGMENT_H
+#define _MAC_FRAGMENT_H
+
+#include <stdint.h>
+#include "mac.h"
+
+// Resultat d'afegir un fragment rebut al reassemblatge
+enum mac_frag_result_t {
+    MACFRAG_INCOMPLETE,     // Fragment guardat (o repetit); encara en falten
+    MACFRAG_COMPLETE,       // Frame complet, copiat a la SDU donada
+    MACFRAG_ERR_INVALID,    // Header de fragment no vàlid, o mida incoherent
+    MACFRAG_ERR_NO_MEMORY,  // Totes les entrades de reassemblatge estan ocupades
+};
+
+/// @brief Obté el header d'un fragment de la PDU donada
+/// @param pdu PDU amb flag `frag` establert
+/// @return Header del fragment
+mac_frag_header_t MACfrag_getHeader(const mac_pdu_t* const pdu);
+
+/// @brief Afegeix un fragment rebut al reassemblatge del seu frame
+/// @param pdu PDU rebuda amb flag `frag` establert
+/// @param sdu On copiar el frame reassemblat, si es completa
+/// @return Resultat de l'operació
+mac_frag_result_t MACfrag_add(const mac_pdu_t* const pdu, mac_sdu_t* sdu);
+
+/// @brief Allibera els reassemblatges que fa més de `MAC_FRAG_TIMEOUT_MS` que no reben cap fragment
+/// @return Nombre de reassemblatges descartats
+size_t MACfrag_purgeExpired();
+
+/// @brief Allibera tots els reassemblatges en curs
+void MACfrag_clear();
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef _MAC_NEIGHBORS_H
+#define _MAC_NEIGHBORS_H
+
+#include <stdint.h>
+#include "mac.h"
+
+// Informació que la capa MAC guarda per cada node veí del qual ha rebut frames
+// S'indexa directament per adreça (8 bits), per tenir accés O(1) sense cerques
+typedef struct {
+    mac_id_t lastSeq;       // Seqüència més alta rebuda del veí
+    uint32_t seqWindow;     // Bitmap de seqüències ja rebudes. Bit `i` correspon a `lastSeq - i`
+    bool hasSeq;            // Si s'ha rebut alguna seqüència (i, per tant, la finestra és vàlida)
+
+    // Frame d'ACK precalculat cap al veí; per cada ACK només cal modificar-hi l'ID i completar el CRC
+    uint8_t ackTemplate[MAC_ACK_FRAME_SIZE];
+    mac_crc_t ackCrcPrefix; // CRC dels bytes anteriors a l'ID
+    bool hasAckTemplate;
+
+    unsigned long deafUntil;    // Fi de l'últim període d'indisponibilitat anunciat pel veí (MAC_CTRL_DEAF), en temps de `millis()`
+
+    // Estadístiques
+    uint32_t framesReceived;    // Frames nous rebuts
+    uint32_t duplicates;        // Frames descartats per repetits
+    uint32_t outOfWindow;       // Seqüències fora de finestra (reinici de l'emissor, o massa antigues)
+    uint32_t framesOverheard;   // Frames escoltats del veí dirigits a altres nodes
+    mac_link_stats_t link;      // Enllaç cap al veí, com a emissor
+} mac_neighbor_t;
+
+/// @brief Obté la informació d'un veí, creant-la si no existeix
+/// @param addr Adreça del veí
+/// @return Apuntador a la informació del veí, o `nullptr` si no s'ha pogut reservar memòria
+mac_neighbor_t* MACnb_get(node_address_t addr);
+
+/// @brief Obté la informació d'un veí, sense crear-la si no existeix
+/// @param addr Adreça del veí
+/// @return Apuntador a la informació del veí, o `nullptr` si no se n'ha rebut mai res
+mac_neighbor_t* MACnb_find(node_address_t addr);
+
+/// @brief Comprova si una seqüència d'un veí ja s'ha rebut anteriorment. No modifica la finestra
+/// @param addr Adreça del veí emissor
+/// @param seq Seqüència (ID) del frame rebut
+/// @return `true` si és un duplicat
+bool MACnb_isDuplicate(node_address_t addr, mac_id_t seq);
+
+/// @brief Marca una seqüència d'un veí com a rebuda, desplaçant la finestra si cal
+/// @param addr Adreça del veí emissor
+/// @param seq Seqüència (ID) del frame rebut
+/// @return `false` si la seqüència estava fora de finestra i s'ha hagut de re-sincronitzar
+bool MACnb_markReceived(node_address_t addr, mac_id_t seq);
+
+/// @brief Obté el següent veí marcat com a inaccessible, en ordre d'adreça a partir de `after` (circular)
+/// @param after Adreça a partir de la qual buscar (no inclosa)
+/// @return Adreça del veí, o `NODE_ADDRESS_NULL` si no n'hi ha cap
+node_address_t MACnb_nextUnreachable(node_address_t after);
+
+/// @brief Esborra tota la informació de veïns, alliberant memòria
+void MACnb_clear();
+
+#endif
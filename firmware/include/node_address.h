@@ -4,7 +4,7 @@
 #include <stdint.h>
 
 #define NODE_ADDRESS_NULL 0x00
-// No utilitzat; per possibles millores futures; tot i això, filtrat implementat
+// Tots els veïns a l'abast. Frames sense ACK, i paquets d'un únic salt
 #define NODE_ADDRESS_BROADCAST 0xFF 
 
 // Adreça simulada que utiltiza el gateway de lora
@@ -7,7 +7,19 @@
 #include "routing_table.h"
 
 
-#define ROUTING_HEADERS_SIZE (2+1+1) // 2 adreces + 1 ttl + 1 datalength
+#ifdef COMPACT_HEADERS
+#define ROUTING_HEADERS_SIZE (1+2)    // 1 control (TTL + adreces omeses) + fins a 2 adreces
+#define ROUTING_MIN_HEADERS_SIZE 1    // Si les dues adreces coincideixen amb les de MAC, només hi ha control
+#else
+// Amb fragmentació MAC, les dades poden superar els 255 B i el camp de mida ocupa 2 bytes
+#if MAC_FRAG_MAX_FRAGMENTS > 1
+#define ROUTING_LENGTH_FIELD_SIZE 2
+#else
+#define ROUTING_LENGTH_FIELD_SIZE 1
+#endif
+#define ROUTING_HEADERS_SIZE (2+1+ROUTING_LENGTH_FIELD_SIZE) // 2 adreces + 1 ttl + datalength
+#define ROUTING_MIN_HEADERS_SIZE ROUTING_HEADERS_SIZE
+#endif
 #define ROUTING_MAX_DATA_SIZE MAC_MAX_DATA_SIZE - ROUTING_HEADERS_SIZE
 
 typedef uint8_t routing_data_t[ROUTING_MAX_DATA_SIZE];
@@ -16,10 +28,20 @@ typedef struct {
     node_address_t src;
     node_address_t dst;
     uint8_t ttl;
-    uint8_t dataLength;
+    uint16_t dataLength;
     routing_data_t data;
+    bool noAck;     // Entrega sense garanties a cada salt (sense ACK de MAC). No forma part del header: la indica MAC
 } routing_pdu_t;
 
+// Byte de control del format compacte. Les adreces omeses es dedueixen de les adreces de MAC:
+// origen = emissor del frame, destí = receptor del frame
+typedef struct {
+    uint8_t ttl : 3;        // TTL (fins a 7)
+    uint8_t srcElided : 1;  // Origen omès (igual a emissor MAC)
+    uint8_t dstElided : 1;  // Destí omès (igual a receptor MAC)
+    uint8_t reserved : 3;
+} routing_compact_ctrl_t;
+
 typedef void (*routing_rx_callback_t)(void);
 typedef void (*routing_tx_callback_t)(uint16_t); // no definir a mac_id_t, per si mai es canvia i no es vol utilitzar MAC
                                                  // l'únic requisit és que sigui uint16_t
@@ -29,6 +51,7 @@ enum routing_err_t {
     ROUTING_ERR,
     ROUTING_ERR_NO_ROUTE,
     ROUTING_ERR_MAX_LENGTH,
+    ROUTING_ERR_UNREACHABLE,    // El següent salt està marcat com a inaccessible a MAC
 };
 
 /// @brief Inicialitza capa d'encaminament. Inicialitza capa MAC i taula de rutes.
@@ -41,11 +64,17 @@ bool Routing_init(node_address_t selfAddr, bool is_gateway);
 void Routing_deinit();
 
 /// @brief Envia un paquet a través de la capa d'encaminament.
-/// @param rx Adreça del node receptor
+/// @param rx Adreça del node receptor. Si és `NODE_ADDRESS_BROADCAST`, s'envia en un únic salt a tots els veïns
 /// @param data Dades a enviar
 /// @param length Longitud de les dades a enviar
 /// @param id ID del paquet enviat (opcional, pot ser `nullptr`)
-routing_err_t Routing_send(node_address_t rx, const routing_data_t data, size_t length, uint16_t* id = nullptr);
+/// @param noAck Entrega sense garanties: cap salt el reconeix amb ACK ni el reintenta. Els nodes intermedis el reenvien igual
+routing_err_t Routing_send(node_address_t rx, const routing_data_t data, size_t length, uint16_t* id = nullptr, bool noAck = false);
+
+/// @brief Indica si el destí és accessible: si hi ha ruta, i el següent salt no està marcat com a inaccessible a MAC
+/// @param dst Adreça del node destí
+/// @return `false` si els paquets cap al destí fallarien immediatament
+bool Routing_isReachable(node_address_t dst);
 
 /// @brief Obté el paquet rebut a través de la capa d'encaminament. S'ha d'executar després de ser notificat pel callback
 /// @param data Dades del paquet rebut (s'ha d'inicialitzar abans de la crida)
@@ -0,0 +1,65 @@
+#ifndef _ROUTING_CODING_H
+#define _ROUTING_CODING_H
+
+#include <stdint.h>
+#include "routing.h"
+
+// Resultat d'afegir un paquet a reenviar a la cua de codificació
+enum routing_nc_result_t {
+    ROUTINGNC_QUEUED,   // Guardat a la cua, a l'espera de MAC lliure o d'un paquet en sentit contrari
+    ROUTINGNC_CODED,    // Codificat amb un paquet en sentit contrari de la cua; cal enviar el paquet codificat
+    ROUTINGNC_FULL,     // No hi cap; cal enviar-lo sense codificar
+};
+
+// Estadístiques de la codificació, per mesurar funcionament
+typedef struct {
+    uint32_t held;                  // Paquets a reenviar guardats a la cua de codificació
+    uint32_t codingOpportunities;   // Parelles de paquets enviades en un únic paquet codificat
+    uint32_t nativeSent;            // Paquets de la cua enviats sense codificar (cap paquet en sentit contrari)
+    uint32_t decoded;               // Paquets codificats rebuts i descodificats
+    uint32_t decodeMisses;          // Paquets codificats per nosaltres que no s'han pogut descodificar (paquet propi no retingut)
+} routing_nc_stats_t;
+
+/// @brief Indica si un paquet rebut és un paquet codificat (TTL 0, que cap paquet normal pot tenir)
+/// @param pdu Paquet rebut
+/// @return `true` si és codificat
+bool RoutingNC_isCoded(const routing_pdu_t* const pdu);
+
+/// @brief Reté una còpia d'un paquet enviat a un veí, per poder descodificar després paquets codificats que el continguin
+/// @param pdu Paquet enviat, tal com surt del node
+void RoutingNC_retain(const routing_pdu_t* const pdu);
+
+/// @brief Afegeix un paquet a reenviar a la cua de codificació. Si a la cua hi ha un paquet en sentit contrari
+/// (rebut del següent salt, i que va a l'anterior), en genera el paquet codificat (XOR) i els treu tots dos de la cua
+/// @param pdu Paquet a reenviar, amb el TTL ja decrementat
+/// @param prevHop Node del qual s'ha rebut
+/// @param nextHop Node al qual s'ha de reenviar
+/// @param coded Paquet codificat a enviar en broadcast, si el resultat és `ROUTINGNC_CODED`. Cal establir-ne l'origen
+/// @return Resultat
+routing_nc_result_t RoutingNC_enqueue(const routing_pdu_t* const pdu, node_address_t prevHop, node_address_t nextHop, routing_pdu_t* coded);
+
+/// @brief Obté el paquet més antic de la cua de codificació, per enviar-lo sense codificar
+/// @param pdu Paquet a reenviar
+/// @param nextHop Node al qual s'ha de reenviar
+/// @return `false` si la cua és buida
+bool RoutingNC_dequeue(routing_pdu_t* pdu, node_address_t* nextHop);
+
+/// @brief Retorna el nombre de paquets que esperen a la cua de codificació
+/// @return Nombre de paquets a la cua
+size_t RoutingNC_pending();
+
+/// @brief Descodifica un paquet codificat rebut, amb el paquet propi retingut que conté
+/// @param coded Paquet codificat rebut
+/// @param self Adreça pròpia
+/// @param pdu Paquet descodificat, tal com l'hauria reenviat el node que l'ha codificat
+/// @return `true` si contenia un paquet per nosaltres i s'ha pogut descodificar
+bool RoutingNC_decode(const routing_pdu_t* const coded, node_address_t self, routing_pdu_t* pdu);
+
+/// @brief Esborra la cua de codificació i els paquets retinguts, alliberant memòria
+void RoutingNC_clear();
+
+/// @brief Obté les estadístiques acumulades de la codificació
+/// @return Estadístiques de la codificació
+routing_nc_stats_t RoutingNC_getStats();
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef _ROUTING_DV_H
+#define _ROUTING_DV_H
+
+#include <stdint.h>
+#include "routing.h"
+
+// Mètrica (ETX) en unitats de 1/ROUTING_DV_METRIC_UNIT transmissions. ROUTING_DV_METRIC_INF indica destí inaccessible,
+// igual que qualsevol cost superior a ROUTING_DV_METRIC_MAX: així, els bucles que el split horizon no evita (de 3 o més
+// nodes) es trenquen quan el cost que s'anuncien arriba al límit, en lloc de mantenir-se indefinidament
+#define ROUTING_DV_METRIC_UNIT 8
+#define ROUTING_DV_METRIC_INF 0xFF
+#define ROUTING_DV_METRIC_MAX (ROUTING_DV_MAX_ETX * ROUTING_DV_METRIC_UNIT - 1)
+
+#if ROUTING_DV_METRIC_MAX >= ROUTING_DV_METRIC_INF
+    #error "ROUTING_DV_MAX_ETX no pot ser major a 31 (mètrica de 8 bits)"
+#endif
+
+// Estadístiques de l'aprenentatge de rutes, per mesurar convergència i estabilitat
+typedef struct {
+    uint32_t advertsSent;       // Anuncis de rutes enviats
+    uint32_t advertsReceived;   // Anuncis de rutes de veïns processats
+    uint32_t routeChanges;      // Canvis de següent salt instal·lats a la taula de rutes
+    uint32_t changesSuppressed; // Rutes millors que l'actual, però no prou (histèresi), que no s'han instal·lat
+    uint32_t tableFull;         // Destins ignorats per no caber a la taula de ROUTING_DV_MAX_ROUTES
+} routing_dv_stats_t;
+
+/// @brief Inicialitza l'aprenentatge de rutes, buidant l'estat après
+/// @param self Adreça pròpia
+void RoutingDV_init(node_address_t self);
+
+/// @brief Indica si un paquet rebut és un anunci de rutes (destí `NODE_ADDRESS_NULL`, que cap paquet normal pot tenir)
+/// @param pdu Paquet rebut
+/// @return `true` si és un anunci
+bool RoutingDV_isAdvert(const routing_pdu_t* const pdu);
+
+/// @brief Processa un anunci de rutes d'un veí: n'actualitza l'ETX de l'enllaç, i instal·la a la taula de rutes
+/// (`RoutingTable_updateRoute()`) els destins als quals el veí ofereix un camí prou millor que l'actual
+/// @param pdu Anunci rebut
+/// @param prevHop Veí que l'ha enviat (emissor MAC)
+void RoutingDV_process(const routing_pdu_t* const pdu, node_address_t prevHop);
+
+/// @brief Notifica un paquet rebut d'un veí. Si la ruta apresa cap a l'origen passa per aquest veí, es manté vigent
+/// sense esperar el següent anunci
+/// @param src Origen del paquet
+/// @param prevHop Veí que l'ha enviat (emissor MAC)
+void RoutingDV_onTraffic(node_address_t src, node_address_t prevHop);
+
+/// @brief Genera el següent anunci de rutes, a enviar en broadcast d'un únic salt. Si les rutes no hi caben en un
+/// únic frame, cada anunci en porta una part, per torns
+/// @param pdu Anunci a enviar
+void RoutingDV_buildAdvert(routing_pdu_t* pdu);
+
+/// @brief Obté les estadístiques acumulades de l'aprenentatge de rutes
+/// @return Estadístiques de l'aprenentatge de rutes
+routing_dv_stats_t RoutingDV_getStats();
+
+#endif
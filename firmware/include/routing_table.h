@@ -2,46 +2,120 @@
 #define _ROUTING_TABLE_H
 
 #include <stdint.h>
+#include <stddef.h>
 #include "node_address.h"
+#include "config.h"
 
+// Entrada de la taula de rutes, tal com es guarda a NVS
 typedef struct {
     node_address_t dst;
     node_address_t nextHop;
 } routing_entry_t;
 
+// Ruta per rang d'adreces de destí, ambdós extrems inclosos
+typedef struct {
+    node_address_t dstLo;
+    node_address_t dstHi;
+    node_address_t nextHop;
+} routing_range_entry_t;
+
+// Salts alternatius per un destí, en ordre de preferència. Els no utilitzats són `NODE_ADDRESS_NULL`
+typedef struct {
+    node_address_t dst;
+    node_address_t nextHops[ROUTING_TABLE_MAX_BACKUPS];
+} routing_backup_entry_t;
+
+// Escriptures a NVS de la taula de rutes, per mesurar-ne el cost
+typedef struct {
+    uint32_t journalWrites;     // Registres de canvis afegits al diari (i actualitzacions de l'inici del diari)
+    uint32_t journalWriteUs;    // Temps total de les escriptures al diari, en us
+    uint32_t snapshotWrites;    // Escriptures de la taula sencera (compactacions), de la de rangs i de la d'alternatius
+    uint32_t snapshotWriteUs;   // Temps total de les escriptures de la taula sencera, en us
+    uint32_t maxWriteUs;        // Escriptura més llarga (bloquejant), en us
+    uint32_t commits;           // Compactacions del diari completades
+} routing_table_stats_t;
+
 /// @brief Inicialitza la taula de rutes, obtenint-la de NVS
 /// @return `true`si s'ha pogut inicialitzar
 bool RoutingTable_init();
 
-/// @brief Desinicialitza la taula de rutes, alliberant la memòria. No esborra de NVS
+/// @brief Desinicialitza la taula de rutes, buidant-la. No esborra de NVS
 void RoutingTable_deinit();
 
-/// @brief Obtén la ruta per a un node de destí
+/// @brief Obtén la ruta per a un node de destí. Té preferència la ruta exacta; si no n'hi ha, la del rang més estret
+/// que conté el destí (la ruta per defecte és el rang sencer)
 /// @param dst L'adreça del node de destí
 /// @return L'adreça del node següent en la ruta, o `NODE_ADDRESS_NULL` si no hi ha ruta
 node_address_t RoutingTable_getRoute(node_address_t dst);
 
-/// @brief Afegeix una ruta a la taula de rutes. Guarda a NVS
+/// @brief Obtén els salts possibles cap a un destí, en ordre de preferència: el de `RoutingTable_getRoute()`, i després
+/// els alternatius del destí
+/// @param dst L'adreça del node de destí
+/// @param hops Salts cap al destí (sortida)
+/// @param maxHops Mida de `hops`
+/// @return Nombre de salts obtinguts. 0 si no hi ha ruta
+size_t RoutingTable_getRoutes(node_address_t dst, node_address_t* hops, size_t maxHops);
+
+/// @brief Afegeix una ruta a la taula de rutes. Guarda el canvi al diari de NVS
 /// @param dst L'adreça del node de destí
 /// @param nextHop L'adreça del node següent en la ruta
-/// @return `true` si s'ha pogut afegir la ruta, `false` si ja existeix
+/// @return `true` si s'ha pogut afegir la ruta, `false` si ja existeix o `nextHop` és `NODE_ADDRESS_NULL`
 bool RoutingTable_addRoute(node_address_t dst, node_address_t nextHop);
 
-/// @brief Actualitza una ruta existent a la taula de rutes. La crea si no existeix. Guarda a NVS
+/// @brief Actualitza una ruta existent a la taula de rutes. La crea si no existeix. Guarda el canvi al diari de NVS
 /// @param dst L'adreça del node de destí
 /// @param nextHop L'adreça del node següent en la ruta
 /// @return `true` si s'ha pogut actualitzar la ruta, `false` si no existeix o no cal actualitzar
 bool RoutingTable_updateRoute(node_address_t dst, node_address_t nextHop);
 
-/// @brief Esborra una ruta de la taula de rutes. Guarda a NVS
+/// @brief Esborra una ruta de la taula de rutes. Guarda el canvi al diari de NVS
 /// @param dst L'adreça del node de destí
 /// @return `true` si s'ha pogut esborrar la ruta, `false` si no existeix
 bool RoutingTable_removeRoute(node_address_t dst);
 
-/// @brief Esborra totes les rutes de la taula de rutes. Allibera memòria i esborra de NVS
+/// @brief Afegeix una ruta per rang, o n'actualitza el següent salt si el rang ja existeix. Guarda a NVS
+/// @param dstLo Primera adreça de destí del rang
+/// @param dstHi Última adreça de destí del rang (inclosa)
+/// @param nextHop L'adreça del node següent per tots els destins del rang
+/// @return `false` si el rang no és vàlid, o ja hi ha ROUTING_TABLE_MAX_RANGES rangs
+bool RoutingTable_setRangeRoute(node_address_t dstLo, node_address_t dstHi, node_address_t nextHop);
+
+/// @brief Esborra una ruta per rang. Guarda a NVS
+/// @param dstLo Primera adreça de destí del rang
+/// @param dstHi Última adreça de destí del rang
+/// @return `true` si s'ha pogut esborrar, `false` si no existeix
+bool RoutingTable_removeRangeRoute(node_address_t dstLo, node_address_t dstHi);
+
+/// @brief Estableix la ruta per defecte, pels destins sense cap altra ruta (rang 0x00..0xFF). Guarda a NVS
+/// @param nextHop L'adreça del node següent
+/// @return `true` si s'ha pogut establir
+bool RoutingTable_setDefaultRoute(node_address_t nextHop);
+
+/// @brief Esborra la ruta per defecte. Guarda a NVS
+/// @return `true` si s'ha pogut esborrar, `false` si no n'hi havia
+bool RoutingTable_removeDefaultRoute();
+
+/// @brief Estableix els salts alternatius cap a un destí, pel failover quan falla el principal. Substitueix els anteriors.
+/// Són independents de la ruta principal (exacta o per rang), que no modifica. Guarda a NVS
+/// @param dst L'adreça del node de destí
+/// @param hops Salts alternatius, en ordre de preferència
+/// @param count Nombre de salts (fins a ROUTING_TABLE_MAX_BACKUPS). 0 els esborra
+/// @return `false` si no són vàlids, o ja hi ha ROUTING_TABLE_MAX_BACKUP_ROUTES destins amb alternatius
+bool RoutingTable_setBackupRoutes(node_address_t dst, const node_address_t* hops, size_t count);
+
+/// @brief Esborra totes les rutes de la taula de rutes, també de NVS
 /// @return `true` si s'ha pogut esborrar la taula de rutes, `false` si hi ha algun error
 bool RoutingTable_clear();
 
+/// @brief Compacta el diari de canvis a la còpia sencera de la taula a NVS. També es fa automàticament quan el diari
+/// arriba a ROUTING_TABLE_JOURNAL_SIZE registres. Convé cridar-la en acabar d'afegir moltes rutes
+/// @return `true` si s'ha compactat (o no hi havia canvis pendents)
+bool RoutingTable_commit();
+
+/// @brief Obté les estadístiques d'escriptura a NVS de la taula de rutes
+/// @return Estadístiques acumulades des de l'arrencada
+routing_table_stats_t RoutingTable_getStats();
+
 /// @brief Imprimeix la taula de rutes a la consola. Per DEBUG.
 void RoutingTable_print();
 
@@ -25,7 +25,11 @@ enum sleep_command_t : uint8_t {
 };
 
 #define SLEEP_HEADER_SIZE (1 + 1) // 1 de ordre + 1 de mida
-#define SLEEP_MAX_DATA_SIZE (TRANSPORT_MAX_DATA_SIZE - SLEEP_HEADER_SIZE) // Màxim de dades que es poden enviar
+// Mida total de headers d'un SYNC, de totes les capes
+#define SLEEP_STACK_HEADERS_SIZE (MAC_PDU_HEADER_SIZE + ROUTING_HEADERS_SIZE + TRANSPORT_HEADER_SIZE + SLEEP_HEADER_SIZE)
+// Màxim de dades que es poden enviar. Es limita a un únic frame LoRa (sense fragmentar), perquè el temps
+// de transmissió del SYNC, que s'utilitza per calcular el temps de sleep, sigui previsible
+#define SLEEP_MAX_DATA_SIZE (LORA_MAX_SIZE - SLEEP_STACK_HEADERS_SIZE)
 
 typedef struct {
     sleep_command_t command;
@@ -7,7 +7,17 @@
 // Ports màxims (2^6-1 = 63)
 #define TRANSPORT_MAX_PORT 63
 
-#define TRANSPORT_HEADER_SIZE (2+1+1) // 2 d'ID + 1 flags + 1 dataLength
+#ifdef COMPACT_HEADERS
+#define TRANSPORT_HEADER_SIZE (2+1) // 2 d'ID + 1 flags; mida es dedueix de la de capa inferior
+#else
+// Amb fragmentació MAC, les dades poden superar els 255 B i el camp de mida ocupa 2 bytes
+#if MAC_FRAG_MAX_FRAGMENTS > 1
+#define TRANSPORT_LENGTH_FIELD_SIZE 2
+#else
+#define TRANSPORT_LENGTH_FIELD_SIZE 1
+#endif
+#define TRANSPORT_HEADER_SIZE (2+1+TRANSPORT_LENGTH_FIELD_SIZE) // 2 d'ID + 1 flags + dataLength
+#endif
 #define TRANSPORT_MAX_DATA_SIZE ROUTING_MAX_DATA_SIZE - TRANSPORT_HEADER_SIZE
 
 typedef uint8_t transport_data_t[TRANSPORT_MAX_DATA_SIZE]; 
@@ -23,7 +33,7 @@ typedef struct {
 typedef struct {
     transport_id_t ID;
     transport_pdu_flags_t flags;
-    uint8_t dataLength; 
+    uint16_t dataLength; 
     transport_data_t data;
 } transport_pdu_t;
 
@@ -34,6 +44,7 @@ enum transport_err_t {
     TRANSPORT_ERR,
     TRANSPORT_ERR_NO_ACK,
     TRANSPORT_ERR_MAX_LENGTH,
+    TRANSPORT_ERR_UNREACHABLE,  // El següent salt cap al destí està marcat com a inaccessible
 };
 
 /// @brief Initialitza la capa de transport. Inicialitza capes inferiors
@@ -47,12 +58,13 @@ bool Transport_init(node_address_t selfAddr, bool is_gateway);
 void Transport_deinit(transport_port_t port);
 
 /// @brief Envia un segment a l'adreça `rx` i port `port` amb les dades `data` de longitud `length`. Si `ackRequested` és cert, es demanarà ACK.
-/// @param rx Adreça del node receptor
+/// @param rx Adreça del node receptor. Si és `NODE_ADDRESS_BROADCAST`, arriba a tots els veïns i no pot demanar ACK
 /// @param port Port al qual enviar el segment
 /// @param data Dades a enviar
 /// @param length Longitud de les dades a enviar
 /// @param ackRequested Si es demana ACK per aquest segment
-transport_err_t Transport_send(node_address_t rx, transport_port_t port, const transport_data_t data, size_t length, bool ackRequested);
+/// @param noAck Entrega sense garanties a cada salt (sense ACK ni reintents de MAC). Per dades que toleren pèrdues, sense `ackRequested`
+transport_err_t Transport_send(node_address_t rx, transport_port_t port, const transport_data_t data, size_t length, bool ackRequested, bool noAck = false);
 
 /// @brief Rep un segment i retorna l'adreça del node emissor, el port i les dades rebudes.
 /// @param port Port al qual s'ha rebut el segment
@@ -19,8 +19,11 @@ static void _onReceive(void);
 static int16_t _startReceiving();
 static void _checkReceived(void);
 static void _printLora(const lora_data_t data, size_t length);
+static lora_tx_error_t _transmit(const lora_data_t data, size_t length);
 
 volatile bool received = false;
+// Instant de l'última interrupció de RxDone, en `us`
+volatile static unsigned long rxDoneTime = 0;
 static lora_callback_t onReceive = nullptr;
 static Task* checkIRQTask;
 
@@ -52,7 +55,7 @@ void LoRaRAW_deinit() {
     scheduler_stop(checkIRQTask);
 }
 
-lora_tx_error_t LoRaRAW_send(const lora_data_t data, size_t length) {
+lora_tx_error_t LoRaRAW_send(const lora_data_t data, size_t length, bool checkChannel) {
     _PI("[LR] Preparing to send");
 
     LoRaRAW_stopReceiving();
@@ -63,7 +66,7 @@ lora_tx_error_t LoRaRAW_send(const lora_data_t data, size_t length) {
         return LORA_ERROR_TX_MAX_LENGTH;
     }
 
-    if (!LoRaRAW_isAvailable()) {
+    if (checkChannel && !LoRaRAW_isAvailable()) {
         _PW("[LR] Channel busy");
         _startReceiving();
         return LORA_ERROR_TX_BUSY;
@@ -71,17 +74,38 @@ lora_tx_error_t LoRaRAW_send(const lora_data_t data, size_t length) {
 
     _printLora(data, length);
 
-    int16_t state = radio.transmit(data, length);
+    return _transmit(data, length);
+}
 
-    _startReceiving();
+lora_tx_error_t LoRaRAW_sendImmediate(const lora_data_t data, size_t length) {
+    LoRaRAW_stopReceiving();
+
+    if (length > LORA_MAX_SIZE) {
+        _PW("[LR] Max length exceeded (length = %d)", length);
+        _startReceiving();
+        return LORA_ERROR_TX_MAX_LENGTH;
+    }
+
+    return _transmit(data, length);
+}
+
+unsigned long LoRaRAW_getLastRxTime() { return rxDoneTime; }
+
+bool LoRaRAW_receiveHeader(uint8_t* data, size_t maxLength, size_t* length) {
+    *length = MIN(radio.getPacketLength(), LORA_MAX_SIZE);
 
+    // Només es transfereixen els bytes demanats; el buffer de la ràdio es manté fins a tornar a recepció
+    int state = radio.readData(data, MIN(*length, maxLength));
     if (state != RADIOLIB_ERR_NONE) {
-        _PE("[LR] Error transmitting (code = %d)", state);
-        return LORA_ERROR;
+        _PW("[LR] Error reading header (code = %d)", state);
+        _startReceiving();
+        return false;
     }
-    return LORA_SUCCESS;
+    return true;
 }
 
+void LoRaRAW_discard() { _startReceiving(); }
+
 bool LoRaRAW_receive(lora_data_t data, size_t* length) {
     /*
     Obté les dades rebudes del driver.
@@ -194,6 +218,7 @@ static void _onReceive(void) {
     // S'inicia una tasca en iniciar que comprova els flags cada pocs ms
     // dins de LOOP, evitant bloquejar ISR.
 
+    rxDoneTime = micros();
     received = true;
 }
 
@@ -212,15 +237,29 @@ static void _received_lora(void) {
     Torna a posar-se en mode de recepció, ja que després
     de fer lectura de les dades rebudes es posa en mode standby.
     */
-    _PI("[LR] Data received. SNR: %d, RSSI: %d", LoRaRAW_getLastSNR(),
-        LoRaRAW_getLastRSSI());
+    // La traça es mostra després del callback, per no endarrerir la resposta (ACK) de capes superiors
     if (onReceive != nullptr) {
         onReceive();
         // scheduler_once(onReceive);
     }
+    _PI("[LR] Data received. SNR: %d, RSSI: %d", LoRaRAW_getLastSNR(),
+        LoRaRAW_getLastRSSI());
     // _startReceiving();
 }
 
+// Transmet (bloquejant) i torna a posar la ràdio en recepció
+static lora_tx_error_t _transmit(const lora_data_t data, size_t length) {
+    int16_t state = radio.transmit(data, length);
+
+    _startReceiving();
+
+    if (state != RADIOLIB_ERR_NONE) {
+        _PE("[LR] Error transmitting (code = %d)", state);
+        return LORA_ERROR;
+    }
+    return LORA_SUCCESS;
+}
+
 #if LOG_LEVEL <= LOG_LEVEL_INFO
 static void _printLora(const lora_data_t data, size_t length) {
     _PI("[LR] Packet: %.*s", length * 2, ([](const lora_data_t data, size_t length) {
@@ -4,14 +4,38 @@
 #include "lora.h"
 #include "scheduler.h"
 #include "utils.h"
-#include "RingBuffer.h"
 #include "mac_buffer.h"
+#include "mac_neighbors.h"
+#include "mac_fragment.h"
+#include "mac_contention.h"
+#include "mac_aqm.h"
+
+#if defined(MAC_RTS_CTS) && !defined(MAC_NAV)
+    #error "MAC_RTS_CTS requereix MAC_NAV (els nodes que escolten l'RTS o el CTS han de reservar el canal)"
+#endif
+#if defined(MAC_TXOP) && (!defined(MAC_NAV) || defined(MAC_DUTY_CYCLE))
+    #error "MAC_TXOP requereix MAC_NAV, i no és compatible amb MAC_DUTY_CYCLE"
+#endif
+
+// Mida de la qualitat d'enllaç als ACK rebuts que la porten (encara que no s'enviï: MAC_ACK_LINK_INFO_SIZE pot ser 0)
+#define MAC_ACK_LINK_INFO_SIZE_RX sizeof(mac_link_info_t)
+
+// Bytes llegits abans de decidir si cal el frame sencer: header sense CRC, i l'ID de l'ACK implícit
+#define MAC_HEADER_PEEK_SIZE (MAC_PDU_HEADER_SIZE - MAC_CRC_SIZE + MAC_ACK_ID_SIZE)
+
+// Posició de l'ID dins d'un frame d'ACK (veure `_PDUtoLora`)
+#ifdef COMPACT_HEADERS
+#define MAC_ACK_ID_OFFSET (2*MAC_ADDRESS_SIZE + MAC_FLAGS_SIZE)
+#else
+#define MAC_ACK_ID_OFFSET (2*MAC_ADDRESS_SIZE)
+#endif
 
 enum mac_event_t {
     TX_E,             // Iniciar TX
     TOUT_BUSY_E,      // Fi tout de canal ocupat
     TOUT_ACK_E,       // Timeout recepció ACK
     RX_ACK_E,         // Recepció ACK
+    RX_CTS_E,         // Recepció CTS (RTS/CTS)
 
 #ifdef MAC_DUTY_CYCLE
     TOUT_DUTY_E,      // Fi temps per duty cycle
@@ -27,6 +51,7 @@ enum mac_state_t {
     IDLE_S,           // Esperant
     WAIT_ACK_S,       // Esperant recepció ACK
     WAIT_CHAN_FREE_S, // Esperant canal LoRa lliure
+    WAIT_CTS_S,       // Esperant recepció CTS (RTS/CTS)
 
 #ifdef MAC_DUTY_CYCLE
     WAIT_DUTY_CYCLE_S, // Esperant temps per complir amb duty cycle establert
@@ -37,32 +62,106 @@ enum mac_state_t {
 volatile static mac_state_t fsmState = mac_state_t::IDLE_S;
 static mac_tx_callback_t onSend = nullptr;
 static mac_tx_callback_t onTxFailed = nullptr;
+static mac_tx_callback_t onTxDropped = nullptr;
 static mac_rx_callback_t onReceive = nullptr;
+static mac_forward_callback_t onForward = nullptr;
+static mac_transit_callback_t onTransit = nullptr;
 
 static node_address_t self;
 
 static mac_pdu_t txPDU; // PDU en transmissió
 
+// Frame complet rebut, abans de guardar-lo a la cua de RX; també s'utilitza per obtenir-lo de la cua
+// Estàtic per no ocupar `MAC_MAX_DATA_SIZE` a la pila en cada recepció
+static mac_sdu_t rxSDU;
+
 volatile static uint8_t currentTxRetry = 0;
 volatile static uint8_t currentBEBRetry = 0;
 
-static RingBuffer lastFramesIDs(MAC_QUEUE_SIZE);
+// Si ja s'han comptat a `deafRetriesSaved` els intents estalviats de txPDU (un cop per frame, encara que s'ajorni més cops)
+static bool deafRetriesCounted = false;
 
-// Valors per informació. Per si mai fan falta...
-static int CRCErrors = 0, failedTransmissions = 0, succeededTransmissions = 0, framesReceived = 0; 
+// Última seqüència utilitzada per enviar. Guardada a memòria RTC perquè no es reiniciï després de deep sleep,
+// i els veïns no descartin els nous frames com a duplicats. En arrencar de zero (alimentació, brownout...) es perd,
+// i s'inicialitza aleatòriament a `MAC_init()`
+static RTC_DATA_ATTR mac_id_t lastTxSeq = 0;
+
+// Valors per informació i mesura de funcionament
+static mac_stats_t stats = {};
 
 static Task* txTimeoutTask;
 
+#ifdef MAC_IMPLICIT_ACK
+// Frame rebut pendent de reconèixer mentre es notifica capa superior. Si aquesta envia un frame a un altre node durant
+// la notificació (reenviament), porta l'ACK implícit; si no, s'envia ACK explícit en acabar
+static bool implicitAckPending = false;
+static mac_pdu_t implicitAckRef;
+#endif
+
+#ifdef MAC_TXOP
+// Oportunitat de transmissió en curs: inici, en `ms`, i frames enviats
+static bool txopActive = false;
+static unsigned long txopStart = 0;
+static uint8_t txopFrames = 0;
+#endif
+
+#ifdef MAC_PIPELINE
+// Pipeline de reenviament (`MAC_setPipeline`): inici de la primera fase, en `ms`, durada de cada fase i fase pròpia
+static bool hasPipeline = false;
+static unsigned long pipelineEpoch = 0;
+static uint32_t pipelinePhaseMs = 0;
+static uint8_t pipelinePhase = 0;
+#endif
+
+#ifdef MAC_FAST_FAIL
+// Sondeig de veïns inaccessibles: si n'hi ha un de programat, i l'últim veí sondejat (es sondegen per torns)
+static bool probeScheduled = false;
+static node_address_t lastProbed = NODE_ADDRESS_NULL;
+#endif
+
+// Slot TDMA reservat per transmetre (`MAC_setTxSlot`). Si no n'hi ha, s'accedeix sempre amb CSMA
+static bool hasTxSlot = false;
+static unsigned long txSlotStart = 0;
+static uint32_t txSlotDuration = 0;
+
 // Mètodes per generar i interactuar amb PDU
-static void _preparePDU(mac_pdu_t* pdu, node_address_t rx, const mac_data_t data, size_t length, uint8_t retry = 0, bool isAck = false, const mac_pdu_t * const PDUtoACK = nullptr);
+static void _preparePDU(mac_pdu_t* pdu, node_address_t rx, mac_id_t id, const uint8_t* data, size_t length, bool isAck = false);
+static void _prepareHeader(mac_pdu_t* pdu, node_address_t rx, mac_id_t id, bool isAck = false);
 static void _printPDU(const mac_pdu_t* const pdu);
 static void _set_retry_count(mac_pdu_t* pdu, uint8_t retry);
-static mac_id_t _getRandomID();
-static mac_crc_t _computeCRC(const mac_pdu_t* const pdu);
-static bool _verifyCRC(const mac_pdu_t* const pdu);
+static mac_id_t _getNextSeq();
+static mac_crc_t _computeCRC(const uint8_t* data, size_t length, mac_crc_t crc = 0x00);
+static bool _verifyCRC(const lora_data_t lora, size_t length);
 static bool _is_ack_valid(const mac_pdu_t * const pdu);
-static size_t _PDUtoLora(const mac_pdu_t * const pdu, lora_data_t lora);
-static void _LoraToPDU(const lora_data_t lora, size_t length, mac_pdu_t * pdu);
+#ifdef MAC_IMPLICIT_ACK
+static bool _is_implicit_ack_valid(const mac_pdu_t * const pdu);
+static void _attach_implicit_ack(mac_pdu_t* pdu, bool isMacAvailable);
+#endif
+static bool _needs_ack(const mac_pdu_t * const pdu);
+static bool _uses_rts(const mac_pdu_t * const pdu, bool checkChannel);
+static bool _is_cts_valid(const mac_pdu_t * const pdu);
+static size_t _frame_size(const mac_pdu_t * const pdu);
+static void _record_link_loss(bool rts);
+static bool _is_unreachable(node_address_t addr);
+static void _record_tx_failure(void);
+static void _on_neighbor_heard(node_address_t addr);
+static uint32_t _deaf_ms(node_address_t addr);
+#ifdef MAC_FAST_FAIL
+static void _schedule_probe(void);
+static void _send_probe(void);
+#endif
+#ifdef MAC_PIPELINE
+static uint32_t _exchange_ms(size_t frameSize);
+static uint32_t _pipeline_wait_ms(void);
+#endif
+static bool _is_last_fragment(const mac_pdu_t * const pdu);
+static void _discard_pending_fragments(void);
+static bool _dequeue_tx(void);
+static size_t _PDUtoLora(mac_pdu_t * const pdu, lora_data_t lora);
+static bool _LoraToPDU(const lora_data_t lora, size_t length, mac_pdu_t * pdu);
+static size_t _parseHeader(const uint8_t* lora, size_t length, mac_pdu_t * pdu);
+static bool _can_discard_early(const mac_pdu_t * const pdu);
+static void _on_overheard(const mac_pdu_t * const pdu, size_t length);
 
 // Mètodes i ajudes per FSM
 static void _mac_fsm(mac_event_t e);
@@ -71,18 +170,37 @@ static void _mac_fsm_event_tout_busy(void);
 static void _mac_fsm_event_tx(void);
 static void _mac_fsm_event_duty_timeout(void);
 static void _start_beb_timeout(uint8_t attempt);
+static void _access_channel(void);
 static void _setup_ack_reception(void);
+static void _setup_cts_reception(void);
+static void _finish_unacked_transmission(void);
 static void _apply_duty_cycle_delay();
+static bool _continue_txop(void);
+#ifdef MAC_TXOP
+static void _prepare_txop(bool needsAck);
+#endif
 
 // Mètodes i ajudes per transmissions
-static bool _attempt_transmission(uint8_t retry_count);
+static bool _attempt_transmission(uint8_t retry_count, bool checkChannel = true);
 static mac_err_t _inner_send(node_address_t rx, const mac_data_t data, size_t length, bool isAck = false, const mac_pdu_t * const referedPDU = NULL);
-static mac_err_t _send_pdu(const mac_pdu_t* const pdu);
+static mac_err_t _send_pdu(mac_pdu_t* const pdu, bool checkChannel = true);
 static void _send_ack(const mac_pdu_t * const refPdu);
+static size_t _ack_from_template(const mac_pdu_t * const refPdu, lora_data_t ack);
+static void _prepareAckPDU(mac_pdu_t* pdu, const mac_pdu_t * const refPdu);
+static mac_link_info_t _measured_link_info(void);
+static void _update_link_quality(const mac_pdu_t * const pdu);
+static bool _wait_ifs(void);
+static void _prepareCtrlPDU(mac_pdu_t* pdu, node_address_t rx, mac_id_t id, mac_ctrl_type_t type, uint8_t frameSize);
+static mac_err_t _send_rts(bool checkChannel);
+static bool _send_ctrl_response(const mac_pdu_t * const request, mac_ctrl_type_t type, uint8_t arg);
+static void _send_cts(const mac_pdu_t * const rts);
+static void _send_reserved_data(void);
+static void _on_ctrl_received(const mac_pdu_t * const pdu, bool forSelf);
 
 // Callbacks de capa inferior, i per generar els de superior
 static void _onLoraReceived(void);
 static void _received_mac(void);
+static bool _cut_through(mac_pdu_t* pdu);
 static void _sent_mac(void);
 static void _txError_mac(void);
 
@@ -99,19 +217,29 @@ bool MAC_init(node_address_t selfAddr) {
     }
     
     self = selfAddr;
+    // Si es tornés a començar per 1, els veïns que encara tenen una seqüència propera a la finestra descartarien els
+    // nous frames com a duplicats. Amb un inici aleatori, és poc probable que hi caigui
+    if (esp_reset_reason() != ESP_RST_DEEPSLEEP) {
+        lastTxSeq = esp_random();
+    }
     LoRaRAW_onReceive(_onLoraReceived);
-    _PI("[MAC] Init");
+    MACcont_init();
+    _PI("[MAC] Init (header: %d B, ACK: %d B)", MAC_PDU_HEADER_SIZE, MAC_ACK_FRAME_SIZE);
     return true;
 }
 
 void MAC_deinit() {
     _PI("[MAC] Deinit");
     LoRa_deinit();
-    onSend = onTxFailed = nullptr;
+    MACnb_clear();
+    MACfrag_clear();
+    onSend = onTxFailed = onTxDropped = nullptr;
     onReceive = nullptr;
+    onForward = nullptr;
+    onTransit = nullptr;
 }
 
-mac_err_t MAC_send(node_address_t rx, const mac_data_t data, size_t length, uint16_t* ID) {
+mac_err_t MAC_send(node_address_t rx, const mac_data_t data, size_t length, uint16_t* ID, bool noAck) {
     _PI("[MAC] Preparing to send");
 
     if(length > MAC_MAX_DATA_SIZE) {
@@ -122,18 +250,48 @@ mac_err_t MAC_send(node_address_t rx, const mac_data_t data, size_t length, uint
         _PW("[MAC] RX address (0x%02X) cannot be self (0x%02X)", rx, self);
         return mac_err_t::MAC_ERR_INVALID_ADDR;
     }
+    if(_is_unreachable(rx)) {
+        stats.unreachableFails++;
+        _PW("[MAC] RX address (0x%02X) unreachable", rx);
+        return mac_err_t::MAC_ERR_UNREACHABLE;
+    }
     
-    mac_pdu_t tempPDU;
-    _preparePDU(&tempPDU, rx, data, length, 0, false);
-    _PI("[MAC] PDU ready");
-    _printPDU(&tempPDU);
-
     // Verifiquem aquí i no després de push, ja que sinó sempre serà fals! No canviarà estat de MAC_isAvailable
     // ja que interrupció només estableix un flag, que no es comprova fins que s'executa la tasca (a partir de loop)
     bool isMacAvailable = MAC_isAvailable();
 
-    // No s'utilitzen prioritats (de moment), però per si de cas. Per defecte, baixa
-    MACbuff_pushTx(tempPDU, MACBUFF_PRIORITY_LOW); // Guardem dades a buffer de transmissió
+    mac_pdu_t tempPDU;
+    mac_id_t id = _getNextSeq();
+
+    if (length <= MAC_MAX_FRAME_DATA_SIZE) {
+        _preparePDU(&tempPDU, rx, id, data, length);
+        tempPDU.flags.noAck = noAck;
+        #ifdef MAC_IMPLICIT_ACK
+        _attach_implicit_ack(&tempPDU, isMacAvailable);
+        #endif
+        _PI("[MAC] PDU ready");
+        _printPDU(&tempPDU);
+        // No s'utilitzen prioritats (de moment), però per si de cas. Per defecte, baixa
+        MACbuff_pushTx(tempPDU, MACBUFF_PRIORITY_LOW); // Guardem dades a buffer de transmissió
+    }
+    else {
+        // Fragments consecutius a la cua, amb el mateix ID. Cada un es reconeix (i reintenta) per separat
+        mac_frag_header_t header;
+        header.count = (length + MAC_FRAG_DATA_SIZE - 1) / MAC_FRAG_DATA_SIZE;
+        for (uint8_t i = 0; i < header.count; i++) {
+            header.index = i;
+            size_t offset = i * MAC_FRAG_DATA_SIZE;
+            size_t fragLength = MIN(length - offset, (size_t)MAC_FRAG_DATA_SIZE);
+            _preparePDU(&tempPDU, rx, id, data + offset, 0);
+            tempPDU.flags.frag = 1;
+            tempPDU.flags.noAck = noAck;
+            memcpy(tempPDU.data, &header, MAC_FRAG_HEADER_SIZE);
+            memcpy(tempPDU.data + MAC_FRAG_HEADER_SIZE, data + offset, fragLength);
+            tempPDU.dataLength = MAC_FRAG_HEADER_SIZE + fragLength;
+            MACbuff_pushTx(tempPDU, MACBUFF_PRIORITY_LOW);
+        }
+        _PI("[MAC] PDU ready (%d B in %d fragments)", length, header.count);
+    }
 
     // Només generem esdeveniment si no hi ha transmissió en curs; si n'hi ha, en acabar-ne una ja farà comprovació de cua
     if(isMacAvailable) {
@@ -145,18 +303,20 @@ mac_err_t MAC_send(node_address_t rx, const mac_data_t data, size_t length, uint
     }
     // Guardar ID de PDU a apuntador proporcionat
     if(ID)
-        *ID = tempPDU.id;
+        *ID = id;
 
     return mac_err_t::MAC_SUCCESS;
 }
 
-node_address_t MAC_receive(mac_data_t* data, size_t* length) {
-    mac_pdu_t pdu;
-    MACbuff_popRx(pdu);
-    *length = pdu.dataLength;
-    memcpy(data, pdu.data, pdu.dataLength);
+node_address_t MAC_receive(mac_data_t* data, size_t* length, bool* noAck) {
+    MACbuff_popRx(rxSDU);
+    *length = rxSDU.dataLength;
+    if (noAck) {
+        *noAck = rxSDU.noAck;
+    }
+    memcpy(data, rxSDU.data, rxSDU.dataLength);
     // (*data)[*length] = '\0';
-    return pdu.tx;
+    return rxSDU.tx;
 }
 
 // Retorna missatges pendents de ser "rebuts" per capa superior
@@ -165,93 +325,529 @@ size_t MAC_toReceive() { return MACbuff_getRxSize(); }
 // Només podem enviar si estem en IDLE; si no, hi ha transmissió en curs
 bool MAC_isAvailable() { return fsmState == mac_state_t::IDLE_S && MACbuff_isTxEmpty(); }
 
+void MAC_setTxSlot(unsigned long startMs, uint32_t durationMs) {
+    txSlotStart = startMs;
+    txSlotDuration = durationMs;
+    hasTxSlot = true;
+    _PI("[MAC] TX slot set: %lu ms (+%d ms)", startMs, durationMs);
+}
+
+void MAC_clearTxSlot() { hasTxSlot = false; }
+
+void MAC_setPipeline(unsigned long epochMs, uint8_t hop, uint32_t guardMs) {
+#ifdef MAC_PIPELINE
+    pipelineEpoch = epochMs;
+    pipelinePhaseMs = _exchange_ms(LORA_MAX_SIZE) + guardMs;
+    pipelinePhase = hop % MAC_PIPELINE_PHASES;
+    hasPipeline = true;
+    _PI("[MAC] Pipeline set: phase %d/%d of %d ms, from %lu ms", pipelinePhase, MAC_PIPELINE_PHASES, pipelinePhaseMs, epochMs);
+#else
+    (void)epochMs;
+    (void)hop;
+    (void)guardMs;
+#endif
+}
+
+void MAC_clearPipeline() {
+#ifdef MAC_PIPELINE
+    hasPipeline = false;
+#endif
+}
+
+mac_err_t MAC_announceDeaf(uint32_t durationMs) {
+#ifdef MAC_DEAF_NOTICE
+    // Només fora d'intercanvis propis (esperant ACK o CTS, o backoff) i fora de slots d'altres nodes: si no, l'avís
+    // faria perdre la resposta que s'espera, o col·lisionaria amb el node que té el canal
+    bool otherSlot = hasTxSlot && millis() - txSlotStart >= txSlotDuration;
+    #ifdef MAC_PIPELINE
+    otherSlot = otherSlot || (hasPipeline && _pipeline_wait_ms() > 0);
+    #endif
+    if (fsmState != mac_state_t::IDLE_S || otherSlot) {
+        _PW("[MAC] Deaf notice not sent (MAC busy or outside own slot)");
+        return mac_err_t::MAC_ERR_TX_PENDING;
+    }
+    uint8_t units = MIN((durationMs + MAC_DEAF_UNIT_MS - 1) / MAC_DEAF_UNIT_MS, (uint32_t)UINT8_MAX);
+    mac_pdu_t notice;
+    _prepareCtrlPDU(&notice, NODE_ADDRESS_BROADCAST, _getNextSeq(), MAC_CTRL_DEAF, units);
+    LoRaRAW_setTxPower(LORA_TX_POW);
+    if (_send_pdu(&notice) != MAC_SUCCESS) {
+        _PW("[MAC] Could not send deaf notice (channel busy)");
+        return mac_err_t::MAC_ERR;
+    }
+    stats.deafNoticesSent++;
+    _PI("[MAC] Deaf notice sent (%d ms)", units * MAC_DEAF_UNIT_MS);
+#endif
+    return mac_err_t::MAC_SUCCESS;
+}
+
+mac_stats_t MAC_getStats() { return stats; }
+
+bool MAC_getLinkStats(node_address_t addr, mac_link_stats_t* linkStats) {
+    mac_neighbor_t* nb = MACnb_find(addr);
+    if (nb == nullptr) {
+        return false;
+    }
+    *linkStats = nb->link;
+    return true;
+}
+
+bool MAC_isReachable(node_address_t addr) { return !_is_unreachable(addr); }
+
 void MAC_onReceive(mac_rx_callback_t cb) { onReceive = cb; }
 
 void MAC_onSend(mac_tx_callback_t cb) { onSend = cb; }
 
 void MAC_onTxFailed(mac_tx_callback_t cb) { onTxFailed = cb; }
 
+void MAC_onTxDropped(mac_tx_callback_t cb) { onTxDropped = cb; }
+
+void MAC_onForward(mac_forward_callback_t cb) { onForward = cb; }
+
+void MAC_onTransit(mac_transit_callback_t cb) { onTransit = cb; }
+
 // ============== MÈTODES PRIVATS ==============
 
+// --- MOTOR D'ACK ---
+// Envia l'ACK del frame donat MAC_ACK_IFS_MS després de la fi de la seva recepció, sense CAD: el canal està reservat
+// per l'intercanvi, i un CAD fallit faria perdre l'ACK. Amb un temps de resposta fix, l'emissor pot tenir un timeout ajustat.
+// Els ACK de frames no fragmentats parteixen del frame precalculat pel veí; els de fragments porten el header i es generen sencers
 static void _send_ack(const mac_pdu_t * const refPdu) {
-    mac_pdu_t ackPDU;
-    _preparePDU(&ackPDU, refPdu->tx, (uint8_t*)"", 0, 0, true, refPdu);
+    lora_data_t ack;
+    size_t ackLength = refPdu->flags.frag ? 0 : _ack_from_template(refPdu, ack);
+    if (ackLength == 0) {
+        mac_pdu_t ackPDU;
+        _prepareAckPDU(&ackPDU, refPdu);
+        ackLength = _PDUtoLora(&ackPDU, ack);
+    }
 
     // Establim potència de transmissió de l'ACK segons el nombre de reintents que s'han fet
     // per rebre el frame. No té sentit que quan rebem frame sigui perquè la potència era màxima
     // però que enviem ACK amb potència mínima: receptor probablement NO rebrà ACK així.
-    int power = LORA_TX_POW + (refPdu->flags.retry * MAC_TX_POW_STEP);
-    LoRaRAW_setTxPower(power);
+    // Sense reintents ja és la mínima, i no cal modificar-la
+    bool raisePower = refPdu->flags.retry > 0;
+    if (raisePower) {
+        LoRaRAW_setTxPower(LORA_TX_POW + (refPdu->flags.retry * MAC_TX_POW_STEP));
+    }
 
-    // Enviem ACK
-    _send_pdu(&ackPDU);
+    if (!_wait_ifs()) {
+        stats.acksLate++;
+    }
+    uint32_t turnaround = micros() - LoRaRAW_getLastRxTime();
+    lora_tx_error_t state = LoRaRAW_sendImmediate(ack, ackLength);
 
     // Reestablim potència a la mínima per no afectar següents transmissions
-    LoRaRAW_setTxPower(LORA_TX_POW);
+    if (raisePower) {
+        LoRaRAW_setTxPower(LORA_TX_POW);
+    }
+
+    if (state != lora_tx_error_t::LORA_SUCCESS) {
+        _PW("[MAC] Error sending ACK to 0x%02X", refPdu->tx);
+        return;
+    }
+    stats.txFrames++;
+    stats.txBytes += ackLength;
+    stats.acksSent++;
+    stats.ackTurnaroundSumUs += turnaround;
+    stats.ackTurnaroundMaxUs = MAX(stats.ackTurnaroundMaxUs, turnaround);
+    stats.ackTurnaroundMinUs = stats.acksSent == 1 ? turnaround : MIN(stats.ackTurnaroundMinUs, turnaround);
+    _PI("[MAC] ACK sent to 0x%02X (ID: %d, turnaround: %lu us)", refPdu->tx, refPdu->id, turnaround);
+}
+
+// Genera l'ACK del frame donat a partir del frame precalculat pel veí emissor (creant-lo si cal): només cal copiar-hi
+// l'ID (i la qualitat d'enllaç) i completar el CRC, partint del CRC dels bytes anteriors. Retorna la mida, o 0 si no s'ha pogut obtenir el veí
+static size_t _ack_from_template(const mac_pdu_t * const refPdu, lora_data_t ack) {
+    mac_neighbor_t* nb = MACnb_get(refPdu->tx);
+    if (nb == nullptr) {
+        return 0;
+    }
+    if (!nb->hasAckTemplate) {
+        mac_pdu_t ackPDU;
+        _prepareAckPDU(&ackPDU, refPdu);
+        _PDUtoLora(&ackPDU, ack);
+        memcpy(nb->ackTemplate, ack, MAC_ACK_FRAME_SIZE);
+        nb->ackCrcPrefix = _computeCRC(nb->ackTemplate, MAC_ACK_ID_OFFSET);
+        nb->hasAckTemplate = true;
+    }
+
+    memcpy(ack, nb->ackTemplate, MAC_ACK_FRAME_SIZE);
+    memcpy(&ack[MAC_ACK_ID_OFFSET], &refPdu->id, MAC_ACK_ID_SIZE); // Little-endian: primer byte baix
+#ifdef MAC_ACK_LINK_INFO
+    mac_link_info_t info = _measured_link_info();
+    memcpy(&ack[MAC_ACK_FRAME_SIZE - MAC_CRC_SIZE - MAC_ACK_LINK_INFO_SIZE], &info, MAC_ACK_LINK_INFO_SIZE);
+#endif
+    mac_crc_t crc = _computeCRC(&ack[MAC_ACK_ID_OFFSET], MAC_ACK_FRAME_SIZE - MAC_CRC_SIZE - MAC_ACK_ID_OFFSET, nb->ackCrcPrefix);
+    memcpy(&ack[MAC_ACK_FRAME_SIZE - MAC_CRC_SIZE], &crc, MAC_CRC_SIZE);
+    return MAC_ACK_FRAME_SIZE;
+}
+
+// Prepara l'ACK del frame donat. Si és un fragment, porta el seu header (només el reconeix a ell).
+// Amb MAC_ACK_LINK_INFO, hi afegeix al final la qualitat amb què s'ha rebut el frame
+static void _prepareAckPDU(mac_pdu_t* pdu, const mac_pdu_t * const refPdu) {
+    uint8_t data[MAC_FRAG_HEADER_SIZE + MAC_ACK_LINK_INFO_SIZE];
+    size_t length = 0;
+    if (refPdu->flags.frag) {
+        memcpy(data, refPdu->data, MAC_FRAG_HEADER_SIZE);
+        length += MAC_FRAG_HEADER_SIZE;
+    }
+#ifdef MAC_ACK_LINK_INFO
+    mac_link_info_t info = _measured_link_info();
+    memcpy(&data[length], &info, MAC_ACK_LINK_INFO_SIZE);
+    length += MAC_ACK_LINK_INFO_SIZE;
+#endif
+    _preparePDU(pdu, refPdu->tx, refPdu->id, data, length, true);
+    pdu->flags.frag = refPdu->flags.frag;
+    pdu->flags.noAck = MAC_ACK_LINK_INFO_SIZE > 0; // En ACK, indica que porta qualitat d'enllaç
+}
+
+// Qualitat de l'últim frame rebut, mesurada per la ràdio
+static mac_link_info_t _measured_link_info(void) {
+    mac_link_info_t info;
+    info.rssi = MAX(INT8_MIN, MIN(INT8_MAX, LoRaRAW_getLastRSSI()));
+    info.snr = MAX(INT8_MIN, MIN(INT8_MAX, LoRaRAW_getLastSNR()));
+    return info;
+}
+
+// Actualitza la qualitat de l'enllaç amb l'emissor del frame rebut: la de tornada, la mesurada ara;
+// la d'anada, la que porta l'ACK (si en porta)
+static void _update_link_quality(const mac_pdu_t * const pdu) {
+    mac_neighbor_t* nb = MACnb_get(pdu->tx);
+    if (nb == nullptr) {
+        return;
+    }
+    nb->link.reverse = _measured_link_info();
+    if (pdu->flags.isACK && pdu->flags.noAck && pdu->dataLength >= MAC_ACK_LINK_INFO_SIZE_RX) {
+        memcpy(&nb->link.forward, &pdu->data[pdu->dataLength - MAC_ACK_LINK_INFO_SIZE_RX], MAC_ACK_LINK_INFO_SIZE_RX);
+        nb->link.hasForwardQuality = true;
+    }
+}
+
+// Espera fins a MAC_ACK_IFS_MS després de la fi de l'última recepció, per respondre-hi amb un temps fix.
+// Si el processament ja l'ha superat, no espera. Retorna `false` en aquest cas (resposta tardana)
+static bool _wait_ifs(void) {
+    long remaining = (long)(LoRaRAW_getLastRxTime() + MAC_ACK_IFS_MS * 1000UL - micros());
+    if (remaining > 0) {
+        delayMicroseconds(remaining);
+        return true;
+    }
+    return false;
+}
+
+// --- RTS/CTS ---
+// Prepara un frame de control que fa referència al frame de dades `id`, de mida total `frameSize`
+static void _prepareCtrlPDU(mac_pdu_t* pdu, node_address_t rx, mac_id_t id, mac_ctrl_type_t type, uint8_t frameSize) {
+    uint8_t data[MAC_CTRL_HEADER_SIZE] = { type, frameSize };
+    _preparePDU(pdu, rx, id, data, MAC_CTRL_HEADER_SIZE);
+    pdu->flags.ctrl = 1;
+}
+
+// Envia l'RTS de txPDU, amb CAD (segons `checkChannel`) i la mateixa potència que tindran les dades
+static mac_err_t _send_rts(bool checkChannel) {
+    mac_pdu_t rts;
+    _prepareCtrlPDU(&rts, txPDU.rx, txPDU.id, MAC_CTRL_RTS, _frame_size(&txPDU));
+    rts.flags.retry = txPDU.flags.retry;
+    mac_err_t state = _send_pdu(&rts, checkChannel);
+    if (state == MAC_SUCCESS) {
+        stats.rtsSent++;
+    }
+    return state;
+}
+
+// Respon un frame de control com un ACK: MAC_ACK_IFS_MS després de rebre'l, sense CAD, i amb potència segons els reintents
+static bool _send_ctrl_response(const mac_pdu_t * const request, mac_ctrl_type_t type, uint8_t arg) {
+    mac_pdu_t response;
+    _prepareCtrlPDU(&response, request->tx, request->id, type, arg);
+    lora_data_t frame;
+    size_t length = _PDUtoLora(&response, frame);
+
+    bool raisePower = request->flags.retry > 0;
+    if (raisePower) {
+        LoRaRAW_setTxPower(LORA_TX_POW + (request->flags.retry * MAC_TX_POW_STEP));
+    }
+    _wait_ifs();
+    lora_tx_error_t state = LoRaRAW_sendImmediate(frame, length);
+    if (raisePower) {
+        LoRaRAW_setTxPower(LORA_TX_POW);
+    }
+
+    if (state != lora_tx_error_t::LORA_SUCCESS) {
+        _PW("[MAC] Error sending control frame %d to 0x%02X", type, request->tx);
+        return false;
+    }
+    stats.txFrames++;
+    stats.txBytes += length;
+    return true;
+}
+
+// Respon un RTS amb CTS
+static void _send_cts(const mac_pdu_t * const rts) {
+    if (_send_ctrl_response(rts, MAC_CTRL_CTS, rts->data[1])) {
+        stats.ctsSent++;
+        _PI("[MAC] CTS sent to 0x%02X (ID: %d)", rts->tx, rts->id);
+    }
+}
+
+// Envia txPDU en rebre el CTS, MAC_ACK_IFS_MS després, sense CAD: el receptor ha reservat el canal.
+// La potència ja és la de l'intent en curs. Si no es pot enviar, es tracta com un frame sense ACK
+static void _send_reserved_data(void) {
+    lora_data_t data;
+    size_t dataLen = _PDUtoLora(&txPDU, data);
+    _wait_ifs();
+    if (LoRaRAW_sendImmediate(data, dataLen) == lora_tx_error_t::LORA_SUCCESS) {
+        stats.txFrames++;
+        stats.txBytes += dataLen;
+        _PI("[MAC] Frame sent after CTS, waiting for ACK");
+    }
+    else {
+        _PW("[MAC] Error sending frame after CTS");
+    }
+    _setup_ack_reception();
+}
+
+// Processa un frame de control rebut. Un RTS per nosaltres es respon amb CTS, si el canal no està reservat per
+// un altre intercanvi (les dades hi col·lisionarien); el CTS esperat permet enviar les dades.
+// Els d'altres intercanvis reserven el canal (NAV) fins a l'ACK de les dades, que l'allibera.
+// Els sondejos es responen sempre; la resposta no cal processar-la (qualsevol frame del veí el marca com a accessible).
+// Els avisos d'indisponibilitat (en broadcast) ajornen els frames cap a l'emissor fins que s'acabin
+static void _on_ctrl_received(const mac_pdu_t * const pdu, bool forSelf) {
+    if (pdu->dataLength < MAC_CTRL_HEADER_SIZE) {
+        _PW("[MAC] Malformed control frame from 0x%02X", pdu->tx);
+        return;
+    }
+    mac_ctrl_type_t type = (mac_ctrl_type_t)pdu->data[0];
+
+    if (forSelf) {
+        if (type == MAC_CTRL_RTS && MACcont_isNavActive()) {
+            stats.ctsWithheld++;
+            _PI("[MAC] RTS from 0x%02X not answered (channel reserved)", pdu->tx);
+        }
+        else if (type == MAC_CTRL_RTS) {
+            _send_cts(pdu);
+        }
+        else if (type == MAC_CTRL_CTS && _is_cts_valid(pdu)) {
+            _PI("[MAC] CTS Received from 0x%02X", pdu->tx);
+            _mac_fsm(mac_event_t::RX_CTS_E);
+        }
+        else if (type == MAC_CTRL_PROBE) {
+            if (_send_ctrl_response(pdu, MAC_CTRL_PROBE_REPLY, 0)) {
+                stats.probeRepliesSent++;
+                _PI("[MAC] Probe from 0x%02X answered", pdu->tx);
+            }
+        }
+        else if (type == MAC_CTRL_PROBE_REPLY) {
+            _PI("[MAC] Probe reply from 0x%02X", pdu->tx);
+        }
+        else if (type == MAC_CTRL_DEAF) {
+            mac_neighbor_t* nb = MACnb_get(pdu->tx);
+            if (nb != nullptr) {
+                nb->deafUntil = millis() + pdu->data[1] * MAC_DEAF_UNIT_MS;
+                stats.deafNoticesReceived++;
+                _PI("[MAC] 0x%02X deaf for %d ms", pdu->tx, pdu->data[1] * MAC_DEAF_UNIT_MS);
+            }
+        }
+        else {
+            _PI("[MAC] Unexpected control frame %d from 0x%02X (ID: %d)", type, pdu->tx, pdu->id);
+        }
+        return;
+    }
+
+    // Resta de l'intercanvi: (CTS) + dades + ACK. L'intercanvi és de l'emissor de les dades
+    uint32_t dataMs = LoRaRAW_getTimeOnAir(pdu->data[1]) / 1000;
+    uint32_t ackMs = MAC_ACK_TIMEOUT_FACTOR * LoRaRAW_getTimeOnAir(MAC_ACK_FRAME_SIZE) / 1000;
+    if (type == MAC_CTRL_RTS) {
+        uint32_t ctsMs = LoRaRAW_getTimeOnAir(MAC_CTRL_SIZE) / 1000;
+        MACcont_setNav(pdu->tx, 3 * MAC_ACK_IFS_MS + ctsMs + dataMs + ackMs);
+    }
+    else if (type == MAC_CTRL_CTS) {
+        MACcont_setNav(pdu->rx, 2 * MAC_ACK_IFS_MS + dataMs + ackMs);
+    }
+    else if (type == MAC_CTRL_PROBE) {
+        MACcont_setNav(pdu->tx, MAC_ACK_IFS_MS + MAC_ACK_TIMEOUT_FACTOR * LoRaRAW_getTimeOnAir(MAC_CTRL_SIZE) / 1000);
+    }
 }
 
 // Envia una PDU per LoRa, convertint de PDU a dades lora.
 // Retorna mac_err_t amb l'estat de transmissió
-static mac_err_t _send_pdu(const mac_pdu_t* const pdu) {
+static mac_err_t _send_pdu(mac_pdu_t* const pdu, bool checkChannel) {
     lora_data_t data;
     size_t dataLen = _PDUtoLora(pdu, data);
-    lora_tx_error_t state = LoRaRAW_send(data, dataLen);
+    lora_tx_error_t state = LoRaRAW_send(data, dataLen, checkChannel);
     if (state != lora_tx_error_t::LORA_SUCCESS) {
         return mac_err_t::MAC_ERR;
     }
+    stats.txFrames++;
+    stats.txBytes += dataLen;
     return mac_err_t::MAC_SUCCESS;
 }
 
 // --- GENERACIÓ PDU ---
-// Prepara una PDU a partir dels paràmetres donats
-static void _preparePDU(mac_pdu_t* pdu, node_address_t rx, const mac_data_t data, size_t length, uint8_t retry, bool isAck, const mac_pdu_t * const PDUtoACK) {
+// Prepara una PDU a partir dels paràmetres donats. Si és ACK, `id` ha de ser el del frame que es reconeix
+static void _preparePDU(mac_pdu_t* pdu, node_address_t rx, mac_id_t id, const uint8_t* data, size_t length, bool isAck) {
+    _prepareHeader(pdu, rx, id, isAck);
+    pdu->dataLength = length;
+    memcpy((char*)pdu->data, (char*)data, length);
+}
+
+// Prepara el header d'una PDU enviada per nosaltres, sense modificar-ne les dades
+static void _prepareHeader(mac_pdu_t* pdu, node_address_t rx, mac_id_t id, bool isAck) {
     pdu->tx = self;
     pdu->rx = rx;
-    pdu->id = isAck ? PDUtoACK->id : (retry > 0 ? txPDU.id : _getRandomID()); // si ACK, utilitzem PDU donada; si retry > 0, no modifiquem ID
+    pdu->id = id;
     pdu->flags.isACK = isAck;
-    pdu->flags.retry = retry;
-    pdu->flags.reserved = 0b11111;
-    pdu->dataLength = length;
-    memcpy((char*)pdu->data, (char*)data, length);
-    pdu->crc = _computeCRC(pdu);
+    pdu->flags.retry = 0;
+    pdu->flags.frag = 0;
+    pdu->flags.implicitAck = 0;
+    pdu->flags.noAck = 0;
+    pdu->flags.ctrl = 0;
+    pdu->flags.more = 0;
+    pdu->ackedId = 0;
 }
 
-static size_t _PDUtoLora(const mac_pdu_t * const pdu, lora_data_t lora) {
-    // PDU té el format [TX|RX|ID_H|ID_L|FLAGS|LEN|DATA|...|DATA|RUBISH|...|CRC]
+// Converteix la PDU al format que s'envia per LoRa, calculant-ne el CRC. Retorna la mida total
+static size_t _PDUtoLora(mac_pdu_t * const pdu, lora_data_t lora) {
+    // Format estàndard: [TX|RX|ID_L|ID_H|FLAGS|LEN|DATA|...|DATA|CRC]
+    // Format compacte:  [TX|RX|FLAGS|ID_L|ID_H|DATA|...|DATA|CRC]. Sense LEN; els ACK no porten ID_H
+    // Amb ACK implícit, l'ID reconegut (MAC_ACK_ID_SIZE bytes) va just abans de DATA. LEN no l'inclou
     size_t index = 0;
 
-    // Copiar tota la memòria fins a data
-    size_t size_til_data_end = offsetof(mac_pdu_t, data) + pdu->dataLength;
-    memcpy(&lora[index], pdu, size_til_data_end);
-    index += size_til_data_end;
+    lora[index++] = pdu->tx;
+    lora[index++] = pdu->rx;
+#ifdef COMPACT_HEADERS
+    memcpy(&lora[index], &pdu->flags, sizeof(mac_pdu_flags_t));
+    index += sizeof(mac_pdu_flags_t);
+    memcpy(&lora[index], &pdu->id, pdu->flags.isACK ? MAC_ACK_ID_SIZE : MAC_ID_SIZE); // Little-endian: primer byte baix
+    index += pdu->flags.isACK ? MAC_ACK_ID_SIZE : MAC_ID_SIZE;
+#else
+    memcpy(&lora[index], &pdu->id, sizeof(mac_id_t));
+    index += sizeof(mac_id_t);
+    memcpy(&lora[index], &pdu->flags, sizeof(mac_pdu_flags_t));
+    index += sizeof(mac_pdu_flags_t);
+    lora[index++] = pdu->dataLength;
+#endif
+    if (pdu->flags.implicitAck) {
+        memcpy(&lora[index], &pdu->ackedId, MAC_ACK_ID_SIZE);
+        index += MAC_ACK_ID_SIZE;
+    }
+
+    memcpy(&lora[index], pdu->data, pdu->dataLength);
+    index += pdu->dataLength;
 
-    // Copiar CRC
+    // CRC sobre tots els bytes anteriors
+    pdu->crc = _computeCRC(lora, index);
     memcpy(&lora[index], &pdu->crc, sizeof(mac_crc_t));
+    index += sizeof(mac_crc_t);
 
-    // La mida final de LORA serà la mida de les dades més la mida dels headers/trailers PDU 
-    return pdu->dataLength + MAC_PDU_HEADER_SIZE;
+    return index;
 }
 
-static void _LoraToPDU(const lora_data_t lora, size_t length, mac_pdu_t * pdu) {
-    // LORA té el format [TX|RX|ID_H|ID_L|FLAGS|LEN|DATA|...|DATA|CRC]
-    size_t index = 0;
+// Obté la PDU a partir de les dades rebudes per LoRa (amb CRC ja verificat). Retorna `false` si la mida no és coherent
+static bool _LoraToPDU(const lora_data_t lora, size_t length, mac_pdu_t * pdu) {
+    size_t index = _parseHeader(lora, length, pdu);
+    if (index == 0) {
+        return false;
+    }
 
-    // Copiar header + data sense CRC directament a pdu (segueix mateixa estructura)
-    size_t data_length = length - sizeof(mac_crc_t); 
-    memcpy(pdu, &lora[index], data_length);
-    index += data_length;
+    memcpy(pdu->data, &lora[index], pdu->dataLength);
+    index += pdu->dataLength;
 
     memcpy(&pdu->crc, &lora[index], sizeof(mac_crc_t));
+    return true;
+}
+
+// Obté els camps del header (sense dades ni CRC) d'un frame de `length` bytes. Només en llegeix els primers
+// MAC_HEADER_PEEK_SIZE bytes. Retorna la posició de les dades, o 0 si la mida no és coherent
+static size_t _parseHeader(const uint8_t* lora, size_t length, mac_pdu_t * pdu) {
+    size_t index = 0;
+
+    pdu->tx = lora[index++];
+    pdu->rx = lora[index++];
+#ifdef COMPACT_HEADERS
+    memcpy(&pdu->flags, &lora[index], sizeof(mac_pdu_flags_t));
+    index += sizeof(mac_pdu_flags_t);
+    size_t headerSize = pdu->flags.isACK ? MAC_ACK_SIZE : MAC_PDU_HEADER_SIZE;
+    headerSize += pdu->flags.implicitAck ? MAC_ACK_ID_SIZE : 0;
+    if (length < headerSize) {
+        return 0;
+    }
+    pdu->id = 0;
+    memcpy(&pdu->id, &lora[index], pdu->flags.isACK ? MAC_ACK_ID_SIZE : MAC_ID_SIZE);
+    index += pdu->flags.isACK ? MAC_ACK_ID_SIZE : MAC_ID_SIZE;
+    pdu->dataLength = length - headerSize;
+#else
+    if (length < MAC_PDU_HEADER_SIZE) {
+        return 0;
+    }
+    memcpy(&pdu->id, &lora[index], sizeof(mac_id_t));
+    index += sizeof(mac_id_t);
+    memcpy(&pdu->flags, &lora[index], sizeof(mac_pdu_flags_t));
+    index += sizeof(mac_pdu_flags_t);
+    // Els nodes anteriors als flags `frag`..`more` envien aquests bits (llavors reservats) tots a 1. Cap frame actual
+    // els porta tots (un frame de control no és mai un fragment): es llegeixen a 0, i els seus frames s'entenen igual
+    if (pdu->flags.frag && pdu->flags.implicitAck && pdu->flags.noAck && pdu->flags.ctrl && pdu->flags.more) {
+        pdu->flags.frag = pdu->flags.implicitAck = pdu->flags.noAck = pdu->flags.ctrl = pdu->flags.more = 0;
+    }
+    pdu->dataLength = lora[index++];
+    // Camp de mida ha de coincidir amb la mida real rebuda
+    size_t headerSize = MAC_PDU_HEADER_SIZE + (pdu->flags.implicitAck ? MAC_ACK_ID_SIZE : 0);
+    if (length < headerSize || pdu->dataLength != length - headerSize) {
+        return 0;
+    }
+#endif
+    if (!IS_ADDRESS_VALID(pdu->tx)) {
+        return 0;
+    }
+    pdu->ackedId = 0;
+    if (pdu->flags.implicitAck) {
+        memcpy(&pdu->ackedId, &lora[index], MAC_ACK_ID_SIZE);
+        index += MAC_ACK_ID_SIZE;
+    }
+    return index;
+}
+
+// Indica si un frame es pot descartar només amb el header: no és per nosaltres, ni és de control (l'RTS/CTS d'altres
+// intercanvis en porta la mida a les dades), ni pot ser l'ACK implícit del frame que s'està transmetent
+static bool _can_discard_early(const mac_pdu_t * const pdu) {
+#ifdef MAC_EARLY_DISCARD
+    bool forSelf = pdu->rx == self || (pdu->rx == NODE_ADDRESS_BROADCAST && !pdu->flags.isACK);
+    #ifdef MAC_IMPLICIT_ACK
+    if (_is_implicit_ack_valid(pdu)) {
+        return false;
+    }
+    #endif
+    return !forSelf && !pdu->flags.ctrl;
+#else
+    return false;
+#endif
+}
+
+// Processa un frame d'un altre intercanvi: les dades reserven el canal (NAV) fins a l'ACK, i l'ACK el finalitza
+static void _on_overheard(const mac_pdu_t * const pdu, size_t length) {
+    mac_neighbor_t* nb = MACnb_get(pdu->tx);
+    if (nb != nullptr) {
+        nb->framesOverheard++;
+    }
+    _on_neighbor_heard(pdu->tx);
+
+    if (pdu->flags.isACK) {
+        MACcont_onAckOverheard(pdu->rx);
+    }
+    else if (pdu->flags.ctrl) {
+        _on_ctrl_received(pdu, false);
+    }
+    else if (_needs_ack(pdu)) {
+        long ack_airtime_us = LoRaRAW_getTimeOnAir(MAC_ACK_FRAME_SIZE + (pdu->flags.frag ? MAC_FRAG_HEADER_SIZE : 0));
+        uint32_t ackMs = MAC_ACK_IFS_MS + MAC_ACK_TIMEOUT_FACTOR * ack_airtime_us / 1000;
+        // Amb TXOP, el següent frame s'estima de la mateixa mida
+        uint32_t moreMs = pdu->flags.more ? MAC_ACK_IFS_MS + LoRaRAW_getTimeOnAir(length) / 1000 + ackMs : 0;
+        MACcont_setNav(pdu->tx, ackMs, moreMs);
+    }
 }
 
 // CRC-8/SMBUS: https://www.nongnu.org/avr-libc/user-manual/group__util__crc.html
-static mac_crc_t _computeCRC(const mac_pdu_t* const pdu) {
-    mac_crc_t crc = 0x00;
-    // Posició fins on cal calcular CRC (fins final de dades)
-    size_t data_end_pos = offsetof(mac_pdu_t, data) + pdu->dataLength;
-    for (size_t i = 0; i < data_end_pos; i++)
+// `crc` permet continuar el càlcul a partir del CRC de bytes anteriors
+static mac_crc_t _computeCRC(const uint8_t* data, size_t length, mac_crc_t crc) {
+    for (size_t i = 0; i < length; i++)
     {
-        crc = crc ^ ((char*)pdu)[i];
+        crc = crc ^ data[i];
         for (uint8_t j = 0; j < 8; ++j) {
             if (crc & 0x80) {
                 crc = (crc << 1) ^ MAC_CRC8_POLY;
@@ -263,22 +859,265 @@ static mac_crc_t _computeCRC(const mac_pdu_t* const pdu) {
     return crc;
 }
 
-// Verifica el CRC de la PDU donada, recalculant-lo i comparant amb el rebut
-static bool _verifyCRC(const mac_pdu_t* const pdu) {
-    mac_crc_t expected = _computeCRC(pdu);
-    mac_crc_t obtained = pdu->crc;
+// Verifica el CRC d'un frame rebut per LoRa (últim byte), recalculant-lo sobre la resta de bytes
+static bool _verifyCRC(const lora_data_t lora, size_t length) {
+    mac_crc_t expected = _computeCRC(lora, length - sizeof(mac_crc_t));
+    mac_crc_t obtained;
+    memcpy(&obtained, &lora[length - sizeof(mac_crc_t)], sizeof(mac_crc_t));
     return expected == obtained;
 }
 
-// Genera un identificador aleatori pel frame. Random NO inclou valor màxim (així entre [1, 2^n-1])
-static mac_id_t _getRandomID() { return (mac_id_t)random(1, (1 << (8 * sizeof(mac_id_t)))); }
+// Genera l'identificador del frame: una seqüència creixent, de forma que els veïns puguin detectar duplicats
+// amb una finestra. El 0 no s'utilitza mai (reservat per capes superiors per identificar paquets LoRaWAN)
+static mac_id_t _getNextSeq() {
+    if (++lastTxSeq == 0) {
+        lastTxSeq = 1;
+    }
+    return lastTxSeq;
+}
 
 // Verifica si l'ACK de la PDU donada és vàlid
 // És vàlid si té flag d'ACK, el transmisor és el receptor de l'últim que hem enviat
-// i l'ID del frame és l'ID de la trama que s'està transmetent
+// i l'ID del frame és l'ID de la trama que s'està transmetent (només els bytes que porta l'ACK)
+// Si s'està transmetent un fragment, l'ACK ha de portar el mateix header de fragment
 // A més, és necessari que l'estat de capa MAC sigui esperant ACK
 static bool _is_ack_valid(const mac_pdu_t * const pdu) {
-    return pdu->flags.isACK && pdu->tx == txPDU.rx && pdu->id == txPDU.id && fsmState == mac_state_t::WAIT_ACK_S;
+    const mac_id_t idMask = (mac_id_t)((1UL << (8 * MAC_ACK_ID_SIZE)) - 1);
+    bool fragMatches = pdu->flags.frag == txPDU.flags.frag &&
+        (!txPDU.flags.frag || (pdu->dataLength >= MAC_FRAG_HEADER_SIZE && pdu->data[0] == txPDU.data[0]));
+    return pdu->flags.isACK && pdu->tx == txPDU.rx && (pdu->id & idMask) == (txPDU.id & idMask) && fragMatches && fsmState == mac_state_t::WAIT_ACK_S;
+}
+
+#ifdef MAC_IMPLICIT_ACK
+// Verifica si la PDU escoltada és el reenviament de txPDU pel seu receptor (ACK implícit). Els fragments
+// sempre es reconeixen amb ACK explícit (només es reenvien un cop reassemblats)
+static bool _is_implicit_ack_valid(const mac_pdu_t * const pdu) {
+    const mac_id_t idMask = (mac_id_t)((1UL << (8 * MAC_ACK_ID_SIZE)) - 1);
+    return pdu->flags.implicitAck && !pdu->flags.isACK && pdu->tx == txPDU.rx && !txPDU.flags.frag &&
+        (pdu->ackedId & idMask) == (txPDU.id & idMask) && fsmState == mac_state_t::WAIT_ACK_S;
+}
+
+// Afegeix a la PDU l'ACK implícit del frame pendent de reconèixer, si n'hi ha. Només si s'enviarà immediatament
+// (MAC lliure) i a un altre node (l'emissor anterior l'ha d'escoltar com a reenviament), i si hi cap
+static void _attach_implicit_ack(mac_pdu_t* pdu, bool isMacAvailable) {
+    if (!implicitAckPending || !isMacAvailable || pdu->rx == NODE_ADDRESS_BROADCAST || pdu->rx == implicitAckRef.tx ||
+        pdu->dataLength + MAC_ACK_ID_SIZE > MAC_MAX_FRAME_DATA_SIZE) {
+        return;
+    }
+    pdu->flags.implicitAck = 1;
+    pdu->ackedId = implicitAckRef.id;
+    implicitAckPending = false;
+    stats.implicitAcksSent++;
+    _PI("[MAC] Implicit ACK for ID %d from 0x%02X", implicitAckRef.id, implicitAckRef.tx);
+}
+#endif
+
+// Indica si la PDU donada s'ha de reconèixer amb ACK. Els broadcast no tenen un únic receptor, i no es reconeixen;
+// tampoc els frames d'entrega sense garanties, ni els de control (l'RTS es respon amb CTS)
+static bool _needs_ack(const mac_pdu_t * const pdu) {
+    return !pdu->flags.isACK && !pdu->flags.noAck && !pdu->flags.ctrl && pdu->rx != NODE_ADDRESS_BROADCAST;
+}
+
+// Indica si la PDU donada s'ha d'enviar amb RTS/CTS: frames amb ACK prou llargs, fora del slot TDMA propi
+// (sense `checkChannel`, el canal ja és exclusiu)
+static bool _uses_rts(const mac_pdu_t * const pdu, bool checkChannel) {
+#ifdef MAC_RTS_CTS
+    return checkChannel && _needs_ack(pdu) && _frame_size(pdu) >= MAC_RTS_THRESHOLD;
+#else
+    (void)pdu;
+    (void)checkChannel;
+    return false;
+#endif
+}
+
+// Verifica si el CTS rebut respon l'RTS de txPDU. Ha de venir del receptor, amb el seu ID, i amb MAC esperant CTS
+static bool _is_cts_valid(const mac_pdu_t * const pdu) {
+    return pdu->tx == txPDU.rx && pdu->id == txPDU.id && fsmState == mac_state_t::WAIT_CTS_S;
+}
+
+// Mida total que ocupa la PDU enviada per LoRa
+static size_t _frame_size(const mac_pdu_t * const pdu) {
+    return MAC_PDU_HEADER_SIZE + (pdu->flags.implicitAck ? MAC_ACK_ID_SIZE : 0) + pdu->dataLength;
+}
+
+#ifdef MAC_PIPELINE
+// Durada d'un intercanvi complet d'un frame de la mida donada: transmissió, i espera màxima de l'ACK (i RTS/CTS, si cal)
+static uint32_t _exchange_ms(size_t frameSize) {
+    uint32_t ms = LoRaRAW_getTimeOnAir(frameSize) / 1000 + MAC_ACK_IFS_MS + MAC_ACK_TIMEOUT_FACTOR * LoRaRAW_getTimeOnAir(MAC_ACK_FRAME_SIZE) / 1000;
+#ifdef MAC_RTS_CTS
+    if (frameSize >= MAC_RTS_THRESHOLD) {
+        ms += MAC_ACK_IFS_MS + 2 * LoRaRAW_getTimeOnAir(MAC_CTRL_SIZE) / 1000;
+    }
+#endif
+    return ms;
+}
+
+// Temps fins que txPDU es pot començar a transmetre segons el pipeline: 0 si som a la fase pròpia i l'intercanvi
+// hi cap sencer; si no, fins a l'inici de la següent fase pròpia
+static uint32_t _pipeline_wait_ms(void) {
+    uint32_t period = MAC_PIPELINE_PHASES * pipelinePhaseMs;
+    uint32_t start = pipelinePhase * pipelinePhaseMs;
+    long elapsed = (long)(millis() - pipelineEpoch);
+    if (elapsed < 0) {
+        return -elapsed + start;
+    }
+    uint32_t position = elapsed % period;
+    if (position >= start && position + _exchange_ms(_frame_size(&txPDU)) <= start + pipelinePhaseMs) {
+        return 0;
+    }
+    return position < start ? start - position : start + period - position;
+}
+#endif
+
+// Registra a l'enllaç cap al receptor de txPDU un intent sense resposta (sense ACK, o sense CTS si `rts`)
+static void _record_link_loss(bool rts) {
+    mac_neighbor_t* nb = MACnb_get(txPDU.rx);
+    if (nb == nullptr) {
+        return;
+    }
+    nb->link.txNoAck++;
+    nb->link.ctsTimeouts += rts;
+    nb->link.lostAirtimeMs += LoRaRAW_getTimeOnAir(rts ? MAC_CTRL_SIZE : _frame_size(&txPDU)) / 1000;
+}
+
+// --- ACCESSIBILITAT DE VEÏNS ---
+// Indica si el veí està marcat com a inaccessible (MAC_FAST_FAIL)
+static bool _is_unreachable(node_address_t addr) {
+#ifdef MAC_FAST_FAIL
+    mac_neighbor_t* nb = MACnb_find(addr);
+    return nb != nullptr && nb->link.unreachable;
+#else
+    return false;
+#endif
+}
+
+// Registra que txPDU ha esgotat reintents. Amb MAC_FAST_FAIL_THRESHOLD frames seguits, el receptor es marca com a inaccessible
+static void _record_tx_failure(void) {
+    mac_neighbor_t* nb = MACnb_get(txPDU.rx);
+    if (nb == nullptr) {
+        return;
+    }
+    if (nb->link.consecutiveFails < UINT8_MAX) {
+        nb->link.consecutiveFails++;
+    }
+#ifdef MAC_FAST_FAIL
+    if (!nb->link.unreachable && nb->link.consecutiveFails >= MAC_FAST_FAIL_THRESHOLD) {
+        nb->link.unreachable = true;
+        stats.neighborsDown++;
+        _PW("[MAC] Neighbor 0x%02X unreachable after %d failed frames", txPDU.rx, nb->link.consecutiveFails);
+        _schedule_probe();
+    }
+#endif
+}
+
+// Temps que el veí ha anunciat que no pot rebre (MAC_CTRL_DEAF), en ms. 0 si pot rebre
+static uint32_t _deaf_ms(node_address_t addr) {
+    mac_neighbor_t* nb = MACnb_find(addr);
+    if (nb == nullptr) {
+        return 0;
+    }
+    long remaining = (long)(nb->deafUntil - millis());
+    return remaining > 0 ? remaining : 0;
+}
+
+// Qualsevol frame rebut d'un veí (per nosaltres o no) indica que és accessible
+static void _on_neighbor_heard(node_address_t addr) {
+    mac_neighbor_t* nb = MACnb_find(addr);
+    if (nb == nullptr) {
+        return;
+    }
+    nb->link.consecutiveFails = 0;
+    if (nb->link.unreachable) {
+        nb->link.unreachable = false;
+        stats.neighborsUp++;
+        _PI("[MAC] Neighbor 0x%02X reachable again", addr);
+    }
+}
+
+#ifdef MAC_FAST_FAIL
+static void _schedule_probe(void) {
+    if (!probeScheduled) {
+        probeScheduled = true;
+        scheduler_once(_send_probe, MAC_PROBE_INTERVAL_MS);
+    }
+}
+
+// Envia un sondeig al següent veí inaccessible, a potència màxima (la resposta també ho serà, pel camp de reintents).
+// Només amb MAC lliure, i amb CAD: si el canal està ocupat, s'espera al següent interval. Es programa mentre en quedin
+static void _send_probe(void) {
+    probeScheduled = false;
+    node_address_t addr = MACnb_nextUnreachable(lastProbed);
+    if (addr == NODE_ADDRESS_NULL) {
+        return;
+    }
+    if (fsmState == mac_state_t::IDLE_S && !MACcont_isNavActive()) {
+        lastProbed = addr;
+        mac_pdu_t probe;
+        _prepareCtrlPDU(&probe, addr, _getNextSeq(), MAC_CTRL_PROBE, 0);
+        probe.flags.retry = MAC_MAX_RETRIES;
+        LoRaRAW_setTxPower(LORA_MAX_TX_POW);
+        if (_send_pdu(&probe) == MAC_SUCCESS) {
+            stats.probesSent++;
+            _PI("[MAC] Probe sent to unreachable 0x%02X", addr);
+        }
+        LoRaRAW_setTxPower(LORA_TX_POW);
+        LoRaRAW_startReceiving();
+    }
+    _schedule_probe();
+}
+#endif
+
+// Indica si la PDU és l'últim fragment del seu frame (o si no va fragmentada)
+static bool _is_last_fragment(const mac_pdu_t * const pdu) {
+    if (!pdu->flags.frag) {
+        return true;
+    }
+    mac_frag_header_t header = MACfrag_getHeader(pdu);
+    return header.index == header.count - 1;
+}
+
+// Descarta de la cua de TX els fragments pendents del frame de txPDU. Si un fragment ha esgotat reintents,
+// el receptor no podrà reassemblar el frame, i no té sentit enviar-ne la resta
+static void _discard_pending_fragments(void) {
+    if (!txPDU.flags.frag) {
+        return;
+    }
+    mac_pdu_t next;
+    size_t discarded = 0;
+    while (MACbuff_peekTx(next) != MACBUFF_PRIORITY_NONE && next.flags.frag && next.rx == txPDU.rx && next.id == txPDU.id) {
+        MACbuff_popTx(next);
+        discarded++;
+    }
+    if (discarded > 0) {
+        _PW("[MAC] Discarded %d pending fragments of ID %d", discarded, txPDU.id);
+    }
+}
+
+// Obté a txPDU el següent frame de la cua de TX, descartant els que hi han estat massa temps (AQM).
+// Els fragments només es descarten si són el primer: un cop enviat el primer, s'envia el frame sencer.
+// Els frames a veïns inaccessibles (MAC_FAST_FAIL) fallen sense intentar-ho.
+// Retorna `false` si no queda cap frame a enviar
+static bool _dequeue_tx(void) {
+    unsigned long enqueuedAt;
+    while (MACbuff_popTx(txPDU, &enqueuedAt) != MACBUFF_PRIORITY_NONE) {
+        bool startsFrame = !txPDU.flags.frag || MACfrag_getHeader(&txPDU).index == 0;
+        bool unreachable = _is_unreachable(txPDU.rx);
+        if (!unreachable && (!startsFrame || !MACaqm_shouldDrop(millis() - enqueuedAt, MACbuff_isTxEmpty()))) {
+            deafRetriesCounted = false;
+            return true;
+        }
+        if (unreachable) {
+            stats.unreachableFails++;
+            _PW("[MAC] Frame %d dropped, 0x%02X unreachable", txPDU.id, txPDU.rx);
+        }
+        // Els descartats per congestió (AQM) es notifiquen a part: no indiquen cap problema amb el receptor
+        mac_tx_callback_t notify = unreachable || onTxDropped == nullptr ? onTxFailed : onTxDropped;
+        if (notify != nullptr) {
+            notify(txPDU.id);
+        }
+        _discard_pending_fragments();
+    }
+    return false;
 }
 
 /* *************************** */
@@ -290,95 +1129,222 @@ static void _onLoraReceived(void) {
         Callback executat quan es produeix una recepció a capa inferior LoRa.
         1. Obté dades de capa inferior
         2. Verifica CRC. Si no és vàlid, descarta.
-        3. Comprova si s'ha rebut anteriorment aquest frame (per ID)
+        3. Comprova si s'ha rebut anteriorment aquest frame (per emissor i seqüència)
             3.1.1. Si no s'ha rebut, verifica si és un ACK (ja que si és ACK implícit no serem els recepetors directament)
             3.1.2. Si no és ACK, verifica si és per nosaltres. Si no ho és, descarta; 
-            3.1.3. Si és per nosaltres, afegeix ID a cua d'últims IDs vists, i executa _received_mac() per avisar capa superior
+            3.1.3. Si és per nosaltres (o broadcast), marca seqüència a finestra de l'emissor, i executa _received_mac() per avisar capa superior.
+                   Els frames broadcast no es reconeixen mai amb ACK
             3.1.4. Si és ACK, avisa a FSM de la recepció d'ACK. No guarda ID cua d'últimes recepcions, 
                    no es poden repetir recepcions d'ACK i només ompliria la llista amb IDs innecessaris
             
             3.2.1. Si s'ha rebut anteriorment és perquè eren dades i per nosaltres.
                    El motiu de la re-recepció és que el transmissor no ha rebut ACK, o no el vam poder enviar.
             3.2.2. Intenta enviar un ACK explícit, amb adreça de receptor nul·la (0x00), l'ID que el TX espera
-                   i el flag isAck establert.
+                   i el flag isAck establert. Si és broadcast o sense ACK, és una repetició cega i només es descarta.
+        4. Els fragments no es marquen a la finestra fins que el frame s'ha reassemblat (comparteixen ID).
+           Cada fragment es reconeix per separat; si no hi ha espai per reassemblar-lo, no es reconeix
+           i l'emissor el tornarà a intentar.
+        5. Amb MAC_IMPLICIT_ACK, un frame del receptor de txPDU que en porta l'ID és el seu reenviament (ACK implícit),
+           encara que no sigui per nosaltres. En rebre dades que capa superior reenviarà (`MAC_onTransit`), l'ACK explícit
+           s'ajorna fins després de notificar-la, i només s'envia si no l'ha reenviat; la resta es reconeixen abans de
+           lliurar-les (si és repetit, s'envia sempre: el reenviament no s'ha escoltat).
+        6. Amb MAC_NAV, els frames de dades per altres nodes reserven el canal fins al seu ACK, i l'ACK allibera la reserva.
+        7. Els frames de control (RTS/CTS) no es marquen a la finestra ni es lliuren a capa superior: l'RTS per nosaltres
+           es respon amb CTS, i els d'altres intercanvis també reserven el canal fins a l'ACK.
+        8. Amb MAC_EARLY_DISCARD, abans del pas 1 només es llegeix el header: els frames d'altres intercanvis que no calen
+           sencers (punts 5 i 7) es descarten sense llegir-ne les dades, i només alimenten el NAV (punt 6).
+        9. Amb callback de reenviament (`MAC_onForward`), els frames de dades (no broadcast ni fragmentats) que capa
+           superior indica que són per un altre node s'afegeixen directament a la cua de TX, sense lliurar-los (cut-through).
     */
     _PI("[MAC] Frame rcv");
 
     lora_data_t data;
     size_t len;
-    if(!LoRaRAW_receive(data, &len)) {
+    mac_pdu_t receivedPDU;
+
+    // Primer només el header: els frames d'altres intercanvis es descarten sense transferir-ne les dades
+    if(!LoRaRAW_receiveHeader(data, MAC_HEADER_PEEK_SIZE, &len)) {
         _PW("[MAC] Recieve ERR");
         return;
     }
 
-    // Per ser vàlid mínim a de tenir la mida del header, sense dades, que seria un ACK
-    if(len < MAC_PDU_HEADER_SIZE) {
+    // Per ser vàlid mínim a de tenir la mida d'un ACK (header sense dades)
+    if(len < MAC_ACK_SIZE) {
         _PW("[MAC] Frame too short (%d)", len);
+        LoRaRAW_discard();
         return;
     }
 
-    mac_pdu_t receivedPDU;
+    if(_parseHeader(data, len, &receivedPDU) == 0) {
+        _PW("[MAC] Malformed frame (%d B)", len);
+        LoRaRAW_discard();
+        return;
+    }
 
-    _LoraToPDU(data, len, &receivedPDU);
+    if (_can_discard_early(&receivedPDU)) {
+        LoRaRAW_discard();
+        stats.earlyDiscards++;
+        stats.earlyDiscardBytes += len - MIN(len, (size_t)MAC_HEADER_PEEK_SIZE);
+        _PI("[MAC] Frame not for self (rx=0x%02X), discarded from header", receivedPDU.rx);
+        _on_overheard(&receivedPDU, len);
+        return;
+    }
 
-    if(!_verifyCRC(&receivedPDU)) {
-        CRCErrors++;
-        _PW("[MAC] CRC error (%d)", CRCErrors);
-        DUMP_ARRAY(&receivedPDU, len);
+    if(!LoRaRAW_receive(data, &len)) {
+        _PW("[MAC] Recieve ERR");
+        return;
+    }
+
+    if(!_verifyCRC(data, len)) {
+        stats.CRCErrors++;
+        _PW("[MAC] CRC error (%d)", stats.CRCErrors);
+        DUMP_ARRAY(data, len);
+        return;
+    }
+
+    if(!_LoraToPDU(data, len, &receivedPDU)) {
+        _PW("[MAC] Malformed frame (%d B)", len);
         return;
     }
     
-    _PI("Received valid PDU from LORA");
-    _printPDU(&receivedPDU);
-    
+    #ifdef MAC_IMPLICIT_ACK
+    if (_is_implicit_ack_valid(&receivedPDU)) {
+        stats.implicitAcksReceived++;
+        _PI("[MAC] Implicit ACK from 0x%02X (forwarded to 0x%02X)", receivedPDU.tx, receivedPDU.rx);
+        _mac_fsm(mac_event_t::RX_ACK_E);
+    }
+    #endif
+
     mac_id_t rcvID = receivedPDU.id;
-    bool seen = lastFramesIDs.contains(rcvID);
+    bool isBroadcast = receivedPDU.rx == NODE_ADDRESS_BROADCAST && !receivedPDU.flags.isACK;
+    bool forSelf = receivedPDU.rx == self || isBroadcast;
+    bool needsAck = _needs_ack(&receivedPDU);
+    // Els ACK no es marquen mai a la finestra (porten la seqüència del frame que reconeixen), i per tant no es filtren
+    bool seen = !receivedPDU.flags.isACK && !receivedPDU.flags.ctrl && forSelf && MACnb_isDuplicate(receivedPDU.tx, rcvID);
 
     if (seen) { // Si ja l'hem vist abans és perquè era un frame per nosaltres -> enviar ACK sense notificar
-        _PI("[MAC] ID already received: %d", rcvID);
-        _send_ack(&receivedPDU);
+        stats.duplicates++;
+        mac_neighbor_t* nb = MACnb_find(receivedPDU.tx);
+        nb->duplicates++;
+        _PI("[MAC] ID already received: %d (0x%02X: %d dup / %d rcv)", rcvID, receivedPDU.tx, nb->duplicates, nb->framesReceived);
+        if (needsAck) {
+            _send_ack(&receivedPDU);
+        }
     }
-    else if (receivedPDU.rx == self) {
+    else if (forSelf) {
         if (_is_ack_valid(&receivedPDU)) { // Si és ACK, generem esdeveniment a FSM; no s'ha d'enviar ACK
             _PI("[MAC] ACK Received from 0x%02X", receivedPDU.tx);
+            _update_link_quality(&receivedPDU);
             _mac_fsm(mac_event_t::RX_ACK_E);
         }
-        else { // Si no és ACK, són dades
-            lastFramesIDs.enqueue(rcvID);
-            framesReceived++;
-            _PI("[MAC] Frame for higher layer");
+        else if (receivedPDU.flags.isACK) { // ACK que no esperàvem (arriba tard, o ID no correspon); no són dades
+            _PI("[MAC] Unexpected ACK from 0x%02X (ID: %d)", receivedPDU.tx, rcvID);
+        }
+        else if (receivedPDU.flags.ctrl) { // RTS/CTS: no es lliuren a capa superior
+            _on_ctrl_received(&receivedPDU, true);
+        }
+        else if (receivedPDU.flags.frag) { // Fragment: s'afegeix a reassemblatge
+            stats.reassemblyTimeouts += MACfrag_purgeExpired();
+            mac_frag_result_t result = MACfrag_add(&receivedPDU, &rxSDU);
+            if (result == MACFRAG_ERR_INVALID) {
+                return;
+            }
+            if (result == MACFRAG_ERR_NO_MEMORY) {
+                stats.reassemblyDrops++;
+                return;
+            }
 
-            _send_ack(&receivedPDU); // Enviar ACK explícit 
+            stats.fragmentsReceived++;
+            if (needsAck) {
+                _send_ack(&receivedPDU);
+            }
+            if (result == MACFRAG_COMPLETE) {
+                if (!MACnb_markReceived(receivedPDU.tx, rcvID)) {
+                    stats.outOfWindow++;
+                }
+                stats.framesReceived++;
+                stats.reassembled++;
+                rxSDU.noAck = receivedPDU.flags.noAck;
+                _PI("[MAC] Reassembled frame for higher layer%s", isBroadcast ? " (broadcast)" : "");
+                MACbuff_pushRx(rxSDU, MACBUFF_PRIORITY_LOW);
+                _received_mac();
+            }
+        }
+        else { // Si no és ACK, són dades
+            if (!MACnb_markReceived(receivedPDU.tx, rcvID)) {
+                stats.outOfWindow++;
+            }
+            stats.framesReceived++;
+            _PI("[MAC] Frame for higher layer%s", isBroadcast ? " (broadcast)" : "");
+
+            #ifdef MAC_IMPLICIT_ACK
+            // L'ACK només s'ajorna si capa superior reenviarà el frame ara mateix: el reenviament ja el reconeix.
+            // Si no, s'envia abans de lliurar-lo, amb el temps de resposta fix, sense esperar que es processi
+            implicitAckPending = needsAck && !isBroadcast && MAC_isAvailable() && onTransit != nullptr &&
+                onTransit(receivedPDU.data, receivedPDU.dataLength, receivedPDU.tx);
+            implicitAckRef = receivedPDU;
+            if (needsAck && !implicitAckPending) {
+                _send_ack(&receivedPDU);
+            }
+            #else
+            if (needsAck) {
+                _send_ack(&receivedPDU); // Enviar ACK explícit 
+            }
+            #endif
             
-            // Prioritats no utilitzades (de moment) per res; per defecte a baixa
-            MACbuff_pushRx(receivedPDU, MACBUFF_PRIORITY_LOW); // Guardar recepció a buffer
+            unsigned long start = micros();
+            if (!isBroadcast && _cut_through(&receivedPDU)) { // Per un altre node: ja és a la cua de TX
+                stats.cutThroughFrames++;
+                stats.cutThroughSumUs += micros() - start;
+            }
+            else {
+                rxSDU.tx = receivedPDU.tx;
+                rxSDU.noAck = receivedPDU.flags.noAck;
+                rxSDU.dataLength = receivedPDU.dataLength;
+                memcpy(rxSDU.data, receivedPDU.data, receivedPDU.dataLength);
+                // Prioritats no utilitzades (de moment) per res; per defecte a baixa
+                MACbuff_pushRx(rxSDU, MACBUFF_PRIORITY_LOW); // Guardar recepció a buffer
+
+                _received_mac(); // Notificar capa superior de nova recepció
+                stats.deliveredFrames++;
+                stats.deliverySumUs += micros() - start;
+            }
 
-            _received_mac(); // Notificar capa superior de nova recepció
+            #ifdef MAC_IMPLICIT_ACK
+            if (implicitAckPending) { // Finalment no s'ha reenviat (error en reenviar-lo): ACK explícit, tard
+                implicitAckPending = false;
+                _send_ack(&implicitAckRef);
+            }
+            #endif
         }
     }
     else {
         _PI("[MAC] Frame not for self (rx=0x%02X)", receivedPDU.rx);
+        _on_overheard(&receivedPDU, len);
+    }
+
+    // La qualitat de tornada també es guarda al final, per no endarrerir l'ACK (la dels ACK ja s'ha guardat)
+    if (!receivedPDU.flags.isACK) {
+        _update_link_quality(&receivedPDU);
+    }
+    if (forSelf) { // Els d'altres intercanvis ja s'han comptat a `_on_overheard`
+        _on_neighbor_heard(receivedPDU.tx);
     }
+
+    // Es mostra al final per no endarrerir l'ACK
+    _PI("Received valid PDU from LORA");
+    _printPDU(&receivedPDU);
 }
 
 /* *************************** */
 /* *   MÀQUINA ESTATS MAC    * */
 /* *************************** */
 static void _mac_fsm(mac_event_t e) {
-    // Obtenim estat canal per poder-ho utilitzar com a esdeveniment (aplicar beb)
-    lora_event_t lora_e = (lora_event_t)LoRaRAW_isAvailable();
-    
     switch (fsmState) {
         case IDLE_S:
-            if (e == TX_E && !MACbuff_isTxEmpty()) {
-                MACbuff_popTx(txPDU);
+            if (e == TX_E && _dequeue_tx()) {
                 currentTxRetry = 0; 
-                if (lora_e == IDLE_E) {
-                    _attempt_transmission(currentTxRetry);
-                } else { // Channel busy
-                    _PI("[MAC] Channel busy for retry, applying BEB");
-                    _start_beb_timeout(currentBEBRetry++);
-                }
+                _access_channel();
             } else if (e == TX_E) {
                 _PI("[MAC] TX requested but queue empty");
                 LoRaRAW_startReceiving();
@@ -387,41 +1353,56 @@ static void _mac_fsm(mac_event_t e) {
             
         case WAIT_CHAN_FREE_S:
             if (e == TOUT_BUSY_E) {
-                if (lora_e == IDLE_E) {
-                    _PI("[MAC] Channel now free after BEB, attempting transmission");
-                    _attempt_transmission(currentTxRetry);
-                } else { // Canal ocupat, apliquem BEB de nou
-                    _PI("[MAC] Channel still busy after BEB timeout, retrying BEB");
-                    _start_beb_timeout(currentBEBRetry++);
-                }
+                _access_channel();
             }
             break;
             
+        case WAIT_CTS_S:
+            if (e == RX_CTS_E) {
+                scheduler_stop(txTimeoutTask);
+                _send_reserved_data();
+                break;
+            }
+            // Sense CTS, es tracta com un frame sense ACK (col·lisió de l'RTS, o receptor amb canal reservat)
+            [[fallthrough]];
         case WAIT_ACK_S:
             if (e == RX_ACK_E) {
                 _PI("[MAC] ACK received");
                 scheduler_stop(txTimeoutTask);
-                succeededTransmissions++; // si rebem ack és perquè ja eren dades
+                MACcont_onTxSuccess();
+                stats.succeededTransmissions++; // si rebem ack és perquè ja eren dades
                 _sent_mac();  //  @todo; IMPORTANT SI TEMPS MOLT ELEVAT, EXECUTAR AMB SCHEDULER!
-                _apply_duty_cycle_delay();
+                if (!_continue_txop()) {
+                    _apply_duty_cycle_delay();
+                }
+            } else if (e == TOUT_ACK_E && _deaf_ms(txPDU.rx) > 0) {
+                // El receptor ha anunciat que no pot rebre durant l'intercanvi: no és col·lisió, ni compta com a intent
+                _PI("[MAC] %s timeout, receiver deaf", fsmState == WAIT_CTS_S ? "CTS" : "ACK");
+                currentTxRetry--;
+                #ifdef MAC_TXOP
+                txopActive = false;
+                #endif
+                _access_channel();
             } else if (e == TOUT_ACK_E) {
-                _PI("[MAC] ACK timeout");
+                _PI("[MAC] %s timeout", fsmState == WAIT_CTS_S ? "CTS" : "ACK");
+                MACcont_onTxCollision();
+                _record_link_loss(fsmState == WAIT_CTS_S);
+                #ifdef MAC_TXOP
+                txopActive = false; // El reintent torna a competir pel canal
+                #endif
                 // Comprovar si s'ha arribat a màxim de reintents
                 if (currentTxRetry > MAC_MAX_RETRIES) {
                     _PW("[MAC] Max retries (%d) reached, transmission failed", MAC_MAX_RETRIES);
+                    _record_tx_failure();
                     _txError_mac();
+                    _discard_pending_fragments();
                     _apply_duty_cycle_delay();
                 } else {
                     // Encara queden reintents
                     _PI("[MAC] Retry %d/%d", currentTxRetry, MAC_MAX_RETRIES);
                     
-                    // Enviar o aplicar BEB segons estat canal
-                    if (lora_e == IDLE_E) {
-                        _attempt_transmission(currentTxRetry);
-                    } else { // Channel busy
-                        _PI("[MAC] Channel busy for retry, moving to WAIT_CHAN_FREE");
-                        _start_beb_timeout(currentBEBRetry++);
-                    }
+                    // Enviar o aplicar backoff segons estat canal
+                    _access_channel();
                 }
             }
             break;
@@ -457,30 +1438,113 @@ static void _apply_duty_cycle_delay() {
     #endif
 }
 
-// Mètode d'ajuda per establir valor de reintents, recalculant CRC
+// TXOP: després de l'ACK, envia el següent frame de la cua MAC_ACK_IFS_MS després, sense tornar a competir pel canal
+// (sense CAD, backoff ni RTS). Només si el frame reconegut ho anunciava (flag `more`): els veïns mantenen el NAV.
+// Si el següent frame és per un altre receptor, només se salta l'accés al canal si aquest pot rebre (sense avís
+// MAC_CTRL_DEAF) i no hi ha cap reserva escoltada (NAV); si no, torna a competir amb `_access_channel()`.
+// Retorna `false` si la TXOP s'ha acabat, i cal tornar a IDLE
+static bool _continue_txop(void) {
+#ifdef MAC_TXOP
+    node_address_t txopRx = txPDU.rx;
+    if (!txPDU.flags.more || !_dequeue_tx()) {
+        txopActive = false;
+        return false;
+    }
+    if (txPDU.rx != txopRx && (_deaf_ms(txPDU.rx) > 0 || MACcont_isNavActive())) {
+        _PI("[MAC] TXOP ended: 0x%02X deaf or channel reserved", txPDU.rx);
+        txopActive = false;
+        currentTxRetry = 0; // Frame nou: no hereta els intents ni el backoff de l'anterior
+        currentBEBRetry = 0;
+        _access_channel();
+        return true;
+    }
+    #ifdef MAC_PIPELINE
+    if (hasPipeline && _pipeline_wait_ms() > 0) { // No cap a la fase: s'envia a la següent, tornant a competir
+        txopActive = false;
+        currentTxRetry = 0;
+        currentBEBRetry = 0;
+        _access_channel();
+        return true;
+    }
+    #endif
+    if (++txopFrames == 2) {
+        stats.txopBursts++;
+    }
+    stats.txopFrames++;
+    currentTxRetry = 0;
+    _PI("[MAC] TXOP: frame %d/%d without contention", txopFrames, MAC_TXOP_MAX_FRAMES);
+    _wait_ifs();
+    _attempt_transmission(currentTxRetry, false);
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifdef MAC_TXOP
+// El primer frame amb ACK que obté el canal inicia la TXOP. Indica als veïns (flag `more`) si, després del seu ACK,
+// n'hi seguirà un altre: si queden frames a la cua i no s'han superat els límits
+static void _prepare_txop(bool needsAck) {
+    if (!needsAck) {
+        txopActive = false;
+        txPDU.flags.more = 0;
+        return;
+    }
+    if (!txopActive) {
+        txopActive = true;
+        txopStart = millis();
+        txopFrames = 1;
+    }
+    txPDU.flags.more = txopFrames < MAC_TXOP_MAX_FRAMES && millis() - txopStart < MAC_TXOP_MAX_MS && !MACbuff_isTxEmpty();
+}
+#endif
+
+// Mètode d'ajuda per establir valor de reintents. El CRC es recalcula en convertir a format LoRa
 static void _set_retry_count(mac_pdu_t* pdu, uint8_t retry) {
     pdu->flags.retry = retry;
-    pdu->crc = _computeCRC(pdu);
 }
 
-// Intenta enviar PDU guardada a txPDU; recalcula PDU amb nombre intents donat i nou CRC
-// Ajusta potència de TX en funció de reintent
-static bool _attempt_transmission(uint8_t retry_count) {
+// Intenta enviar PDU guardada a txPDU; recalcula PDU amb nombre intents donat
+// Ajusta potència de TX en funció de reintent. Sense `checkChannel`, no es fa CAD abans d'enviar (slot TDMA propi)
+static bool _attempt_transmission(uint8_t retry_count, bool checkChannel) {
     _set_retry_count(&txPDU, retry_count); // Estableix nombre reintents i nou CRC
 
-    // Modificar potència TX segons reintent
-    int power = LORA_TX_POW + (retry_count * MAC_TX_POW_STEP);
+    // Modificar potència TX segons reintent. Les repeticions cegues (sense ACK) no són per manca de cobertura,
+    // i s'envien sempre a potència mínima
+    bool needsAck = _needs_ack(&txPDU);
+    int power = LORA_TX_POW + (needsAck ? retry_count * MAC_TX_POW_STEP : 0);
     LoRaRAW_setTxPower(power);
 
-    mac_err_t state = _send_pdu(&txPDU); // Envia PDU per LoRa
+    #ifdef MAC_TXOP
+    _prepare_txop(needsAck);
+    #endif
+
+    // Frames llargs: primer RTS, i les dades en rebre el CTS
+    bool useRts = _uses_rts(&txPDU, checkChannel);
+    mac_err_t state = useRts ? _send_rts(checkChannel) : _send_pdu(&txPDU, checkChannel); // Envia PDU per LoRa
 
     if (state == MAC_SUCCESS) {
-        _PI("[MAC] Frame sent successfully%s, waiting for ACK", retry_count > 0 ? " after retry" : "");
+        _PI("[MAC] %s sent successfully%s%s", useRts ? "RTS" : "Frame", retry_count > 0 ? " after retry" : "",
+            useRts ? ", waiting for CTS" : needsAck ? ", waiting for ACK" : "");
         currentBEBRetry = 0; // S'ha aconseguit enviar, posem a 0 
         currentTxRetry++; // Hem fet un intent de TX
-        _setup_ack_reception(); // En enviament OK, esperem ACK
+        mac_neighbor_t* nb = needsAck ? MACnb_get(txPDU.rx) : nullptr;
+        if (nb != nullptr) {
+            nb->link.txAttempts++;
+            nb->link.rtsSent += useRts;
+        }
+        if (useRts) {
+            _setup_cts_reception();
+        } else if (needsAck) {
+            _setup_ack_reception(); // En enviament OK, esperem ACK
+        } else {
+            _finish_unacked_transmission();
+        }
     } else {
         _PI("[MAC] Send failed%s", retry_count > 0 ? " after retry" : "");
+        #ifdef MAC_TXOP
+        txopActive = false; // No ha obtingut el canal
+        #endif
         _start_beb_timeout(currentBEBRetry++);
     }
     return true;
@@ -492,14 +1556,48 @@ static void _setup_ack_reception(void) {
 
     LoRaRAW_startReceiving();
     
-    // Calcula i programa timeout
-    long ack_airtime_us = LoRaRAW_getTimeOnAir(MAC_PDU_HEADER_SIZE);
-
-    uint32_t timeout_ms = MAC_ACK_TIMEOUT_FACTOR * ack_airtime_us / 1000;
+    // Calcula i programa timeout. L'ACK d'un fragment porta també el header de fragment
+    // El receptor respon sempre MAC_ACK_IFS_MS després de rebre el frame
+    long ack_airtime_us = LoRaRAW_getTimeOnAir(MAC_ACK_FRAME_SIZE + (txPDU.flags.frag ? MAC_FRAG_HEADER_SIZE : 0));
+
+    uint32_t timeout_ms = MAC_ACK_IFS_MS + MAC_ACK_TIMEOUT_FACTOR * ack_airtime_us / 1000;
+    #ifdef MAC_IMPLICIT_ACK
+    // El receptor pot reconèixer-lo amb el reenviament (de mida similar), o enviar l'ACK després de processar-lo
+    if (!txPDU.flags.frag) {
+        timeout_ms += LoRaRAW_getTimeOnAir(MAC_PDU_HEADER_SIZE + MAC_ACK_ID_SIZE + txPDU.dataLength) / 1000 + MAC_IMPLICIT_ACK_MARGIN_MS;
+    }
+    #endif
     txTimeoutTask = scheduler_once(_mac_fsm_event_tout_ack, timeout_ms);
     _PI("[MAC] Timeout d'ACK: %dms (%dus airtime)", timeout_ms, ack_airtime_us);
 }
 
+// Inicia recepció de CTS. El receptor respon com amb un ACK, MAC_ACK_IFS_MS després de rebre l'RTS
+static void _setup_cts_reception(void) {
+    fsmState = WAIT_CTS_S;
+
+    LoRaRAW_startReceiving();
+
+    long cts_airtime_us = LoRaRAW_getTimeOnAir(MAC_CTRL_SIZE);
+    uint32_t timeout_ms = MAC_ACK_IFS_MS + MAC_ACK_TIMEOUT_FACTOR * cts_airtime_us / 1000;
+    txTimeoutTask = scheduler_once(_mac_fsm_event_tout_ack, timeout_ms);
+    _PI("[MAC] Timeout de CTS: %dms (%dus airtime)", timeout_ms, cts_airtime_us);
+}
+
+// Finalitza una transmissió que no espera ACK (broadcast, o entrega sense garanties). Si queden repeticions cegues, les programa
+// reutilitzant l'espera de canal lliure; si no, la dona per completada
+static void _finish_unacked_transmission(void) {
+    if (currentTxRetry <= MAC_BROADCAST_REPEATS) {
+        fsmState = WAIT_CHAN_FREE_S;
+        uint32_t gap = random(1, 3) * MACcont_getSlotMs(); // Separació aleatòria, per no col·lisionar sempre amb el mateix node
+        txTimeoutTask = scheduler_once(_mac_fsm_event_tout_busy, gap);
+        _PI("[MAC] Blind repetition %d/%d in %dms", currentTxRetry, MAC_BROADCAST_REPEATS, gap);
+        return;
+    }
+    stats.succeededTransmissions++;
+    _sent_mac();
+    _apply_duty_cycle_delay();
+}
+
 // Mètodes per generar esdeveniments a FSM a través de scheduler
 static void _mac_fsm_event_tout_ack(void) { _mac_fsm(mac_event_t::TOUT_ACK_E); }
 static void _mac_fsm_event_tout_busy(void) { _mac_fsm(mac_event_t::TOUT_BUSY_E); }
@@ -510,11 +1608,91 @@ static void _mac_fsm_event_duty_timeout(void) {
     #endif
 }
 
+// Accés al canal per transmetre txPDU. Dins del slot TDMA propi, transmet directament (sense CAD ni backoff), i si
+// encara no ha començat, n'espera l'inici; un cop acabat, es torna a CSMA.
+// Amb CSMA, segons l'estat observat: amb canal lliure transmet (o ajorna un slot, segons p-persistència);
+// amb canal ocupat, aplica backoff
+static void _access_channel(void) {
+    // Receptor indisponible (avís MAC_CTRL_DEAF): s'espera que torni a rebre, sense fer cap intent.
+    // El backoff aleatori evita que tots els veïns que l'esperaven transmetin alhora
+    uint32_t deafMs = _deaf_ms(txPDU.rx);
+    if (deafMs > 0) {
+        stats.deafDeferrals++;
+        if (!deafRetriesCounted) {
+            deafRetriesCounted = true;
+            stats.deafRetriesSaved += MAC_MAX_RETRIES + 1 - currentTxRetry;
+        }
+        fsmState = WAIT_CHAN_FREE_S;
+        uint32_t defer = deafMs + MACcont_getBackoffMs(currentBEBRetry);
+        txTimeoutTask = scheduler_once(_mac_fsm_event_tout_busy, defer);
+        _PI("[MAC] 0x%02X deaf, waiting %d ms", txPDU.rx, defer);
+        LoRaRAW_startReceiving();
+        return;
+    }
+
+    if (hasTxSlot) {
+        unsigned long now = millis();
+        if ((long)(now - txSlotStart) < 0) {
+            fsmState = WAIT_CHAN_FREE_S;
+            txTimeoutTask = scheduler_once(_mac_fsm_event_tout_busy, txSlotStart - now);
+            _PI("[MAC] Waiting for TX slot (%lu ms)", txSlotStart - now);
+            LoRaRAW_startReceiving();
+            return;
+        }
+        if (now - txSlotStart < txSlotDuration) {
+            _attempt_transmission(currentTxRetry, false);
+            return;
+        }
+        _PW("[MAC] TX slot over, falling back to CSMA");
+        hasTxSlot = false;
+    }
+
+    #ifdef MAC_PIPELINE
+    // Fora de la fase pròpia, s'espera la següent sense fer CAD: els veïns adjacents hi poden estar transmetent
+    uint32_t phaseWait = hasPipeline ? _pipeline_wait_ms() : 0;
+    if (phaseWait > 0) {
+        stats.pipelineDeferrals++;
+        fsmState = WAIT_CHAN_FREE_S;
+        txTimeoutTask = scheduler_once(_mac_fsm_event_tout_busy, phaseWait);
+        _PI("[MAC] Waiting for pipeline phase (%d ms)", phaseWait);
+        LoRaRAW_startReceiving();
+        return;
+    }
+    #endif
+
+    // Canal reservat per un intercanvi escoltat (NAV): no cal CAD. S'espera la fi de la reserva, i un backoff
+    // aleatori per no transmetre alhora que altres nodes que també l'esperaven
+    uint32_t nav = MACcont_getNavMs();
+    if (nav > 0) {
+        fsmState = WAIT_CHAN_FREE_S;
+        uint32_t defer = nav + MACcont_getBackoffMs(currentBEBRetry);
+        txTimeoutTask = scheduler_once(_mac_fsm_event_tout_busy, defer);
+        _PI("[MAC] Channel reserved (NAV), waiting %d ms", defer);
+        LoRaRAW_startReceiving();
+        return;
+    }
+
+    // Obtenim estat canal per poder-ho utilitzar com a esdeveniment (aplicar backoff)
+    lora_event_t lora_e = (lora_event_t)LoRaRAW_isAvailable();
+    MACcont_onChannelSample(lora_e == BUSY_E);
+    if (lora_e == IDLE_E && MACcont_shouldTransmit()) {
+        _attempt_transmission(currentTxRetry);
+    }
+    else if (lora_e == IDLE_E) { // Canal lliure, però ajornem un slot per no transmetre alhora que altres nodes
+        fsmState = WAIT_CHAN_FREE_S;
+        txTimeoutTask = scheduler_once(_mac_fsm_event_tout_busy, MACcont_getSlotMs());
+        LoRaRAW_startReceiving();
+    }
+    else { // Canal ocupat
+        _PI("[MAC] Channel busy, applying backoff");
+        _start_beb_timeout(currentBEBRetry++);
+    }
+}
+
 static void _start_beb_timeout(uint8_t attempt) {
     _PI("[MAC] Waiting chann free (%d)", attempt);
     fsmState = WAIT_CHAN_FREE_S;
-    attempt = MIN(attempt, MAC_MAX_BEB_RETRY); // Limitar a valor màxim
-    uint32_t bebTimeout = random(0, (1 << attempt) + 1) * MAC_BEB_SLOT_MS; // Calcular timeout de backoff. Random + 1 perquè no inclou extrem màxim
+    uint32_t bebTimeout = MACcont_getBackoffMs(attempt); // Calcular timeout de backoff
     txTimeoutTask = scheduler_once(_mac_fsm_event_tout_busy, bebTimeout); // Programar timeout
     _PI("[MAC] Timeout BEB: %dms", bebTimeout);
     LoRaRAW_startReceiving();
@@ -528,7 +1706,8 @@ static void _start_beb_timeout(uint8_t attempt) {
 static void _sent_mac(void) {
     _PI("[MAC] Sent. Notify higher layer?");
     LoRaRAW_startReceiving();
-    if(!txPDU.flags.isACK && onSend != nullptr) { // Notificar només si dades (no ACK)
+    // Notificar només si dades (no ACK), i si és fragmentat, quan s'ha enviat l'últim fragment
+    if(!txPDU.flags.isACK && _is_last_fragment(&txPDU) && onSend != nullptr) {
         onSend(txPDU.id); // Notifiquem proporcionant ID
     }
 }
@@ -539,9 +1718,49 @@ static void _received_mac(void) {
     }
 }
 
+// Reenviament directe: si capa superior retorna un següent salt, la PDU rebuda (amb les dades ja reescrites) es converteix
+// en la del reenviament i s'afegeix a la cua de TX, com faria `MAC_send()`. S'estalvia el pas per la cua de RX i les
+// còpies de capa d'encaminament, però no la còpia de la PDU al node de la cua de TX (`MACbuff_pushTx()`).
+// Després se'n restaura el header rebut, que encara es necessita en acabar la recepció (qualitat d'enllaç, veïns)
+static bool _cut_through(mac_pdu_t* pdu) {
+    if (onForward == nullptr) {
+        return false;
+    }
+    size_t length = pdu->dataLength;
+    node_address_t nextHop = onForward(pdu->data, &length, MAC_MAX_FRAME_DATA_SIZE, pdu->tx);
+    if (nextHop == NODE_ADDRESS_NULL) {
+        return false;
+    }
+
+    bool isMacAvailable = MAC_isAvailable();
+    node_address_t prevHop = pdu->tx;
+    mac_id_t rcvID = pdu->id;
+    mac_pdu_flags_t rcvFlags = pdu->flags;
+    mac_id_t rcvAckedId = pdu->ackedId;
+
+    _prepareHeader(pdu, nextHop, _getNextSeq());
+    pdu->flags.noAck = rcvFlags.noAck; // Mateixa classe d'entrega
+    pdu->dataLength = length;
+    #ifdef MAC_IMPLICIT_ACK
+    _attach_implicit_ack(pdu, isMacAvailable);
+    #endif
+    MACbuff_pushTx(*pdu, MACBUFF_PRIORITY_LOW);
+    _PI("[MAC] Cut-through from 0x%02X to 0x%02X (ID: %d)", prevHop, nextHop, pdu->id);
+    if (isMacAvailable) {
+        scheduler_once(_mac_fsm_event_tx);
+    }
+
+    pdu->tx = prevHop;
+    pdu->rx = self;
+    pdu->id = rcvID;
+    pdu->flags = rcvFlags;
+    pdu->ackedId = rcvAckedId;
+    return true;
+}
+
 static void _txError_mac(void) {
-    failedTransmissions++;
-    _PW("[MAC] TX error (%d)", failedTransmissions);
+    stats.failedTransmissions++;
+    _PW("[MAC] TX error (%d)", stats.failedTransmissions);
     LoRaRAW_startReceiving();
     if(!txPDU.flags.isACK && onTxFailed != nullptr) { // Notificar només si dades (no ACK) @note: no sembla ser necessari si sendack no passa per fsm
         onTxFailed(txPDU.id); // Notifiquem proporcionant ID
@@ -551,8 +1770,9 @@ static void _txError_mac(void) {
 #if LOG_LEVEL <= LOG_LEVEL_INFO
 static void _printPDU(const mac_pdu_t* const pdu) {
     // Intenta mostrar en ASCII; mostra també en HEX per si caràcters no imprimibles4
-    _PI("[MAC] FRAME: TX=%02X RX=%02X ID=%d D-LEN=%d DATA=%.*s CRC=%d ACK=%d RETRY=%d", 
-        pdu->tx, pdu->rx, pdu->id, pdu->dataLength, pdu->dataLength, pdu->data, pdu->crc, pdu->flags.isACK, pdu->flags.retry);
+    _PI("[MAC] FRAME: TX=%02X RX=%02X ID=%d D-LEN=%d DATA=%.*s CRC=%d ACK=%d RETRY=%d FRAG=%d IACK=%d NOACK=%d CTRL=%d MORE=%d", 
+        pdu->tx, pdu->rx, pdu->id, pdu->dataLength, pdu->dataLength, pdu->data, pdu->crc, pdu->flags.isACK, pdu->flags.retry, pdu->flags.frag,
+        pdu->flags.implicitAck ? pdu->ackedId : -1, pdu->flags.noAck, pdu->flags.ctrl, pdu->flags.more);
 }
 #else
 static void _printPDU(const mac_pdu_t* const pdu) {}
@@ -0,0 +1,92 @@
+/*
+    Gestió activa de la cua de TX de la capa MAC (AQM), basada en CoDel (RFC 8289).
+
+    Sense gestió, amb càrrega sostinguda els frames esperen a la cua tant com calgui: les lectures arriben amb
+    minuts de retard, i els timers de transport expiren i afegeixen retransmissions a la mateixa cua.
+    CoDel mesura el temps que cada frame ha estat a la cua (sojourn) en obtenir-lo. Si durant tot un interval
+    (`MAC_AQM_INTERVAL_MS`) el mínim supera l'objectiu (`MAC_AQM_TARGET_MS`), la cua és persistent i es comença
+    a descartar frames, cada cop més seguits (interval / sqrt(descarts)), fins que el temps torna a baixar de l'objectiu.
+    La capa MAC notifica els frames descartats a capa superior amb `MAC_onTxDropped()`, separats dels errors d'entrega
+    perquè l'encaminament no els prengui com a salts caiguts; si no hi ha callback de descarts, amb `MAC_onTxFailed()`.
+*/
+
+#include <Arduino.h>
+#include "mac_aqm.h"
+#include "utils.h"
+
+static mac_aqm_stats_t stats = {};
+
+#ifdef MAC_AQM
+static bool dropping = false;               // Si s'està en estat de descart
+static unsigned long firstAboveTime = 0;    // Instant a partir del qual es pot començar a descartar (0 si per sota de l'objectiu)
+static unsigned long dropNext = 0;          // Instant del següent descart, en estat de descart
+static uint32_t dropCount = 0;              // Descarts consecutius de l'estat de descart actual
+static uint32_t lastDropCount = 0;          // Descarts de l'últim estat de descart
+
+static bool _okToDrop(uint32_t sojournMs, bool queueEmpty, unsigned long now);
+static unsigned long _controlLaw(unsigned long t, uint32_t count);
+#endif
+
+bool MACaqm_shouldDrop(uint32_t sojournMs, bool queueEmpty) {
+    stats.dequeued++;
+    stats.sojournLastMs = sojournMs;
+    stats.sojournSumMs += sojournMs;
+    stats.sojournMaxMs = MAX(stats.sojournMaxMs, sojournMs);
+
+#ifdef MAC_AQM
+    unsigned long now = millis();
+    bool okToDrop = _okToDrop(sojournMs, queueEmpty, now);
+
+    if (dropping) {
+        if (!okToDrop) { // El temps a la cua ha baixat de l'objectiu
+            dropping = false;
+            return false;
+        }
+        if ((long)(now - dropNext) >= 0) {
+            dropCount++;
+            dropNext = _controlLaw(dropNext, dropCount);
+            stats.drops++;
+            _PW("[MACAQM] Dropping frame (sojourn: %d ms, drops: %d)", sojournMs, dropCount);
+            return true;
+        }
+        return false;
+    }
+
+    if (okToDrop) {
+        dropping = true;
+        // Si s'acaba de sortir d'un estat de descart, es continua a prop del ritme anterior
+        uint32_t delta = dropCount - lastDropCount;
+        dropCount = (delta > 1 && (long)(now - dropNext) < 16L * MAC_AQM_INTERVAL_MS) ? delta : 1;
+        lastDropCount = dropCount;
+        dropNext = _controlLaw(now, dropCount);
+        stats.drops++;
+        _PW("[MACAQM] Persistent queue, dropping frame (sojourn: %d ms)", sojournMs);
+        return true;
+    }
+#else
+    (void)queueEmpty;
+#endif
+    return false;
+}
+
+mac_aqm_stats_t MACaqm_getStats() { return stats; }
+
+#ifdef MAC_AQM
+// Indica si el temps a la cua ha superat l'objectiu durant tot un interval
+static bool _okToDrop(uint32_t sojournMs, bool queueEmpty, unsigned long now) {
+    if (sojournMs < MAC_AQM_TARGET_MS || queueEmpty) {
+        firstAboveTime = 0;
+        return false;
+    }
+    if (firstAboveTime == 0) {
+        firstAboveTime = MAX(now + MAC_AQM_INTERVAL_MS, 1UL); // 0 indica per sota de l'objectiu
+        return false;
+    }
+    return (long)(now - firstAboveTime) >= 0;
+}
+
+// Instant del següent descart: com més descarts consecutius, més seguits
+static unsigned long _controlLaw(unsigned long t, uint32_t count) {
+    return t + (unsigned long)(MAC_AQM_INTERVAL_MS / sqrt((float)count));
+}
+#endif
@@ -1,7 +1,8 @@
+#include <Arduino.h>
 #include "mac_buffer.h"
 
 static mac_buffer_t txQueue;
-static mac_buffer_t rxQueue;
+static mac_rx_buffer_t rxQueue;
 
 bool MACbuff_isTxEmpty() {
     return txQueue.high.isEmpty() && txQueue.low.isEmpty();
@@ -11,25 +12,51 @@ bool MACbuff_isRxEmpty() {
     return rxQueue.high.isEmpty() && rxQueue.low.isEmpty();
 }
 
-mac_buffer_priority_t MACbuff_popTx(mac_pdu_t& pdu) {
+mac_buffer_priority_t MACbuff_popTx(mac_pdu_t& pdu, unsigned long* enqueuedAt) {
+    mac_tx_entry_t entry;
+    mac_buffer_priority_t priority = MACBUFF_PRIORITY_NONE;
     if(!txQueue.high.isEmpty()) {
-        txQueue.high.pop(pdu);
-        return MACBUFF_PRIORITY_HIGH;
+        txQueue.high.pop(entry);
+        priority = MACBUFF_PRIORITY_HIGH;
     }
     else if (!txQueue.low.isEmpty()) {
-        txQueue.low.pop(pdu);
-        return MACBUFF_PRIORITY_LOW;
+        txQueue.low.pop(entry);
+        priority = MACBUFF_PRIORITY_LOW;
     }
-    return MACBUFF_PRIORITY_NONE;
+    else {
+        return MACBUFF_PRIORITY_NONE;
+    }
+    pdu = entry.pdu;
+    if (enqueuedAt) {
+        *enqueuedAt = entry.enqueuedAt;
+    }
+    return priority;
+}
+
+mac_buffer_priority_t MACbuff_peekTx(mac_pdu_t& pdu) {
+    mac_tx_entry_t entry;
+    mac_buffer_priority_t priority = MACBUFF_PRIORITY_NONE;
+    if(txQueue.high.peek(entry)) {
+        priority = MACBUFF_PRIORITY_HIGH;
+    }
+    else if (txQueue.low.peek(entry)) {
+        priority = MACBUFF_PRIORITY_LOW;
+    }
+    else {
+        return MACBUFF_PRIORITY_NONE;
+    }
+    pdu = entry.pdu;
+    return priority;
 }
 
 bool MACbuff_pushTx(mac_pdu_t& pdu, mac_buffer_priority_t priority) {
+    mac_tx_entry_t entry = { pdu, millis() };
     switch (priority) {
         case MACBUFF_PRIORITY_HIGH:
-            txQueue.high.push(pdu);
+            txQueue.high.push(entry);
             break;
         case MACBUFF_PRIORITY_LOW:
-            txQueue.low.push(pdu);
+            txQueue.low.push(entry);
             break;
         default:
             return false;
@@ -37,25 +64,25 @@ bool MACbuff_pushTx(mac_pdu_t& pdu, mac_buffer_priority_t priority) {
     return true;
 }
 
-mac_buffer_priority_t MACbuff_popRx(mac_pdu_t& pdu) {
+mac_buffer_priority_t MACbuff_popRx(mac_sdu_t& sdu) {
     if(!rxQueue.high.isEmpty()) {
-        rxQueue.high.pop(pdu);
+        rxQueue.high.pop(sdu);
         return MACBUFF_PRIORITY_HIGH;
     }
     else if (!rxQueue.low.isEmpty()) {
-        rxQueue.low.pop(pdu);
+        rxQueue.low.pop(sdu);
         return MACBUFF_PRIORITY_LOW;
     }
     return MACBUFF_PRIORITY_NONE;
 }
 
-bool MACbuff_pushRx(mac_pdu_t& pdu, mac_buffer_priority_t priority) {
+bool MACbuff_pushRx(mac_sdu_t& sdu, mac_buffer_priority_t priority) {
     switch (priority) {
         case MACBUFF_PRIORITY_HIGH:
-            rxQueue.high.push(pdu);
+            rxQueue.high.push(sdu);
             break;
         case MACBUFF_PRIORITY_LOW:
-            rxQueue.low.push(pdu);
+            rxQueue.low.push(sdu);
             break;
         default:
             return false;
@@ -0,0 +1,144 @@
+/*
+    Accés al medi de la capa MAC (contenció).
+
+    Amb MAC_ADAPTIVE_CSMA:
+    - El slot és l'airtime d'un ACK (per MAC_CSMA_SLOT_FACTOR), en lloc d'un valor fix; així s'adapta al SF.
+      Un slot fix de 100 ms és molt més llarg que un frame curt a SF7, i més curt que un frame a SF12.
+    - Amb canal lliure, es transmet amb probabilitat p = 1 - ocupació estimada (p-persistència);
+      si no, s'espera un slot i es torna a comprovar. L'ocupació és una mitjana mòbil exponencial de les comprovacions de canal.
+    - Amb canal ocupat, s'espera un nombre aleatori de slots dins la finestra de contenció.
+    - La finestra es duplica amb cada col·lisió (ACK no rebut) i es divideix per 2 amb cada èxit.
+      No depèn del nombre d'esperes consecutives: l'ocupació ja es té en compte amb la p-persistència.
+    Comparativa amb BEB: tests/simulacioCSMA/simulacioCSMA.py
+
+    Sense MAC_ADAPTIVE_CSMA, es manté el BEB clàssic amb slot de MAC_BEB_SLOT_MS i es transmet sempre amb canal lliure.
+
+    Amb MAC_NAV, la capa MAC reserva el canal en escoltar frames de dades d'altres nodes (fins al seu ACK), i mentre
+    dura la reserva no es fa CAD.
+*/
+
+#include <Arduino.h>
+#include "mac_contention.h"
+#include "lora.h"
+#include "utils.h"
+
+// Pes de cada nova comprovació de canal a la mitjana mòbil d'ocupació
+#define MAC_CSMA_BUSY_ALPHA 0.125f
+
+static uint32_t slotMs = MAC_BEB_SLOT_MS;
+static uint16_t contentionWindow = MAC_CSMA_CW_MIN;
+static float busyRatio = 0;
+
+// Reserva de canal (NAV): fi, en `ms`, i emissor del frame que la va generar
+static bool navActive = false;
+static unsigned long navEnd = 0;
+static node_address_t navOwner = NODE_ADDRESS_NULL;
+static uint32_t navMoreMs = 0; // Següent intercanvi de la TXOP de `navOwner`, si continua
+
+static mac_contention_stats_t stats = {};
+
+void MACcont_init() {
+#ifdef MAC_ADAPTIVE_CSMA
+    long ackAirtimeUs = LoRaRAW_getTimeOnAir(MAC_ACK_FRAME_SIZE);
+    slotMs = MAX(1, MAC_CSMA_SLOT_FACTOR * ackAirtimeUs / 1000);
+    _PI("[MACCONT] Adaptive CSMA (slot: %d ms, CW: %d-%d)", slotMs, MAC_CSMA_CW_MIN, MAC_CSMA_CW_MAX);
+#else
+    slotMs = MAC_BEB_SLOT_MS;
+    _PI("[MACCONT] BEB (slot: %d ms)", slotMs);
+#endif
+}
+
+uint32_t MACcont_getSlotMs() { return slotMs; }
+
+void MACcont_onChannelSample(bool busy) {
+    if (busy) {
+        stats.busySamples++;
+    } else {
+        stats.idleSamples++;
+    }
+    busyRatio += MAC_CSMA_BUSY_ALPHA * ((busy ? 1.0f : 0.0f) - busyRatio);
+}
+
+void MACcont_setNav(node_address_t owner, uint32_t durationMs, uint32_t moreMs) {
+#ifdef MAC_NAV
+    unsigned long end = millis() + durationMs;
+    if (navActive && (long)(navEnd - end) >= 0) {
+        return;
+    }
+    navActive = true;
+    navEnd = end;
+    navOwner = owner;
+    navMoreMs = moreMs;
+    stats.navSets++;
+    _PI("[MACCONT] NAV set for %d ms (0x%02X)", durationMs, owner);
+#endif
+}
+
+void MACcont_onAckOverheard(node_address_t rx) {
+    if (navActive && rx == navOwner && navMoreMs > 0) {
+        // El següent frame de la TXOP arriba just després de l'ACK; quan s'escolti, tornarà a establir la reserva
+        navEnd = millis() + navMoreMs;
+        navMoreMs = 0;
+        stats.navExtensions++;
+        _PI("[MACCONT] NAV extended for TXOP of 0x%02X", rx);
+    }
+    else if (navActive && rx == navOwner) {
+        navActive = false;
+        _PI("[MACCONT] NAV cleared by ACK to 0x%02X", rx);
+    }
+}
+
+bool MACcont_isNavActive() { return navActive && (long)(navEnd - millis()) > 0; }
+
+uint32_t MACcont_getNavMs() {
+    if (!navActive) {
+        return 0;
+    }
+    long remaining = (long)(navEnd - millis());
+    if (remaining <= 0) {
+        navActive = false;
+        return 0;
+    }
+    stats.navDeferrals++;
+    return remaining;
+}
+
+bool MACcont_shouldTransmit() {
+#ifdef MAC_ADAPTIVE_CSMA
+    int persistence = MAX((int)(100 * (1 - busyRatio)), MAC_CSMA_MIN_PERSISTENCE);
+    if (random(0, 100) < persistence) {
+        return true;
+    }
+    stats.deferrals++;
+    _PI("[MACCONT] Deferring one slot (p = %d%%)", persistence);
+    return false;
+#else
+    return true;
+#endif
+}
+
+uint32_t MACcont_getBackoffMs(uint8_t attempt) {
+    attempt = MIN(attempt, MAC_MAX_BEB_RETRY); // Limitar a valor màxim
+#ifdef MAC_ADAPTIVE_CSMA
+    uint32_t window = contentionWindow;
+#else
+    uint32_t window = 1 << attempt;
+#endif
+    return random(0, window + 1) * slotMs; // Random + 1 perquè no inclou extrem màxim
+}
+
+void MACcont_onTxSuccess() {
+    contentionWindow = MAX(contentionWindow / 2, MAC_CSMA_CW_MIN);
+}
+
+void MACcont_onTxCollision() {
+    stats.collisions++;
+    contentionWindow = MIN(contentionWindow * 2, MAC_CSMA_CW_MAX);
+}
+
+mac_contention_stats_t MACcont_getStats() {
+    stats.contentionWindow = contentionWindow;
+    stats.busyRatio = 100 * busyRatio;
+    stats.slotMs = slotMs;
+    return stats;
+}
@@ -0,0 +1,152 @@
+/*
+    Reassemblatge de frames fragmentats a capa MAC (salt a salt).
+    Tots els fragments d'un frame comparteixen ID, i porten un byte de header amb l'índex i el total.
+    Cada fragment es reconeix amb ACK de forma individual, de manera que només es retransmeten
+    els que es perden.
+
+    Hi ha un nombre fix d'entrades de reassemblatge (`MAC_FRAG_POOL_SIZE`); la memòria de cada entrada
+    només es reserva mentre s'està reassemblant un frame, i com a màxim és de `MAC_MAX_DATA_SIZE`.
+    Una entrada que no rep cap fragment durant `MAC_FRAG_TIMEOUT_MS` es descarta.
+*/
+
+#include <Arduino.h>
+#include "mac_fragment.h"
+#include "utils.h"
+
+#if MAC_FRAG_MAX_FRAGMENTS > 15
+    #error "MAC_FRAG_MAX_FRAGMENTS no pot ser major a 15 (camp de 4 bits)"
+#endif
+
+typedef struct {
+    bool used;
+    node_address_t tx;
+    mac_id_t id;
+    uint8_t count;              // Nombre total de fragments
+    uint16_t receivedMask;      // Bit `i` indica si s'ha rebut el fragment `i`
+    uint16_t length;            // Mida total acumulada
+    unsigned long lastUpdate;   // Instant de l'últim fragment rebut, en `ms`
+    uint8_t* data;
+} mac_frag_entry_t;
+
+static mac_frag_entry_t entries[MAC_FRAG_POOL_SIZE];
+
+static mac_frag_entry_t* _findEntry(node_address_t tx, mac_id_t id);
+static mac_frag_entry_t* _newEntry(node_address_t tx, mac_id_t id, uint8_t count);
+static void _freeEntry(mac_frag_entry_t* entry);
+
+mac_frag_header_t MACfrag_getHeader(const mac_pdu_t* const pdu) {
+    mac_frag_header_t header;
+    memcpy(&header, pdu->data, MAC_FRAG_HEADER_SIZE);
+    return header;
+}
+
+mac_frag_result_t MACfrag_add(const mac_pdu_t* const pdu, mac_sdu_t* sdu) {
+    if (pdu->dataLength < MAC_FRAG_HEADER_SIZE) {
+        return MACFRAG_ERR_INVALID;
+    }
+
+    mac_frag_header_t header = MACfrag_getHeader(pdu);
+    size_t fragLength = pdu->dataLength - MAC_FRAG_HEADER_SIZE;
+    bool isLast = header.index == header.count - 1;
+
+    // Tots els fragments excepte l'últim han d'anar plens; així la posició de cada un és fixa
+    if (header.count == 0 || header.count > MAC_FRAG_MAX_FRAGMENTS || header.index >= header.count ||
+        (!isLast && fragLength != MAC_FRAG_DATA_SIZE) || fragLength > MAC_FRAG_DATA_SIZE) {
+        _PW("[MACFRAG] Invalid fragment %d/%d (%d B) from 0x%02X", header.index, header.count, fragLength, pdu->tx);
+        return MACFRAG_ERR_INVALID;
+    }
+
+    mac_frag_entry_t* entry = _findEntry(pdu->tx, pdu->id);
+    if (entry == nullptr) {
+        entry = _newEntry(pdu->tx, pdu->id, header.count);
+        if (entry == nullptr) {
+            return MACFRAG_ERR_NO_MEMORY;
+        }
+    }
+    else if (entry->count != header.count) {
+        _PW("[MACFRAG] Fragment count mismatch for ID %d (%d != %d)", pdu->id, header.count, entry->count);
+        return MACFRAG_ERR_INVALID;
+    }
+
+    entry->lastUpdate = millis();
+
+    // Fragment repetit (l'emissor no ha rebut l'ACK). No cal tornar-lo a copiar
+    if (entry->receivedMask & (1U << header.index)) {
+        _PI("[MACFRAG] Repeated fragment %d/%d (ID %d)", header.index + 1, header.count, pdu->id);
+        return MACFRAG_INCOMPLETE;
+    }
+
+    memcpy(entry->data + header.index * MAC_FRAG_DATA_SIZE, pdu->data + MAC_FRAG_HEADER_SIZE, fragLength);
+    entry->receivedMask |= (1U << header.index);
+    entry->length += fragLength;
+    _PI("[MACFRAG] Fragment %d/%d (ID %d) from 0x%02X", header.index + 1, header.count, pdu->id, pdu->tx);
+
+    if (entry->receivedMask != (1U << entry->count) - 1) {
+        return MACFRAG_INCOMPLETE;
+    }
+
+    sdu->tx = entry->tx;
+    sdu->dataLength = entry->length;
+    memcpy(sdu->data, entry->data, entry->length);
+    _PI("[MACFRAG] Frame %d reassembled (%d B)", entry->id, entry->length);
+    _freeEntry(entry);
+    return MACFRAG_COMPLETE;
+}
+
+size_t MACfrag_purgeExpired() {
+    size_t expired = 0;
+    unsigned long now = millis();
+    for (size_t i = 0; i < MAC_FRAG_POOL_SIZE; i++) {
+        if (entries[i].used && now - entries[i].lastUpdate >= MAC_FRAG_TIMEOUT_MS) {
+            _PW("[MACFRAG] Reassembly of ID %d from 0x%02X timed out", entries[i].id, entries[i].tx);
+            _freeEntry(&entries[i]);
+            expired++;
+        }
+    }
+    return expired;
+}
+
+void MACfrag_clear() {
+    for (size_t i = 0; i < MAC_FRAG_POOL_SIZE; i++) {
+        if (entries[i].used) {
+            _freeEntry(&entries[i]);
+        }
+    }
+}
+
+static mac_frag_entry_t* _findEntry(node_address_t tx, mac_id_t id) {
+    for (size_t i = 0; i < MAC_FRAG_POOL_SIZE; i++) {
+        if (entries[i].used && entries[i].tx == tx && entries[i].id == id) {
+            return &entries[i];
+        }
+    }
+    return nullptr;
+}
+
+static mac_frag_entry_t* _newEntry(node_address_t tx, mac_id_t id, uint8_t count) {
+    for (size_t i = 0; i < MAC_FRAG_POOL_SIZE; i++) {
+        if (!entries[i].used) {
+            // Només es reserva el necessari pel nombre de fragments anunciat
+            entries[i].data = (uint8_t*)malloc(count * MAC_FRAG_DATA_SIZE);
+            if (entries[i].data == nullptr) {
+                _PE("[MACFRAG] Error allocating reassembly buffer");
+                return nullptr;
+            }
+            entries[i].used = true;
+            entries[i].tx = tx;
+            entries[i].id = id;
+            entries[i].count = count;
+            entries[i].receivedMask = 0;
+            entries[i].length = 0;
+            return &entries[i];
+        }
+    }
+    _PW("[MACFRAG] No free reassembly entry for ID %d from 0x%02X", id, tx);
+    return nullptr;
+}
+
+static void _freeEntry(mac_frag_entry_t* entry) {
+    free(entry->data);
+    entry->data = nullptr;
+    entry->used = false;
+}
@@ -0,0 +1,96 @@
+/*
+    Taula de veïns de la capa MAC.
+    Com que les adreces són de 8 bits, la taula és un array d'apuntadors indexat directament
+    per adreça; la memòria de cada veí només es reserva quan se'n rep el primer frame.
+
+    La detecció de duplicats es fa amb una finestra lliscant per veí: es guarda la seqüència
+    més alta rebuda i un bitmap amb les `MAC_DEDUP_WINDOW` anteriors. Així, la comprovació és O(1)
+    independentment del trànsit, i dos veïns diferents no poden col·lisionar mai (la clau inclou l'emissor).
+*/
+
+#include <new>
+#include "mac_neighbors.h"
+#include "utils.h"
+
+#if MAC_DEDUP_WINDOW > 32
+    #error "MAC_DEDUP_WINDOW no pot ser major a 32 (mida del bitmap)"
+#endif
+
+static mac_neighbor_t* neighbors[1 << (8 * sizeof(node_address_t))] = { nullptr };
+
+mac_neighbor_t* MACnb_get(node_address_t addr) {
+    if (neighbors[addr] == nullptr) {
+        neighbors[addr] = new (std::nothrow) mac_neighbor_t{};
+        if (neighbors[addr] == nullptr) {
+            _PE("[MACNB] Error allocating neighbor 0x%02X", addr);
+        }
+    }
+    return neighbors[addr];
+}
+
+mac_neighbor_t* MACnb_find(node_address_t addr) { return neighbors[addr]; }
+
+bool MACnb_isDuplicate(node_address_t addr, mac_id_t seq) {
+    mac_neighbor_t* nb = neighbors[addr];
+    if (nb == nullptr || !nb->hasSeq) {
+        return false;
+    }
+
+    // Diferència amb signe; permet tractar correctament el desbordament del comptador
+    int16_t diff = (int16_t)(seq - nb->lastSeq);
+    if (diff > 0 || -diff >= MAC_DEDUP_WINDOW) { // Més nova, o massa antiga per saber-ho (es considera nova)
+        return false;
+    }
+    return nb->seqWindow & (1UL << -diff);
+}
+
+bool MACnb_markReceived(node_address_t addr, mac_id_t seq) {
+    mac_neighbor_t* nb = MACnb_get(addr);
+    if (nb == nullptr) {
+        return true;
+    }
+
+    bool inWindow = true;
+
+    int16_t diff = (int16_t)(seq - nb->lastSeq);
+    if (!nb->hasSeq) {
+        nb->lastSeq = seq;
+        nb->seqWindow = 1;
+        nb->hasSeq = true;
+    }
+    else if (diff > 0) { // Nova seqüència més alta: desplacem finestra
+        nb->seqWindow = diff >= MAC_DEDUP_WINDOW ? 0 : nb->seqWindow << diff;
+        nb->seqWindow |= 1;
+        nb->lastSeq = seq;
+    }
+    else if (-diff < MAC_DEDUP_WINDOW) { // Dins de finestra, però desordenada
+        nb->seqWindow |= (1UL << -diff);
+    }
+    else { // Fora de finestra: probablement l'emissor s'ha reiniciat. Re-sincronitzem
+        nb->outOfWindow++;
+        _PW("[MACNB] Sequence %d from 0x%02X out of window (last %d). Resyncing", seq, addr, nb->lastSeq);
+        nb->lastSeq = seq;
+        nb->seqWindow = 1;
+        inWindow = false;
+    }
+    nb->framesReceived++;
+    return inWindow;
+}
+
+node_address_t MACnb_nextUnreachable(node_address_t after) {
+    const size_t count = sizeof(neighbors) / sizeof(neighbors[0]);
+    for (size_t i = 1; i <= count; i++) {
+        node_address_t addr = (node_address_t)(after + i);
+        if (neighbors[addr] != nullptr && neighbors[addr]->link.unreachable) {
+            return addr;
+        }
+    }
+    return NODE_ADDRESS_NULL;
+}
+
+void MACnb_clear() {
+    for (size_t i = 0; i < sizeof(neighbors) / sizeof(neighbors[0]); i++) {
+        delete neighbors[i];
+        neighbors[i] = nullptr;
+    }
+}
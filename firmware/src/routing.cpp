@@ -1,30 +1,121 @@
 #include "routing.h"
 #include "utils.h"
 #include "scheduler.h"
+#include "routing_coding.h"
+#include "routing_dv.h"
 
 static node_address_t self;
 static bool isGateway;
 
 static routing_pdu_t txPDU, rxPDU;
 
+// Node del qual s'ha rebut rxPDU (emissor MAC); nul si s'ha rebut per LoRaWAN
+static node_address_t rxPrevHop = NODE_ADDRESS_NULL;
+
+#ifdef ROUTING_NETWORK_CODING
+// Paquet codificat (enviat o rebut), i paquet de la cua de codificació a enviar
+static routing_pdu_t codedPDU;
+static bool flushScheduled = false;
+#endif
+
+#ifdef ROUTING_FAILOVER
+// Salts de la ruta que es consideren: el principal i els alternatius
+#define ROUTING_ROUTE_HOPS (1 + ROUTING_TABLE_MAX_BACKUPS)
+
+// Paquet enviat per MAC a un destí amb salts alternatius, per reenviar-lo per un altre salt si falla
+typedef struct {
+    bool used;
+    bool failed;            // MAC no l'ha pogut entregar; pendent de failover
+    mac_id_t macId;         // ID a MAC de l'intent actual
+    mac_id_t id;            // ID del primer intent, el que coneix la capa superior
+    node_address_t nextHop; // Salt de l'intent actual
+    uint8_t tried;          // Salts ja intentats, un bit per posició a `RoutingTable_getRoutes()`
+    routing_pdu_t pdu;
+} routing_pending_t;
+
+// Salt que ha fallat, per darrere dels alternatius fins a `until`
+typedef struct {
+    node_address_t addr;
+    unsigned long until;
+} routing_demoted_t;
+
+static routing_pending_t pending[ROUTING_FAILOVER_PENDING];
+static routing_demoted_t demoted[ROUTING_FAILOVER_MAX_DEMOTED];
+static bool failoverScheduled = false;
+#else
+#define ROUTING_ROUTE_HOPS 1
+#endif
+
+#ifdef ROUTING_DV
+// Tasca del següent anunci de rutes
+static Task* advertTask = nullptr;
+#endif
+
 static routing_rx_callback_t onPacketReceived = nullptr;
 static routing_tx_callback_t onPacketSent = nullptr;
 static routing_tx_callback_t onTxError = nullptr;
 
 static std::vector<mac_id_t> higherLayerPackets;
 
+// Paquet serialitzat per passar a (o obtenir de) MAC. Estàtic per no ocupar `MAC_MAX_DATA_SIZE` a la pila;
+// sempre es serialitza just abans d'enviar, i es deserialitza just després de rebre
+static mac_data_t packetBuffer;
+
+#if defined(ROUTING_CUT_THROUGH) && defined(ROUTING_NETWORK_CODING)
+    // Els paquets a reenviar han de passar per la cua de codificació
+    #undef ROUTING_CUT_THROUGH
+#endif
+
 static void _printPacket(const routing_pdu_t* const pdu);
 static void _onMacReceived(void);
 static void _onMacSend(uint16_t);
 static void _onMacTxFailed(uint16_t);
+static void _onMacTxDropped(uint16_t);
+static void _notifyTxFailed(uint16_t id);
+#ifdef ROUTING_CUT_THROUGH
+static node_address_t _onMacForward(uint8_t* data, size_t* length, size_t maxLength, node_address_t tx);
+#endif
+#ifndef ROUTING_NETWORK_CODING
+static bool _onMacTransit(const uint8_t* data, size_t length, node_address_t tx);
+static size_t _peekHeader(const uint8_t* data, size_t length, node_address_t tx, node_address_t* src, node_address_t* dst, uint8_t* ttl);
+static node_address_t _transitNextHop(node_address_t dst, uint8_t ttl);
+#endif
 static void _onWANReceived(void);
-static void _processReceivedPacket(size_t length);
+static void _processReceivedPacket();
 static void _packetReceived();
 static void _packetSent(uint16_t id);
 static void _packetTxFailed(uint16_t id);
 static routing_err_t _sendThroughLoRaWAN(routing_pdu_t* pdu, uint16_t* id=nullptr);
 static void _WANPacketSent();
 static void _WANPacketTxFailed();
+static size_t _packetToBytes(const routing_pdu_t* const pdu, node_address_t macTx, node_address_t macRx, uint8_t* out);
+static bool _bytesToPacket(const uint8_t* in, size_t length, node_address_t macTx, node_address_t macRx, routing_pdu_t* pdu);
+static mac_err_t _sendToMac(const routing_pdu_t* const pdu, node_address_t nextHop, uint16_t* id = nullptr);
+static mac_err_t _sendRouted(const routing_pdu_t* const pdu, node_address_t* nextHop, uint16_t* id = nullptr);
+#ifdef ROUTING_FAILOVER
+static mac_err_t _sendToRoute(const routing_pdu_t* const pdu, node_address_t* nextHop, uint16_t* id, uint8_t* tried, size_t* count);
+static bool _isDemoted(node_address_t addr);
+static void _demote(node_address_t addr);
+static routing_pending_t* _findPending(uint16_t macId);
+static void _runFailover(void);
+#endif
+#ifdef ROUTING_DV
+static void _scheduleAdvert(unsigned long delay);
+static void _sendAdvert(void);
+#endif
+#ifdef ROUTING_NETWORK_CODING
+static bool _forwardCoded(node_address_t nextHop);
+static void _scheduleCodingFlush(void);
+static void _flushCodingQueue(void);
+#endif
+
+#if defined(ROUTING_FAILOVER) && ROUTING_ROUTE_HOPS > 8
+    #error "ROUTING_TABLE_MAX_BACKUPS no pot ser major a 7 amb ROUTING_FAILOVER (salts intentats en 8 bits)"
+#endif
+
+#if defined(COMPACT_HEADERS) && ROUTING_MAX_TTL > 7
+    #error "ROUTING_MAX_TTL no pot ser major a 7 amb COMPACT_HEADERS (camp de 3 bits)"
+#endif
 
 bool Routing_init(node_address_t selfAddr, bool is_gateway) {
     // Inicialitzar capa MAC
@@ -59,10 +150,24 @@ bool Routing_init(node_address_t selfAddr, bool is_gateway) {
     MAC_onReceive(_onMacReceived);
     MAC_onSend(_onMacSend);
     MAC_onTxFailed(_onMacTxFailed);
+    MAC_onTxDropped(_onMacTxDropped);
+#ifdef ROUTING_CUT_THROUGH
+    MAC_onForward(_onMacForward);
+#endif
+#ifndef ROUTING_NETWORK_CODING
+    // Amb codificació, els reenviaments poden esperar a la cua de codificació: MAC reconeix els frames abans de lliurar-los
+    MAC_onTransit(_onMacTransit);
+#endif
 
     LW_onReceive(_onWANReceived);
 
-    _PI("[ROUTING] Initialized");
+#ifdef ROUTING_DV
+    // Primer anunci aviat, amb retard aleatori perquè no coincideixin els nodes que arrenquen alhora
+    RoutingDV_init(self);
+    _scheduleAdvert(random(0, ROUTING_DV_INTERVAL_MS / 4));
+#endif
+
+    _PI("[ROUTING] Initialized (header: %d-%d B)", ROUTING_MIN_HEADERS_SIZE, ROUTING_HEADERS_SIZE);
     return true;
 }
 
@@ -70,22 +175,38 @@ void Routing_deinit() {
     onPacketReceived = nullptr;
     onPacketSent = onTxError = nullptr;
     higherLayerPackets.clear();
+#ifdef ROUTING_DV
+    if (advertTask != nullptr) {
+        scheduler_stop(advertTask);
+        advertTask = nullptr;
+    }
+#endif
+#ifdef ROUTING_FAILOVER
+    memset(pending, 0, sizeof(pending));
+    memset(demoted, 0, sizeof(demoted));
+#endif
+#ifdef ROUTING_NETWORK_CODING
+    RoutingNC_clear();
+#endif
     RoutingTable_deinit();
     LW_deinit();
     MAC_deinit();
     _PI("[ROUTING] Deinitialized");
 }
 
-routing_err_t Routing_send(node_address_t dst, const routing_data_t data, size_t length, uint16_t* id) {
+routing_err_t Routing_send(node_address_t dst, const routing_data_t data, size_t length, uint16_t* id, bool noAck) {
     if(length > ROUTING_MAX_DATA_SIZE) {
         _PW("[ROUTING] Data too long (%d)", length);
         return ROUTING_ERR_MAX_LENGTH;
     }
 
+    bool isBroadcast = dst == NODE_ADDRESS_BROADCAST;
+
     txPDU.src = self;
     txPDU.dst = dst;
-    txPDU.ttl = ROUTING_MAX_TTL;
+    txPDU.ttl = isBroadcast ? 1 : ROUTING_MAX_TTL; // Broadcast és d'un únic salt; no es reenvia
     txPDU.dataLength = length;
+    txPDU.noAck = noAck;
     memcpy(txPDU.data, data, length);
 
     _PI("[ROUTING] Sending packet:");
@@ -94,8 +215,8 @@ routing_err_t Routing_send(node_address_t dst, const routing_data_t data, size_t
     uint16_t packetID;
     routing_err_t state = ROUTING_ERR;
 
-    // Obtenim següent salt. Si no existeix ruta, descartem
-    node_address_t nextHop = RoutingTable_getRoute(dst);
+    // Obtenim següent salt. Si no existeix ruta, descartem. Broadcast no consulta taula: arriba a tots els veïns
+    node_address_t nextHop = isBroadcast ? NODE_ADDRESS_BROADCAST : RoutingTable_getRoute(dst);
     if(nextHop == 0x00) {
         _PW("[ROUTING] No route to 0x%02X", dst);
         return ROUTING_ERR_NO_ROUTE;
@@ -109,8 +230,8 @@ routing_err_t Routing_send(node_address_t dst, const routing_data_t data, size_t
         state = _sendThroughLoRaWAN(&txPDU, &packetID);
     }
     else { // En altres casos, és per la mateixa xarxa, i s'envia a través de RAW
-        mac_err_t err = MAC_send(nextHop, (uint8_t*)&txPDU, length+ROUTING_HEADERS_SIZE, &packetID);
-        state = err == MAC_SUCCESS ? ROUTING_SUCCESS : ROUTING_ERR;
+        mac_err_t err = isBroadcast ? _sendToMac(&txPDU, nextHop, &packetID) : _sendRouted(&txPDU, &nextHop, &packetID);
+        state = err == MAC_SUCCESS ? ROUTING_SUCCESS : err == MAC_ERR_UNREACHABLE ? ROUTING_ERR_UNREACHABLE : ROUTING_ERR;
     
         // Si s'ha pogut enviar, afegir a llista de paquets que cal notificar a capa superior
         // És responabilitat de capa superior guardar-se ID per si vol actuar sobre aquest paquet i event
@@ -122,9 +243,9 @@ routing_err_t Routing_send(node_address_t dst, const routing_data_t data, size_t
 
 
     // Filtrem errors de TX
-    if(state == ROUTING_ERR) {
-        _PW("[ROUTING] Error sending PDU");
-        return ROUTING_ERR;
+    if(state != ROUTING_SUCCESS) {
+        _PW("[ROUTING] Error sending PDU (next hop 0x%02X%s)", nextHop, state == ROUTING_ERR_UNREACHABLE ? " unreachable" : "");
+        return state;
     }
 
     if (id)
@@ -134,6 +255,17 @@ routing_err_t Routing_send(node_address_t dst, const routing_data_t data, size_t
     return ROUTING_SUCCESS;
 }
 
+bool Routing_isReachable(node_address_t dst) {
+    node_address_t hops[ROUTING_ROUTE_HOPS];
+    size_t count = RoutingTable_getRoutes(dst, hops, ROUTING_ROUTE_HOPS);
+    for (size_t i = 0; i < count; i++) {
+        if ((isGateway && hops[i] == NODE_ADDRESS_GATEWAY) || MAC_isReachable(hops[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
 node_address_t Routing_receive(routing_data_t* data, size_t* length) {
     // Executat per capa superior després que s'executi el callback configurat
 
@@ -149,7 +281,18 @@ void Routing_onTxError(routing_tx_callback_t cb) { onTxError = cb; }
 
 static routing_err_t _sendThroughLoRaWAN(routing_pdu_t* pdu, uint16_t* id) {
     _PI("[ROUTING] Sending packet to gateway. Forwarding to LoRaWAN");
-    bool state = LW_send((uint8_t*)pdu, pdu->dataLength+ROUTING_HEADERS_SIZE);
+    // El servidor no coneix adreces de MAC; no s'omet cap adreça
+    size_t packetLength = _packetToBytes(pdu, NODE_ADDRESS_NULL, NODE_ADDRESS_NULL, packetBuffer);
+    // LoRaWAN no fragmenta: paquets més grans que un frame (fragmentats a MAC) no es poden reenviar
+    bool state = packetLength <= LORA_MAX_SIZE;
+    if (state) {
+        // Durant l'uplink, la ràdio no pot rebre de la xarxa LoRa: els veïns ajornen els frames per nosaltres
+        MAC_announceDeaf(LW_UPLINK_DEAF_MS);
+        state = LW_send(packetBuffer, packetLength);
+    }
+    else {
+        _PW("[ROUTING] Packet too long for LoRaWAN (%d)", packetLength);
+    }
     if (id) 
         *id = 0; // ID = 0 no es pot generar mai a capa MAC, per tant és un valor segur per identificar que és un paquet LoRaWAN
                  // Tampoc s'hauria de donar el cas que es vulguin fer dues transmissions WAN simultànies (bloquejant)   
@@ -164,9 +307,33 @@ static routing_err_t _sendThroughLoRaWAN(routing_pdu_t* pdu, uint16_t* id) {
     }
 }
 
-static void _processReceivedPacket(size_t length) {
-    // Si destí de paquet som nosalters, notifiquem capa superior
-    if(rxPDU.dst == self) {
+static void _processReceivedPacket() {
+#ifdef ROUTING_NETWORK_CODING
+    // Paquet codificat per un node intermedi: s'obté el paquet per nosaltres, i es processa com si l'hagués reenviat
+    if (RoutingNC_isCoded(&rxPDU)) {
+        codedPDU = rxPDU;
+        if (!RoutingNC_decode(&codedPDU, self, &rxPDU)) {
+            return;
+        }
+        rxPrevHop = codedPDU.src;
+    }
+#endif
+
+#ifdef ROUTING_DV
+    // Anunci de rutes d'un veí. No es lliura a capa superior. Per LoRaWAN no n'arriben (no hi ha veí)
+    if (RoutingDV_isAdvert(&rxPDU)) {
+        if (rxPrevHop != NODE_ADDRESS_NULL) {
+            RoutingDV_process(&rxPDU, rxPrevHop);
+        }
+        return;
+    }
+    if (rxPrevHop != NODE_ADDRESS_NULL) {
+        RoutingDV_onTraffic(rxPDU.src, rxPrevHop);
+    }
+#endif
+
+    // Si destí de paquet som nosalters (o tots els veïns), notifiquem capa superior
+    if(rxPDU.dst == self || rxPDU.dst == NODE_ADDRESS_BROADCAST) {
         _PI("[ROUTING] Received packet from 0x%02X", rxPDU.src);
         _printPacket(&rxPDU);
         _packetReceived();
@@ -203,8 +370,19 @@ static void _processReceivedPacket(size_t length) {
         return;
     }
     else { // En altres casos, és per la mateixa xarxa, i s'envia a través de RAW
-        // Reenviem amb MAC_send, i ens despreocupem de si s'acaba enviant o no; MAC ja ho intentarà gestionar tant bé com pugui (reintents, BEB, etc.)
-        mac_err_t err = MAC_send(nextHop, (uint8_t*)&rxPDU, length); // MAClength no hauria de canviar si únicament es canvia TTL
+#ifdef ROUTING_NETWORK_CODING
+        if (_forwardCoded(nextHop)) {
+            return;
+        }
+#endif
+        // Reenviem amb MAC_send; MAC ja ho intentarà gestionar tant bé com pugui (reintents, BEB, etc.), i si no pot
+        // entregar-lo, es prova pels salts alternatius (ROUTING_FAILOVER)
+        // Es torna a serialitzar: adreces omeses depenen de l'emissor i receptor MAC de cada salt. Mateixa classe d'entrega
+        mac_err_t err = _sendRouted(&rxPDU, &nextHop);
+        if (err != MAC_SUCCESS) {
+            _PW("[ROUTING] Error forwarding packet to 0x%02X (next hop 0x%02X, %d)", rxPDU.dst, nextHop, err);
+            return;
+        }
     }
 
     _PI("[ROUTING] Forwarded packet to 0x%02X", rxPDU.dst);
@@ -215,30 +393,151 @@ static void _onWANReceived(void) {
     // Cal processar-ho i actuar com si fos una recepció de MAC
     size_t length;
     uint8_t port;
-    if(!LW_receive((uint8_t*)&rxPDU, &length, &port)) {
+    lora_data_t packet;
+    if(!LW_receive(packet, &length, &port)) {
         _PW("[ROUTING] No data received from LoRaWAN");
         return;
     }
-    _processReceivedPacket(length);
+    if(!_bytesToPacket(packet, length, NODE_ADDRESS_NULL, NODE_ADDRESS_NULL, &rxPDU)) {
+        _PW("[ROUTING] Invalid packet received from LoRaWAN (%d)", length);
+        return;
+    }
+    rxPDU.noAck = false;
+    rxPrevHop = NODE_ADDRESS_NULL;
+    _processReceivedPacket();
 }
 
 static void _onMacReceived(void) {
     // Executat quan MAC obté un frame per nosaltres; cal que processem el paquet
     // i veure si és per nosaltres o cal reenviar-lo
     size_t MAClength = 0;
-    // Podem copiar directament sobre PDU, ja es farà el mapeig correcte
-    node_address_t tx = MAC_receive((mac_data_t*)&rxPDU, &MAClength);
+    bool noAck = false;
+    node_address_t tx = MAC_receive(&packetBuffer, &MAClength, &noAck);
 
     // La mida ha de ser com a mínim la del header, si no no és vàlid
-    if (MAClength < ROUTING_HEADERS_SIZE) {
+    if (!_bytesToPacket(packetBuffer, MAClength, tx, self, &rxPDU)) {
         _PW("[ROUTING] Packet too short (%d)", MAClength);
         return;
     }
+    rxPDU.noAck = noAck;
+    rxPrevHop = tx;
+
+    _processReceivedPacket();
+}
+
+#ifdef ROUTING_CUT_THROUGH
+// Reenviament directe des de MAC: si el paquet és per un altre node i no necessita cap tractament de `_processReceivedPacket()`
+// a part de decrementar el TTL, en reescriu el header a `data` (sense copiar-lo a rxPDU) i retorna el següent salt.
+// Si no, el deixa intacte i retorna NODE_ADDRESS_NULL: MAC el lliura normalment, i s'hi tracten la resta de casos
+static node_address_t _onMacForward(uint8_t* data, size_t* length, size_t maxLength, node_address_t tx) {
+    node_address_t src, dst;
+    uint8_t ttl;
+    size_t headerSize = _peekHeader(data, *length, tx, &src, &dst, &ttl);
+    node_address_t nextHop = headerSize > 0 ? _transitNextHop(dst, ttl) : NODE_ADDRESS_NULL;
+    if (nextHop == NODE_ADDRESS_NULL) {
+        return NODE_ADDRESS_NULL;
+    }
+#ifdef ROUTING_FAILOVER
+    // Amb alternatius, el paquet s'ha de retenir per reenviar-lo per un altre salt si falla
+    node_address_t hops[ROUTING_ROUTE_HOPS];
+    if (RoutingTable_getRoutes(dst, hops, ROUTING_ROUTE_HOPS) > 1) {
+        return NODE_ADDRESS_NULL;
+    }
+#endif
+
+    ttl--;
+#ifdef COMPACT_HEADERS
+    // Les adreces omeses depenen de l'emissor i receptor MAC de cada salt: el header pot canviar de mida
+    routing_compact_ctrl_t fwdCtrl = {};
+    fwdCtrl.ttl = ttl;
+    fwdCtrl.srcElided = src == self;
+    fwdCtrl.dstElided = dst == nextHop;
+    size_t fwdHeaderSize = ROUTING_HEADERS_SIZE - fwdCtrl.srcElided - fwdCtrl.dstElided;
+    size_t dataLength = *length - headerSize;
+    if (fwdHeaderSize + dataLength > maxLength) {
+        return NODE_ADDRESS_NULL;
+    }
+    if (fwdHeaderSize != headerSize) {
+        memmove(&data[fwdHeaderSize], &data[headerSize], dataLength);
+    }
+    size_t index = 0;
+    memcpy(&data[index++], &fwdCtrl, sizeof(routing_compact_ctrl_t));
+    if (!fwdCtrl.srcElided) data[index++] = src;
+    if (!fwdCtrl.dstElided) data[index++] = dst;
+    *length = fwdHeaderSize + dataLength;
+#else
+    (void)maxLength;
+    data[2] = ttl;
+#endif
+
+#ifdef ROUTING_DV
+    RoutingDV_onTraffic(src, tx);
+#endif
+    _PI("[ROUTING] Cut-through packet from 0x%02X to 0x%02X (next hop 0x%02X)", src, dst, nextHop);
+    return nextHop;
+}
+#endif
+
+#ifndef ROUTING_NETWORK_CODING
+// Indica a MAC si un frame rebut es reenviarà a un altre node tot just lliurat (amb MAC_IMPLICIT_ACK, el reenviament
+// en fa d'ACK). Si no, MAC n'envia l'ACK abans de lliurar-lo, sense esperar que es processi
+static bool _onMacTransit(const uint8_t* data, size_t length, node_address_t tx) {
+    node_address_t src, dst;
+    uint8_t ttl;
+    return _peekHeader(data, length, tx, &src, &dst, &ttl) > 0 && _transitNextHop(dst, ttl) != NODE_ADDRESS_NULL;
+}
 
-    _processReceivedPacket(MAClength);
+// Llegeix el header d'un paquet rebut per MAC de `tx`, sense copiar-lo. Retorna la mida del header, o 0 si no hi cap
+static size_t _peekHeader(const uint8_t* data, size_t length, node_address_t tx, node_address_t* src, node_address_t* dst, uint8_t* ttl) {
+#ifdef COMPACT_HEADERS
+    routing_compact_ctrl_t ctrl;
+    memcpy(&ctrl, data, sizeof(routing_compact_ctrl_t));
+    size_t headerSize = ROUTING_HEADERS_SIZE - ctrl.srcElided - ctrl.dstElided;
+    if (length < headerSize) {
+        return 0;
+    }
+    size_t index = sizeof(routing_compact_ctrl_t);
+    *src = ctrl.srcElided ? tx : data[index++];
+    *dst = ctrl.dstElided ? self : data[index++];
+    *ttl = ctrl.ttl;
+    return headerSize;
+#else
+    (void)tx;
+    if (length < ROUTING_HEADERS_SIZE) {
+        return 0;
+    }
+    *src = data[0];
+    *dst = data[1];
+    *ttl = data[2];
+    return ROUTING_HEADERS_SIZE;
+#endif
 }
 
+// Següent salt per reenviar per MAC un paquet per `dst`, o `NODE_ADDRESS_NULL` si no s'hi reenvia directament:
+// per nosaltres, broadcast (també els codificats), anuncis de rutes, TTL esgotat, sense ruta, o cap a LoRaWAN
+static node_address_t _transitNextHop(node_address_t dst, uint8_t ttl) {
+    if (dst == self || dst == NODE_ADDRESS_BROADCAST || dst == NODE_ADDRESS_NULL || ttl <= 1) {
+        return NODE_ADDRESS_NULL;
+    }
+    node_address_t nextHop = RoutingTable_getRoute(dst);
+    if (nextHop == NODE_ADDRESS_NULL || (isGateway && nextHop == NODE_ADDRESS_GATEWAY) || !MAC_isReachable(nextHop)) {
+        return NODE_ADDRESS_NULL;
+    }
+    return nextHop;
+}
+#endif
+
 static void _onMacSend(uint16_t id) {
+#ifdef ROUTING_NETWORK_CODING
+    _scheduleCodingFlush();
+#endif
+#ifdef ROUTING_FAILOVER
+    routing_pending_t* p = _findPending(id);
+    if (p != nullptr) {
+        p->used = false;
+        id = p->id;
+    }
+#endif
     int pos = 0; // Per guardar quin element s'ha d'eliminar
     for(int value : higherLayerPackets) { // iterar per cada element del vector
         if(value == id) {
@@ -251,6 +550,43 @@ static void _onMacSend(uint16_t id) {
 }
 
 static void _onMacTxFailed(uint16_t id) {
+#ifdef ROUTING_NETWORK_CODING
+    _scheduleCodingFlush();
+#endif
+#ifdef ROUTING_FAILOVER
+    // Es reenvia més tard per un salt alternatiu: MAC notifica l'error mentre processa la seva cua.
+    // La capa superior només se n'assabenta si tampoc es pot enviar per cap alternatiu
+    routing_pending_t* p = _findPending(id);
+    if (p != nullptr) {
+        p->failed = true;
+        if (!failoverScheduled) {
+            failoverScheduled = true;
+            scheduler_once(_runFailover);
+        }
+        return;
+    }
+#endif
+    _notifyTxFailed(id);
+}
+
+// Frame descartat per MAC per congestió (AQM), no per error d'entrega: el salt funciona, i reenviar-lo per un alternatiu
+// només afegiria càrrega al mateix camí. Es notifica l'error directament, sense failover ni degradar el salt
+static void _onMacTxDropped(uint16_t id) {
+#ifdef ROUTING_NETWORK_CODING
+    _scheduleCodingFlush();
+#endif
+#ifdef ROUTING_FAILOVER
+    routing_pending_t* p = _findPending(id);
+    if (p != nullptr) {
+        p->used = false;
+        id = p->id;
+    }
+#endif
+    _notifyTxFailed(id);
+}
+
+// Notifica a capa superior l'error d'un paquet que hi ha enviat (amb l'ID retornat per `Routing_send()`)
+static void _notifyTxFailed(uint16_t id) {
     int pos = 0; // Per guardar quin element s'ha d'eliminar
     for(int value : higherLayerPackets) { // iterar per cada element del vector
         if(value == id) {
@@ -291,6 +627,264 @@ static void _WANPacketTxFailed() {
     _packetTxFailed(0);
 }
 
+// Envia el paquet per MAC al següent salt. Amb codificació, en reté una còpia per descodificar paquets codificats que el continguin
+static mac_err_t _sendToMac(const routing_pdu_t* const pdu, node_address_t nextHop, uint16_t* id) {
+    size_t packetLength = _packetToBytes(pdu, self, nextHop, packetBuffer);
+#ifdef ROUTING_NETWORK_CODING
+    RoutingNC_retain(pdu);
+#endif
+    return MAC_send(nextHop, packetBuffer, packetLength, id, pdu->noAck);
+}
+
+// Envia el paquet pel següent salt de la ruta cap al seu destí. Amb salts alternatius (ROUTING_FAILOVER), prova el primer
+// disponible, i el guarda per reenviar-lo per un altre si MAC no el pot entregar. `nextHop` retorna el salt utilitzat
+static mac_err_t _sendRouted(const routing_pdu_t* const pdu, node_address_t* nextHop, uint16_t* id) {
+#ifdef ROUTING_FAILOVER
+    uint8_t tried = 0;
+    size_t count = 0;
+    uint16_t macId;
+    mac_err_t err = _sendToRoute(pdu, nextHop, &macId, &tried, &count);
+    if (id) {
+        *id = macId;
+    }
+    // Sense ACK de MAC no hi ha errors d'entrega; si ja s'han intentat tots els salts, no hi ha alternativa
+    if (err != MAC_SUCCESS || pdu->noAck || tried == (1 << count) - 1) {
+        return err;
+    }
+    for (size_t i = 0; i < ROUTING_FAILOVER_PENDING; i++) {
+        if (!pending[i].used) {
+            pending[i].used = true;
+            pending[i].failed = false;
+            pending[i].macId = pending[i].id = macId;
+            pending[i].nextHop = *nextHop;
+            pending[i].tried = tried;
+            pending[i].pdu = *pdu;
+            return err;
+        }
+    }
+    _PW("[ROUTING] No room to retain packet %d for failover", macId);
+    return err;
+#else
+    return _sendToMac(pdu, *nextHop, id);
+#endif
+}
+
+#ifdef ROUTING_DV
+static void _scheduleAdvert(unsigned long delay) {
+    advertTask = scheduler_once(_sendAdvert, delay);
+}
+
+// Envia en broadcast un anunci de rutes, i programa el següent, amb fins a un 25% de retard aleatori
+static void _sendAdvert(void) {
+    advertTask = nullptr;
+    RoutingDV_buildAdvert(&txPDU);
+    size_t packetLength = _packetToBytes(&txPDU, self, NODE_ADDRESS_BROADCAST, packetBuffer);
+    if (MAC_send(NODE_ADDRESS_BROADCAST, packetBuffer, packetLength) != MAC_SUCCESS) {
+        _PW("[ROUTING] Error sending route advert");
+    }
+    _scheduleAdvert(ROUTING_DV_INTERVAL_MS + random(0, ROUTING_DV_INTERVAL_MS / 4));
+}
+#endif
+
+#ifdef ROUTING_FAILOVER
+// Envia el paquet pel primer salt de la ruta encara no intentat: primer els no degradats, i si no n'hi ha, els degradats.
+// Els salts inaccessibles a MAC es degraden i se salten. `count` retorna el nombre de salts de la ruta
+static mac_err_t _sendToRoute(const routing_pdu_t* const pdu, node_address_t* nextHop, uint16_t* id, uint8_t* tried, size_t* count) {
+    node_address_t hops[ROUTING_ROUTE_HOPS];
+    *count = RoutingTable_getRoutes(pdu->dst, hops, ROUTING_ROUTE_HOPS);
+    mac_err_t err = MAC_ERR_UNREACHABLE;
+    for (int pass = 0; pass < 2; pass++) {
+        for (size_t i = 0; i < *count; i++) {
+            // LoRaWAN no és una alternativa: els paquets pel gateway només surten per la ruta principal
+            if ((*tried & (1 << i)) || _isDemoted(hops[i]) != (pass == 1) || (isGateway && hops[i] == NODE_ADDRESS_GATEWAY)) {
+                continue;
+            }
+            *tried |= 1 << i;
+            *nextHop = hops[i];
+            err = _sendToMac(pdu, hops[i], id);
+            if (err != MAC_ERR_UNREACHABLE) {
+                return err; // Enviat, o error que tampoc es resoldria amb un altre salt (p. ex. cua plena)
+            }
+            _demote(hops[i]);
+        }
+    }
+    return err;
+}
+
+static bool _isDemoted(node_address_t addr) {
+    for (size_t i = 0; i < ROUTING_FAILOVER_MAX_DEMOTED; i++) {
+        if (demoted[i].addr == addr && (long)(demoted[i].until - millis()) > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void _demote(node_address_t addr) {
+    // Es reutilitza l'entrada del mateix salt, o si no n'hi ha, la que acaba abans (les caducades, les primeres)
+    size_t index = 0;
+    for (size_t i = 0; i < ROUTING_FAILOVER_MAX_DEMOTED; i++) {
+        if (demoted[i].addr == addr) {
+            index = i;
+            break;
+        }
+        if ((long)(demoted[i].until - demoted[index].until) < 0) {
+            index = i;
+        }
+    }
+    demoted[index].addr = addr;
+    demoted[index].until = millis() + ROUTING_FAILOVER_COOLDOWN_MS;
+    _PI("[ROUTING] Next hop 0x%02X demoted for %d ms", addr, ROUTING_FAILOVER_COOLDOWN_MS);
+}
+
+static routing_pending_t* _findPending(uint16_t macId) {
+    for (size_t i = 0; i < ROUTING_FAILOVER_PENDING; i++) {
+        if (pending[i].used && pending[i].macId == macId) {
+            return &pending[i];
+        }
+    }
+    return nullptr;
+}
+
+// Reenvia per un salt alternatiu els paquets que MAC no ha pogut entregar. Si no n'hi ha cap, es notifica l'error
+static void _runFailover(void) {
+    failoverScheduled = false;
+    for (size_t i = 0; i < ROUTING_FAILOVER_PENDING; i++) {
+        routing_pending_t* p = &pending[i];
+        if (!p->used || !p->failed) {
+            continue;
+        }
+        _demote(p->nextHop);
+        node_address_t failedHop = p->nextHop;
+        size_t count;
+        uint16_t macId;
+        if (_sendToRoute(&p->pdu, &p->nextHop, &macId, &p->tried, &count) == MAC_SUCCESS) {
+            _PI("[ROUTING] Packet %d to 0x%02X failed through 0x%02X; resent through 0x%02X", p->id, p->pdu.dst, failedHop, p->nextHop);
+            p->macId = macId;
+            p->failed = false;
+            continue;
+        }
+        _PW("[ROUTING] Packet %d to 0x%02X failed; no next hop left", p->id, p->pdu.dst);
+        p->used = false;
+        _notifyTxFailed(p->id);
+    }
+}
+#endif
+
+#ifdef ROUTING_NETWORK_CODING
+// Amb MAC ocupada, el paquet a reenviar espera a la cua de codificació (on igualment hauria d'esperar), on pot coincidir
+// amb un paquet en sentit contrari; llavors s'envien tots dos en un únic broadcast. Retorna `false` si cal enviar-lo ara
+static bool _forwardCoded(node_address_t nextHop) {
+    if (MAC_isAvailable() || rxPrevHop == NODE_ADDRESS_NULL) {
+        return false;
+    }
+    routing_nc_result_t result = RoutingNC_enqueue(&rxPDU, rxPrevHop, nextHop, &codedPDU);
+    if (result == ROUTINGNC_FULL) {
+        return false;
+    }
+    if (result == ROUTINGNC_CODED) {
+        codedPDU.src = self;
+        size_t packetLength = _packetToBytes(&codedPDU, self, NODE_ADDRESS_BROADCAST, packetBuffer);
+        MAC_send(NODE_ADDRESS_BROADCAST, packetBuffer, packetLength);
+    }
+    _scheduleCodingFlush();
+    return true;
+}
+
+static void _scheduleCodingFlush(void) {
+    if (!flushScheduled) {
+        flushScheduled = true;
+        scheduler_once(_flushCodingQueue, MAC_isAvailable() ? 0 : ROUTING_NC_FLUSH_RETRY_MS);
+    }
+}
+
+// Quan MAC queda lliure, envia sense codificar el paquet més antic de la cua de codificació
+static void _flushCodingQueue(void) {
+    flushScheduled = false;
+    if (!MAC_isAvailable()) {
+        if (RoutingNC_pending() > 0) {
+            _scheduleCodingFlush(); // Encara hi ha paquets esperant: es torna a comprovar més tard
+        }
+        return;
+    }
+    node_address_t nextHop;
+    if (RoutingNC_dequeue(&codedPDU, &nextHop)) {
+        _sendToMac(&codedPDU, nextHop);
+    }
+}
+#endif
+
+// Serialitza el paquet al format que s'envia a capa inferior. Retorna la mida total.
+// `macTx` i `macRx` són les adreces de MAC del salt; en format compacte, s'ometen les adreces que hi coincideixen
+static size_t _packetToBytes(const routing_pdu_t* const pdu, node_address_t macTx, node_address_t macRx, uint8_t* out) {
+#ifdef COMPACT_HEADERS
+    // Format compacte: [CTRL|SRC?|DST?|DATA|...|DATA]
+    routing_compact_ctrl_t ctrl = {};
+    ctrl.ttl = pdu->ttl;
+    ctrl.srcElided = macTx != NODE_ADDRESS_NULL && pdu->src == macTx;
+    ctrl.dstElided = macRx != NODE_ADDRESS_NULL && pdu->dst == macRx;
+
+    size_t index = 0;
+    memcpy(&out[index++], &ctrl, sizeof(routing_compact_ctrl_t));
+    if (!ctrl.srcElided) out[index++] = pdu->src;
+    if (!ctrl.dstElided) out[index++] = pdu->dst;
+    memcpy(&out[index], pdu->data, pdu->dataLength);
+    return index + pdu->dataLength;
+#else
+    // Format estàndard: [SRC|DST|TTL|LEN|DATA|...|DATA]. LEN ocupa ROUTING_LENGTH_FIELD_SIZE bytes (little-endian)
+    (void)macTx;
+    (void)macRx;
+    size_t index = 0;
+    out[index++] = pdu->src;
+    out[index++] = pdu->dst;
+    out[index++] = pdu->ttl;
+    memcpy(&out[index], &pdu->dataLength, ROUTING_LENGTH_FIELD_SIZE);
+    index += ROUTING_LENGTH_FIELD_SIZE;
+    memcpy(&out[index], pdu->data, pdu->dataLength);
+    return index + pdu->dataLength;
+#endif
+}
+
+// Obté el paquet a partir de les dades de capa inferior. Retorna `false` si no és vàlid
+static bool _bytesToPacket(const uint8_t* in, size_t length, node_address_t macTx, node_address_t macRx, routing_pdu_t* pdu) {
+    // Mida mínima del header, i màxima que hi cap a la PDU (LoRaWAN pot rebre frames més grans que MAC)
+    if (length < ROUTING_MIN_HEADERS_SIZE || length > ROUTING_HEADERS_SIZE + ROUTING_MAX_DATA_SIZE) {
+        return false;
+    }
+#ifdef COMPACT_HEADERS
+    routing_compact_ctrl_t ctrl;
+    size_t index = 0;
+    memcpy(&ctrl, &in[index++], sizeof(routing_compact_ctrl_t));
+    size_t headerSize = ROUTING_HEADERS_SIZE - ctrl.srcElided - ctrl.dstElided;
+    if (length < headerSize || length - headerSize > ROUTING_MAX_DATA_SIZE) {
+        return false;
+    }
+    pdu->ttl = ctrl.ttl;
+    pdu->src = ctrl.srcElided ? macTx : in[index++];
+    pdu->dst = ctrl.dstElided ? macRx : in[index++];
+    pdu->dataLength = length - headerSize;
+    memcpy(pdu->data, &in[index], pdu->dataLength);
+#else
+    (void)macTx;
+    (void)macRx;
+    if (length < ROUTING_HEADERS_SIZE) {
+        return false;
+    }
+    size_t index = 0;
+    pdu->src = in[index++];
+    pdu->dst = in[index++];
+    pdu->ttl = in[index++];
+    pdu->dataLength = 0;
+    memcpy(&pdu->dataLength, &in[index], ROUTING_LENGTH_FIELD_SIZE);
+    index += ROUTING_LENGTH_FIELD_SIZE;
+    if (pdu->dataLength > length - ROUTING_HEADERS_SIZE) {
+        return false;
+    }
+    memcpy(pdu->data, &in[index], pdu->dataLength);
+#endif
+    return true;
+}
+
 #if LOG_LEVEL <= LOG_LEVEL_INFO
 void _printPacket(const routing_pdu_t* const pdu) {
     // Mostra info de PDU en format maco.
@@ -0,0 +1,248 @@
+/*
+    Codificació de xarxa (XOR) als nodes intermedis, pel trànsit bidireccional d'una cadena (estil COPE).
+
+    Un node intermedi que ha de reenviar un paquet A (esquerra -> dreta) i un paquet B (dreta -> esquerra)
+    envia un únic broadcast amb A xor B. El node de la dreta va enviar B, i en té una còpia retinguda: obté A fent
+    xor amb B. El de l'esquerra fa el mateix amb A. Així, per cada parella es fa una transmissió en lloc de dues.
+
+    Els paquets a reenviar només esperen a la cua de codificació mentre MAC està ocupada (on igualment esperarien),
+    de manera que la codificació és oportunista i no afegeix latència.
+
+    Els operands del xor són la forma canònica del paquet tal com l'ha rebut el node intermedi (abans de decrementar
+    el TTL), independent del format de header: [SRC|DST|TTL|LEN_L|LEN_H|DATA|...|DATA]. El node que el descodifica
+    hi aplica el salt (decrementa el TTL).
+
+    Format del paquet codificat (dades d'un paquet d'encaminament broadcast amb TTL 0):
+    [RX_1|KEY_1_L|KEY_1_H|LEN_1_L|LEN_1_H|RX_2|KEY_2_L|KEY_2_H|LEN_2_L|LEN_2_H|XOR|...|XOR]
+    Per cada receptor, KEY és el hash del paquet que aquest va enviar (i té retingut), i LEN la mida del paquet que obtindrà.
+    El xor té la mida del paquet més gran; el més curt s'omple amb zeros.
+*/
+
+#include <Arduino.h>
+#include <vector>
+#include "routing_coding.h"
+#include "utils.h"
+
+#define ROUTING_NC_CANONICAL_HEADER_SIZE 5
+#define ROUTING_NC_ENTRY_SIZE 5
+#define ROUTING_NC_CODED_HEADER_SIZE (2 * ROUTING_NC_ENTRY_SIZE)
+#define ROUTING_NC_CANONICAL_MAX_SIZE (ROUTING_NC_CANONICAL_HEADER_SIZE + ROUTING_MAX_DATA_SIZE)
+
+// Paquet a reenviar, en forma canònica
+typedef struct {
+    node_address_t prevHop;
+    node_address_t nextHop;
+    bool noAck;
+    uint16_t length;
+    uint8_t* canonical;
+} routing_nc_pending_t;
+
+// Paquet enviat retingut per descodificar
+typedef struct {
+    uint16_t hash;
+    uint16_t length;
+    uint8_t* canonical;
+} routing_nc_retained_t;
+
+static std::vector<routing_nc_pending_t> pending;
+static routing_nc_retained_t retained[ROUTING_NC_RETAIN_SIZE] = {};
+static size_t nextRetained = 0;
+
+// Paquet en forma canònica, per no ocupar-ne la mida a la pila
+static uint8_t canonicalBuffer[ROUTING_NC_CANONICAL_MAX_SIZE];
+
+static routing_nc_stats_t stats = {};
+
+static size_t _toCanonical(const routing_pdu_t* const pdu, uint8_t ttl, uint8_t* out);
+static bool _fromCanonical(const uint8_t* in, size_t length, routing_pdu_t* pdu);
+static uint16_t _hash(const uint8_t* data, size_t length);
+static uint8_t* _copy(const uint8_t* data, size_t length);
+
+bool RoutingNC_isCoded(const routing_pdu_t* const pdu) {
+    return pdu->ttl == 0 && pdu->dst == NODE_ADDRESS_BROADCAST;
+}
+
+void RoutingNC_retain(const routing_pdu_t* const pdu) {
+    size_t length = _toCanonical(pdu, pdu->ttl, canonicalBuffer);
+    uint8_t* copy = _copy(canonicalBuffer, length);
+    if (copy == nullptr) {
+        return;
+    }
+    routing_nc_retained_t* entry = &retained[nextRetained];
+    free(entry->canonical);
+    entry->canonical = copy;
+    entry->length = length;
+    entry->hash = _hash(copy, length);
+    nextRetained = (nextRetained + 1) % ROUTING_NC_RETAIN_SIZE;
+}
+
+routing_nc_result_t RoutingNC_enqueue(const routing_pdu_t* const pdu, node_address_t prevHop, node_address_t nextHop, routing_pdu_t* coded) {
+    // Tal com s'ha rebut: el TTL encara no estava decrementat
+    uint16_t length = _toCanonical(pdu, pdu->ttl + 1, canonicalBuffer);
+
+    for (auto partner = pending.begin(); partner != pending.end(); ++partner) {
+        if (partner->prevHop != nextHop || partner->nextHop != prevHop ||
+            MAX(length, partner->length) + ROUTING_NC_CODED_HEADER_SIZE > ROUTING_MAX_DATA_SIZE) {
+            continue;
+        }
+
+        // Cada receptor descodifica amb el paquet que ell mateix ens va enviar
+        uint16_t codedLength = MAX(length, partner->length);
+        uint8_t* out = coded->data;
+        out[0] = nextHop;                                   // Obté aquest paquet amb el de la parella
+        uint16_t key = _hash(partner->canonical, partner->length);
+        memcpy(&out[1], &key, sizeof(key));
+        memcpy(&out[3], &length, sizeof(uint16_t));
+        out[5] = prevHop;                                   // Obté el de la parella amb aquest paquet
+        key = _hash(canonicalBuffer, length);
+        memcpy(&out[6], &key, sizeof(key));
+        memcpy(&out[8], &partner->length, sizeof(uint16_t));
+
+        uint8_t* xored = out + ROUTING_NC_CODED_HEADER_SIZE;
+        for (size_t i = 0; i < codedLength; i++) {
+            xored[i] = (i < length ? canonicalBuffer[i] : 0) ^ (i < partner->length ? partner->canonical[i] : 0);
+        }
+
+        coded->dst = NODE_ADDRESS_BROADCAST;
+        coded->ttl = 0;
+        coded->dataLength = ROUTING_NC_CODED_HEADER_SIZE + codedLength;
+        coded->noAck = false;
+
+        free(partner->canonical);
+        pending.erase(partner);
+        stats.codingOpportunities++;
+        _PI("[ROUTING-NC] Coded packets for 0x%02X and 0x%02X (%d B)", nextHop, prevHop, coded->dataLength);
+        return ROUTINGNC_CODED;
+    }
+
+    if (pending.size() >= ROUTING_NC_QUEUE_SIZE) {
+        return ROUTINGNC_FULL;
+    }
+    uint8_t* copy = _copy(canonicalBuffer, length);
+    if (copy == nullptr) {
+        return ROUTINGNC_FULL;
+    }
+    pending.push_back({ prevHop, nextHop, pdu->noAck, length, copy });
+    stats.held++;
+    _PI("[ROUTING-NC] Holding packet for 0x%02X (queue: %d)", nextHop, pending.size());
+    return ROUTINGNC_QUEUED;
+}
+
+bool RoutingNC_dequeue(routing_pdu_t* pdu, node_address_t* nextHop) {
+    while (!pending.empty()) {
+        routing_nc_pending_t entry = pending.front();
+        pending.erase(pending.begin());
+        bool valid = _fromCanonical(entry.canonical, entry.length, pdu);
+        free(entry.canonical);
+        if (valid) {
+            pdu->ttl--; // Salt que aplica aquest node
+            pdu->noAck = entry.noAck;
+            *nextHop = entry.nextHop;
+            stats.nativeSent++;
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t RoutingNC_pending() { return pending.size(); }
+
+bool RoutingNC_decode(const routing_pdu_t* const coded, node_address_t self, routing_pdu_t* pdu) {
+    if (coded->dataLength < ROUTING_NC_CODED_HEADER_SIZE) {
+        return false;
+    }
+    const uint8_t* in = coded->data;
+    size_t codedLength = coded->dataLength - ROUTING_NC_CODED_HEADER_SIZE;
+    const uint8_t* xored = in + ROUTING_NC_CODED_HEADER_SIZE;
+
+    for (size_t e = 0; e < 2; e++) {
+        const uint8_t* entry = in + e * ROUTING_NC_ENTRY_SIZE;
+        if (entry[0] != self) {
+            continue;
+        }
+        uint16_t key, length;
+        memcpy(&key, &entry[1], sizeof(key));
+        memcpy(&length, &entry[3], sizeof(length));
+
+        for (size_t i = 0; i < ROUTING_NC_RETAIN_SIZE; i++) {
+            const routing_nc_retained_t* own = &retained[i];
+            if (own->canonical == nullptr || own->hash != key || length > codedLength || own->length > codedLength) {
+                continue;
+            }
+            for (size_t j = 0; j < length; j++) {
+                canonicalBuffer[j] = xored[j] ^ (j < own->length ? own->canonical[j] : 0);
+            }
+            // La mida indicada al paquet descodificat ha de ser coherent; si no, el paquet retingut no era el correcte
+            if (_fromCanonical(canonicalBuffer, length, pdu) && pdu->ttl > 1) {
+                pdu->ttl--; // Salt que ha fet el node que l'ha codificat
+                pdu->noAck = false;
+                stats.decoded++;
+                _PI("[ROUTING-NC] Decoded packet from 0x%02X", coded->src);
+                return true;
+            }
+        }
+        stats.decodeMisses++;
+        _PW("[ROUTING-NC] Could not decode packet from 0x%02X (own packet not retained)", coded->src);
+        return false;
+    }
+    return false;
+}
+
+void RoutingNC_clear() {
+    for (auto& entry : pending) {
+        free(entry.canonical);
+    }
+    pending.clear();
+    for (size_t i = 0; i < ROUTING_NC_RETAIN_SIZE; i++) {
+        free(retained[i].canonical);
+        retained[i] = {};
+    }
+    nextRetained = 0;
+}
+
+routing_nc_stats_t RoutingNC_getStats() { return stats; }
+
+static size_t _toCanonical(const routing_pdu_t* const pdu, uint8_t ttl, uint8_t* out) {
+    out[0] = pdu->src;
+    out[1] = pdu->dst;
+    out[2] = ttl;
+    memcpy(&out[3], &pdu->dataLength, sizeof(uint16_t));
+    memcpy(&out[ROUTING_NC_CANONICAL_HEADER_SIZE], pdu->data, pdu->dataLength);
+    return ROUTING_NC_CANONICAL_HEADER_SIZE + pdu->dataLength;
+}
+
+static bool _fromCanonical(const uint8_t* in, size_t length, routing_pdu_t* pdu) {
+    if (length < ROUTING_NC_CANONICAL_HEADER_SIZE) {
+        return false;
+    }
+    uint16_t dataLength;
+    memcpy(&dataLength, &in[3], sizeof(uint16_t));
+    if (dataLength != length - ROUTING_NC_CANONICAL_HEADER_SIZE || dataLength > ROUTING_MAX_DATA_SIZE) {
+        return false;
+    }
+    pdu->src = in[0];
+    pdu->dst = in[1];
+    pdu->ttl = in[2];
+    pdu->dataLength = dataLength;
+    memcpy(pdu->data, &in[ROUTING_NC_CANONICAL_HEADER_SIZE], dataLength);
+    return true;
+}
+
+// FNV-1a de 32 bits, plegat a 16
+static uint16_t _hash(const uint8_t* data, size_t length) {
+    uint32_t hash = 2166136261UL;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ data[i]) * 16777619UL;
+    }
+    return (hash >> 16) ^ (hash & 0xFFFF);
+}
+
+static uint8_t* _copy(const uint8_t* data, size_t length) {
+    uint8_t* copy = (uint8_t*)malloc(length);
+    if (copy == nullptr) {
+        _PE("[ROUTING-NC] Error allocating packet copy");
+        return nullptr;
+    }
+    memcpy(copy, data, length);
+    return copy;
+}
@@ -0,0 +1,282 @@
+/*
+    Aprenentatge de rutes per vector de distàncies (ROUTING_DV), amb ETX com a mètrica.
+
+    Cada node envia periòdicament en broadcast d'un únic salt les rutes que coneix, i cada veí en calcula el cost
+    a través seu sumant-hi l'ETX de l'enllaç. Per cada destí, s'instal·la a la taula de rutes el veí amb menor cost.
+    Per evitar oscil·lacions, només es canvia de següent salt si el nou camí és millor en ROUTING_DV_HYSTERESIS, i en
+    ROUTING_DV_HYSTERESIS_PERCENT del cost actual (el soroll de l'ETX creix amb els salts), o si l'actual ha caducat
+    (cap notícia en ROUTING_DV_ROUTE_TIMEOUT_MS). Les rutes caducades s'anuncien com a inaccessibles.
+    Un cost per sobre de ROUTING_DV_MAX_ETX també és inaccessible: acota el comptatge a infinit dels bucles de 3 o més
+    nodes que es poden formar després d'una fallada (el split horizon només evita els de 2).
+
+    ETX de l'enllaç = 1 / (df · dr). dr és la proporció d'anuncis del veí rebuts (per forats al número de seqüència,
+    amb mitjana exponencial). df és la proporció d'intents de dades amb ACK cap al veí (`MAC_getLinkStats()`); fins que
+    no n'hi ha prou, es considera igual a dr (enllaç simètric).
+
+    Format de l'anunci (dades d'un paquet d'encaminament broadcast amb destí NODE_ADDRESS_NULL i TTL 1):
+    [SEQ|DST_1|HOP_1|METRIC_1|...|DST_N|HOP_N|METRIC_N]
+    HOP és el següent salt del node que anuncia: el veí descarta les rutes que passen per ell mateix (split horizon).
+
+    Les rutes ja instal·lades en arrencar (estàtiques, o apreses abans d'un reinici) es mantenen fins que un altre veí
+    ofereix un camí prou millor que el que anuncia el salt actual.
+*/
+
+#include <Arduino.h>
+#include "routing_dv.h"
+#include "utils.h"
+
+#define ROUTING_DV_ENTRY_SIZE 3
+// L'anunci ha de cabre en un únic frame (broadcast, sense fragmentar)
+#define ROUTING_DV_MAX_ADVERT_SIZE MIN((size_t)ROUTING_MAX_DATA_SIZE, (size_t)(MAC_MAX_FRAME_DATA_SIZE - ROUTING_HEADERS_SIZE))
+// Intents de dades cap a un veí a partir dels quals se'n mesura df
+#define ROUTING_DV_MIN_TX_SAMPLES 8
+// Proporció d'entrega inicial d'un veí nou, en 1/256
+#define ROUTING_DV_INITIAL_DELIVERY 128
+
+// Veí del qual es reben anuncis
+typedef struct {
+    node_address_t addr;
+    uint8_t lastSeq;
+    uint16_t delivery;          // Proporció d'anuncis rebuts (dr), en 1/256
+    unsigned long lastHeard;
+} routing_dv_neighbor_t;
+
+// Ruta apresa cap a un destí
+typedef struct {
+    node_address_t dst;
+    node_address_t nextHop;
+    uint8_t metric;             // ETX del camí, en 1/ROUTING_DV_METRIC_UNIT
+    unsigned long updatedAt;    // Última notícia del camí pel següent salt actual
+} routing_dv_route_t;
+
+static node_address_t self = NODE_ADDRESS_NULL;
+static routing_dv_neighbor_t neighbors[ROUTING_DV_MAX_NEIGHBORS];
+static size_t neighborCount = 0;
+static routing_dv_route_t routes[ROUTING_DV_MAX_ROUTES];
+static size_t routeCount = 0;
+static uint8_t seq = 0;
+static size_t nextAdvertRoute = 0;
+
+static routing_dv_stats_t stats = {};
+
+static routing_dv_neighbor_t* _updateNeighbor(node_address_t addr, uint8_t advertSeq);
+static uint8_t _linkMetric(const routing_dv_neighbor_t* const nb);
+static void _consider(node_address_t dst, node_address_t via, uint8_t cost);
+static routing_dv_route_t* _findRoute(node_address_t dst);
+static bool _isExpired(const routing_dv_route_t* const route);
+static void _install(const routing_dv_route_t* const route);
+
+void RoutingDV_init(node_address_t selfAddr) {
+    self = selfAddr;
+    neighborCount = routeCount = nextAdvertRoute = 0;
+    seq = random(0, 256);
+}
+
+bool RoutingDV_isAdvert(const routing_pdu_t* const pdu) {
+    return pdu->dst == NODE_ADDRESS_NULL;
+}
+
+void RoutingDV_process(const routing_pdu_t* const pdu, node_address_t prevHop) {
+    if (pdu->dataLength < 1 || (pdu->dataLength - 1) % ROUTING_DV_ENTRY_SIZE != 0) {
+        _PW("[ROUTING-DV] Invalid advert from 0x%02X (%d B)", prevHop, pdu->dataLength);
+        return;
+    }
+    stats.advertsReceived++;
+    routing_dv_neighbor_t* nb = _updateNeighbor(prevHop, pdu->data[0]);
+    uint8_t link = _linkMetric(nb);
+
+    // El mateix veí és un destí a un salt
+    _consider(prevHop, prevHop, link);
+    for (size_t i = 1; i < pdu->dataLength; i += ROUTING_DV_ENTRY_SIZE) {
+        node_address_t dst = pdu->data[i];
+        node_address_t hop = pdu->data[i + 1];
+        uint8_t metric = pdu->data[i + 2];
+        if (dst == self || dst == prevHop) {
+            continue;
+        }
+        // Split horizon: el camí del veí passa per nosaltres, i no ens serveix. Un cost total per sobre del límit és
+        // inaccessible (no es retalla): si no, un bucle s'anunciaria a si mateix per sempre
+        bool unreachable = hop == self || metric > ROUTING_DV_METRIC_MAX || link == ROUTING_DV_METRIC_INF ||
+            metric + link > ROUTING_DV_METRIC_MAX;
+        _consider(dst, prevHop, unreachable ? ROUTING_DV_METRIC_INF : metric + link);
+    }
+}
+
+void RoutingDV_onTraffic(node_address_t src, node_address_t prevHop) {
+    routing_dv_route_t* route = _findRoute(src);
+    if (route != nullptr && route->nextHop == prevHop && route->metric != ROUTING_DV_METRIC_INF) {
+        route->updatedAt = millis();
+    }
+}
+
+void RoutingDV_buildAdvert(routing_pdu_t* pdu) {
+    pdu->src = self;
+    pdu->dst = NODE_ADDRESS_NULL;
+    pdu->ttl = 1;
+    pdu->noAck = false;
+    pdu->data[0] = seq++;
+    pdu->dataLength = 1;
+
+    size_t maxEntries = (ROUTING_DV_MAX_ADVERT_SIZE - 1) / ROUTING_DV_ENTRY_SIZE;
+    size_t start = routeCount > 0 ? nextAdvertRoute % routeCount : 0;
+    size_t count = 0;
+    for (; count < routeCount && count < maxEntries; count++) {
+        const routing_dv_route_t* route = &routes[(start + count) % routeCount];
+        pdu->data[pdu->dataLength++] = route->dst;
+        pdu->data[pdu->dataLength++] = route->nextHop;
+        pdu->data[pdu->dataLength++] = _isExpired(route) ? ROUTING_DV_METRIC_INF : route->metric;
+    }
+    nextAdvertRoute = start + count;
+    stats.advertsSent++;
+}
+
+routing_dv_stats_t RoutingDV_getStats() {
+    return stats;
+}
+
+// Actualitza la proporció d'entrega d'un veí amb un nou anunci: cada anunci perdut (forat a la seqüència) la redueix,
+// i el rebut l'augmenta. Si no hi cap, substitueix el veí escoltat fa més temps
+static routing_dv_neighbor_t* _updateNeighbor(node_address_t addr, uint8_t advertSeq) {
+    routing_dv_neighbor_t* nb = nullptr;
+    for (size_t i = 0; i < neighborCount; i++) {
+        if (neighbors[i].addr == addr) {
+            nb = &neighbors[i];
+            break;
+        }
+    }
+    if (nb == nullptr) {
+        if (neighborCount < ROUTING_DV_MAX_NEIGHBORS) {
+            nb = &neighbors[neighborCount++];
+        }
+        else {
+            nb = &neighbors[0];
+            for (size_t i = 1; i < neighborCount; i++) {
+                if ((long)(neighbors[i].lastHeard - nb->lastHeard) < 0) {
+                    nb = &neighbors[i];
+                }
+            }
+        }
+        nb->addr = addr;
+        nb->delivery = ROUTING_DV_INITIAL_DELIVERY;
+    }
+    else {
+        uint8_t missed = MIN((uint8_t)(advertSeq - nb->lastSeq - 1), 8);
+        for (uint8_t i = 0; i < missed; i++) {
+            nb->delivery -= nb->delivery / 8;
+        }
+        nb->delivery += (256 - nb->delivery) / 8;
+    }
+    nb->lastSeq = advertSeq;
+    nb->lastHeard = millis();
+    return nb;
+}
+
+static uint8_t _linkMetric(const routing_dv_neighbor_t* const nb) {
+    uint32_t dr = nb->delivery;
+    uint32_t df = dr;
+    mac_link_stats_t link;
+    if (MAC_getLinkStats(nb->addr, &link)) {
+        if (link.unreachable) {
+            return ROUTING_DV_METRIC_INF;
+        }
+        if (link.txAttempts >= ROUTING_DV_MIN_TX_SAMPLES) {
+            df = 256 * (link.txAttempts - link.txNoAck) / link.txAttempts;
+        }
+    }
+    if (df == 0 || dr == 0) {
+        return ROUTING_DV_METRIC_INF;
+    }
+    uint32_t etx = ROUTING_DV_METRIC_UNIT * 256 * 256 / (df * dr);
+    return etx > ROUTING_DV_METRIC_MAX ? ROUTING_DV_METRIC_INF : etx;
+}
+
+// Compara el camí cap a `dst` a través del veí `via` amb el de la ruta actual, i l'instal·la si és prou millor
+static void _consider(node_address_t dst, node_address_t via, uint8_t cost) {
+    routing_dv_route_t* route = _findRoute(dst);
+    if (route == nullptr) {
+        if (cost == ROUTING_DV_METRIC_INF) {
+            return;
+        }
+        // Si és plena, es reutilitza una ruta caducada. La seva entrada a la taula de rutes s'elimina (si encara és la
+        // que hi ha instal·lat l'aprenentatge): sense seguiment, ja no es corregiria mai
+        for (size_t i = 0; routeCount == ROUTING_DV_MAX_ROUTES && i < routeCount; i++) {
+            if (_isExpired(&routes[i])) {
+                route = &routes[i];
+            }
+        }
+        if (route != nullptr && RoutingTable_getRoute(route->dst) == route->nextHop) {
+            _PI("[ROUTING-DV] Route to 0x%02X expired; replaced by 0x%02X", route->dst, dst);
+            if (RoutingTable_removeRoute(route->dst)) {
+                stats.routeChanges++;
+            }
+        }
+        if (route == nullptr) {
+            if (routeCount == ROUTING_DV_MAX_ROUTES) {
+                stats.tableFull++;
+                return;
+            }
+            route = &routes[routeCount++];
+        }
+        // Una ruta ja instal·lada es considera tan bona com la nova fins que el seu salt n'anunciï el cost real
+        node_address_t installed = RoutingTable_getRoute(dst);
+        route->dst = dst;
+        route->nextHop = installed != NODE_ADDRESS_NULL ? installed : via;
+        route->metric = cost;
+        route->updatedAt = millis();
+        _install(route);
+        return;
+    }
+
+    if (route->nextHop == via) {
+        // Mateix salt: el cost s'actualitza encara que empitjori, però només es refresca si continua sent accessible
+        if (cost == ROUTING_DV_METRIC_INF && route->metric != ROUTING_DV_METRIC_INF
+            && RoutingTable_getRoute(dst) == route->nextHop) {
+            // El salt ja no hi arriba: s'elimina l'entrada instal·lada, per no continuar-li enviant el trànsit
+            _PI("[ROUTING-DV] Route to 0x%02X unreachable through 0x%02X", dst, via);
+            if (RoutingTable_removeRoute(dst)) {
+                stats.routeChanges++;
+            }
+        }
+        route->metric = cost;
+        if (cost != ROUTING_DV_METRIC_INF) {
+            route->updatedAt = millis();
+        }
+        return;
+    }
+    if (cost == ROUTING_DV_METRIC_INF) {
+        return;
+    }
+    // Una ruta caducada se substitueix per qualsevol camí accessible, encara que el seu últim cost fos menor
+    if (!_isExpired(route) && cost + MAX(ROUTING_DV_HYSTERESIS, route->metric * ROUTING_DV_HYSTERESIS_PERCENT / 100) > route->metric) {
+        if (cost < route->metric) {
+            stats.changesSuppressed++;
+        }
+        return;
+    }
+    _PI("[ROUTING-DV] Route to 0x%02X: 0x%02X (%d/%d) -> 0x%02X (%d/%d)", dst, route->nextHop, route->metric,
+        ROUTING_DV_METRIC_UNIT, via, cost, ROUTING_DV_METRIC_UNIT);
+    route->nextHop = via;
+    route->metric = cost;
+    route->updatedAt = millis();
+    _install(route);
+}
+
+static routing_dv_route_t* _findRoute(node_address_t dst) {
+    for (size_t i = 0; i < routeCount; i++) {
+        if (routes[i].dst == dst) {
+            return &routes[i];
+        }
+    }
+    return nullptr;
+}
+
+static bool _isExpired(const routing_dv_route_t* const route) {
+    return route->metric == ROUTING_DV_METRIC_INF || millis() - route->updatedAt > ROUTING_DV_ROUTE_TIMEOUT_MS;
+}
+
+// Instal·la la ruta a la taula de rutes. Només s'escriu (a NVS) si canvia el següent salt
+static void _install(const routing_dv_route_t* const route) {
+    if (RoutingTable_getRoute(route->dst) != route->nextHop && RoutingTable_updateRoute(route->dst, route->nextHop)) {
+        stats.routeChanges++;
+    }
+}
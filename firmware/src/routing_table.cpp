@@ -1,24 +1,78 @@
+/*
+    Taula de rutes, indexada directament per adreça de destí.
+
+    Persistència a NVS amb diari (journal): cada canvi s'afegeix com un registre de 2 bytes (dst i nextHop; nextHop
+    nul si s'esborra) en una clau pròpia, "rj<índex>", i no reescriu tota la taula. Els registres es compacten a la
+    còpia sencera ("routingTable", parelles dst/nextHop) quan n'hi ha ROUTING_TABLE_JOURNAL_SIZE, o amb `RoutingTable_commit()`.
+
+    Recuperació: en inicialitzar, es llegeix la còpia sencera i s'hi apliquen en ordre els registres a partir de
+    "rtJournalBase" fins al primer que no existeixi. Cada registre és una única escriptura de NVS (atòmica), i porta el
+    valor final del destí, no una diferència: aplicar-lo sobre una còpia que ja l'inclou no canvia res. Per això, compactar és:
+        1. Escriure la còpia sencera. Si falla aquí, es torna a aplicar tot el diari sobre la nova còpia: mateix resultat
+        2. Avançar "rtJournalBase" fins al final del diari. A partir d'aquí, els registres anteriors ja no s'apliquen
+        3. Esborrar els registres anteriors, en ordre. Si falla aquí, els que quedin s'esborren en la següent inicialització
+
+    Rutes per rang (dst_lo..dst_hi -> nextHop), per cadenes llargues on tots els destins a cada costat comparteixen següent salt.
+    La ruta per defecte és el rang sencer. Les rutes exactes tenen preferència, i entre rangs, el més estret que conté
+    el destí. N'hi ha poques i canvien poc: es guarden sense diari, amb la taula de rangs sencera a "rtRanges".
+
+    Salts alternatius per destí, en ordre de preferència, pel failover de la capa d'encaminament quan falla el principal
+    (p. ex. enllaços N -> N+2 a més potència en una línia). Com els rangs, són pocs i es guarden sencers a "rtBackups".
+*/
+
 #include "routing_table.h"
 #include "Preferences.h"
 #include "utils.h"
 
+// Mida màxima d'una clau de NVS, amb el '\0'
+#define RTABLE_KEY_SIZE 16
+
 static Preferences preferences;
 
-static routing_entry_t* RoutingTable; 
+// Taula indexada directament per adreça de destí (8 bits): `nextHops[dst]` és el següent salt, o `NODE_ADDRESS_NULL` si no
+// hi ha ruta. Cerca O(1) i sense memòria dinàmica; ocupa menys que l'array d'entrades amb totes les rutes possibles
+static node_address_t nextHops[1 << (8 * sizeof(node_address_t))];
 static int RoutingTableSize = 0;
 
-static int _getIndexInRoutingTable(node_address_t dst);
+// Taula en el format de NVS (parelles dst/nextHop), per llegir-la i escriure-la
+static routing_entry_t nvsBuffer[sizeof(nextHops)];
+
+// Diari: índex del primer registre pendent de compactar, i del següent registre a escriure
+static uint32_t journalBase = 0;
+static uint32_t journalNext = 0;
+
+// Rutes per rang (la ruta per defecte inclosa)
+static routing_range_entry_t ranges[ROUTING_TABLE_MAX_RANGES];
+static size_t rangeCount = 0;
+
+// Salts alternatius per destí
+static routing_backup_entry_t backups[ROUTING_TABLE_MAX_BACKUP_ROUTES];
+static size_t backupCount = 0;
+
+static routing_table_stats_t stats = {};
+
 static bool _saveTableToNVS();
+static bool _persistRoute(node_address_t dst);
+static void _journalKey(uint32_t index, char* key);
+static void _setRoute(node_address_t dst, node_address_t nextHop);
+static void _recordWrite(uint32_t* count, uint32_t* sumUs, unsigned long startUs);
+static int _findRange(node_address_t dstLo, node_address_t dstHi);
+static node_address_t _getRangeRoute(node_address_t dst);
+static bool _saveRangesToNVS();
+static int _findBackups(node_address_t dst);
+static bool _saveBackupsToNVS();
 
 
 bool RoutingTable_init() {
     // Obtenir rutes de NVS (no volàtil) i copiar-ho a routing table
     // A NVS es guarda com una seqüència de bytes, on el primer byte indica dst i el segon nextHop
     // té una única entrada a la key "routingTable" (max 15 chars). 
-    // La mida màxima d'una entrada a NVS en format BLOB 
-    // (Binary Large OBject) és "508000 bytes or (97.6% of the partition size - 4000) bytes whichever is lower."
-    // així que si cada entrada són 2 byets (dst+nextHop), el màxim de rutes és virtualment "infinit" (125000)
+    // Com a màxim hi ha una entrada per cada adreça de destí (512 B)
     // https://docs.espressif.com/projects/esp-idf/en/stable/esp32/api-reference/storage/nvs_flash.html
+    memset(nextHops, NODE_ADDRESS_NULL, sizeof(nextHops));
+    RoutingTableSize = 0;
+    rangeCount = 0;
+    backupCount = 0;
 
     if(!preferences.begin("routingTable")){
         _PE("[RTABLE] Error initializing NVS");
@@ -26,79 +80,154 @@ bool RoutingTable_init() {
     }
 
     // Mida en bytes de la taula de rutes
-    int sizeInBytes = preferences.getBytesLength("routingTable");
-    // Quantitat d'entrades a la taula de rutes (en funció de mida d'entrada de routing_entry)
-    RoutingTableSize = sizeInBytes / sizeof(routing_entry_t);
-    if(RoutingTableSize == 0) {
-        _PI("[RTABLE] No routing table found in NVS; initializing empty table");
-        return true;
-    }
-    // Assignar la memòria necessaria per guardar totes les rutes
-    RoutingTable = (routing_entry_t*)malloc(sizeInBytes);
-    if (!RoutingTable) {
-        _PE("[RTABLE] Error allocating memory for routing table");
+    size_t sizeInBytes = preferences.getBytesLength("routingTable");
+    if(sizeInBytes > sizeof(nvsBuffer)) {
+        _PE("[RTABLE] Routing table in NVS too long (%d B)", sizeInBytes);
         return false;
     }
 
-    // Guardar taules de rutes. El mapeig serà el correcte (és un apuntador amb memòria contigua i mida correcta per malloc)
-    int bytesRead = preferences.getBytes("routingTable", RoutingTable, sizeInBytes);
+    size_t bytesRead = sizeInBytes > 0 ? preferences.getBytes("routingTable", nvsBuffer, sizeInBytes) : 0;
     if (bytesRead != sizeInBytes) {
         _PE("[RTABLE] Error reading routing table from NVS");
         return false;
     }
-    _PI("[RTABLE] Routing table initialized. (%d B, %d routes) Heap: %d", sizeInBytes, RoutingTableSize, ESP.getFreeHeap());
+    // Si hi ha entrades repetides per un destí, es queda l'última (la cerca lineal anterior retornava la primera,
+    // però les funcions d'escriptura no en generaven mai)
+    for (size_t i = 0; i < sizeInBytes / sizeof(routing_entry_t); i++) {
+        _setRoute(nvsBuffer[i].dst, nvsBuffer[i].nextHop);
+    }
+
+    size_t rangeBytes = preferences.getBytesLength("rtRanges");
+    if (rangeBytes > sizeof(ranges)) {
+        _PE("[RTABLE] Range routes in NVS too long (%d B)", rangeBytes);
+        return false;
+    }
+    if (rangeBytes > 0 && preferences.getBytes("rtRanges", ranges, rangeBytes) != rangeBytes) {
+        _PE("[RTABLE] Error reading range routes from NVS");
+        return false;
+    }
+    rangeCount = rangeBytes / sizeof(routing_range_entry_t);
+
+    size_t backupBytes = preferences.getBytesLength("rtBackups");
+    if (backupBytes > sizeof(backups)) {
+        _PE("[RTABLE] Backup routes in NVS too long (%d B)", backupBytes);
+        return false;
+    }
+    if (backupBytes > 0 && preferences.getBytes("rtBackups", backups, backupBytes) != backupBytes) {
+        _PE("[RTABLE] Error reading backup routes from NVS");
+        return false;
+    }
+    backupCount = backupBytes / sizeof(routing_backup_entry_t);
+
+    // Canvis posteriors a la còpia sencera, en ordre. Un registre mai és 0 (no hi ha rutes cap a NODE_ADDRESS_NULL)
+    char key[RTABLE_KEY_SIZE];
+    journalBase = preferences.getUInt("rtJournalBase", 0);
+    for (journalNext = journalBase; ; journalNext++) {
+        _journalKey(journalNext, key);
+        uint16_t record = preferences.getUShort(key, 0);
+        if (record == 0) {
+            break;
+        }
+        _setRoute(record >> 8, record & 0xFF);
+    }
+
+    // Registres ja compactats que no es van poder esborrar (reinici durant la compactació)
+    for (uint32_t i = journalBase; i > 0; i--) {
+        _journalKey(i - 1, key);
+        if (!preferences.isKey(key)) {
+            break;
+        }
+        preferences.remove(key);
+    }
+
+    if(sizeInBytes == 0 && journalNext == journalBase && rangeCount == 0 && backupCount == 0) {
+        _PI("[RTABLE] No routing table found in NVS; initializing empty table");
+        return true;
+    }
+    _PI("[RTABLE] Routing table initialized. (%d B, %d journal records, %d routes, %d ranges) Heap: %d",
+        sizeInBytes, journalNext - journalBase, RoutingTableSize, rangeCount, ESP.getFreeHeap());
     return true;
 }
 
 void RoutingTable_deinit() {
-    if (RoutingTable) {
-        free(RoutingTable);   // Alliberar memory
-        RoutingTable = nullptr;  
-    }
+    memset(nextHops, NODE_ADDRESS_NULL, sizeof(nextHops));
     RoutingTableSize = 0;  
+    rangeCount = 0;
+    backupCount = 0;
     preferences.end();
     _PI("[RTABLE] Routing table de-initialized. Heap: %d", ESP.getFreeHeap());
 }
 
 void RoutingTable_print() {
     Serial.println("=== RTABLE ===");
-    for (int i = 0; i < RoutingTableSize; ++i) {
-        Serial.printf(" 0x%02X -> 0x%02X\n", RoutingTable[i].dst, RoutingTable[i].nextHop);
+    for (size_t dst = 0; dst < sizeof(nextHops); ++dst) {
+        if (nextHops[dst] != NODE_ADDRESS_NULL) {
+            Serial.printf(" 0x%02X -> 0x%02X\n", dst, nextHops[dst]);
+        }
+    }
+    for (size_t i = 0; i < rangeCount; ++i) {
+        Serial.printf(" 0x%02X..0x%02X -> 0x%02X\n", ranges[i].dstLo, ranges[i].dstHi, ranges[i].nextHop);
+    }
+    for (size_t i = 0; i < backupCount; ++i) {
+        Serial.printf(" 0x%02X (backup) ->", backups[i].dst);
+        for (size_t j = 0; j < ROUTING_TABLE_MAX_BACKUPS && backups[i].nextHops[j] != NODE_ADDRESS_NULL; ++j) {
+            Serial.printf(" 0x%02X", backups[i].nextHops[j]);
+        }
+        Serial.println();
     }
     Serial.println("==============");
 }
 
 node_address_t RoutingTable_getRoute(node_address_t dst) {
-    int index = _getIndexInRoutingTable(dst);
-    if(index != -1) {
-        _PI("[RTABLE] Queried route for 0x%02X, through 0x%02X", dst, RoutingTable[index].nextHop);
-        return RoutingTable[index].nextHop;
+    node_address_t nextHop = nextHops[dst];
+    if(nextHop == NODE_ADDRESS_NULL && rangeCount > 0) {
+        nextHop = _getRangeRoute(dst);
+    }
+    if(nextHop != NODE_ADDRESS_NULL) {
+        _PI("[RTABLE] Queried route for 0x%02X, through 0x%02X", dst, nextHop);
+        return nextHop;
     }
     _PW("[RTABLE] Route for %d not found", dst);
     return NODE_ADDRESS_NULL;
 }
 
+size_t RoutingTable_getRoutes(node_address_t dst, node_address_t* hops, size_t maxHops) {
+    if (maxHops == 0) {
+        return 0;
+    }
+    hops[0] = RoutingTable_getRoute(dst);
+    if (hops[0] == NODE_ADDRESS_NULL) {
+        return 0;
+    }
+    size_t count = 1;
+    int index = backupCount > 0 ? _findBackups(dst) : -1;
+    for (size_t i = 0; index != -1 && i < ROUTING_TABLE_MAX_BACKUPS && count < maxHops; i++) {
+        node_address_t backup = backups[index].nextHops[i];
+        if (backup == NODE_ADDRESS_NULL) {
+            break;
+        }
+        if (backup != hops[0]) {
+            hops[count++] = backup;
+        }
+    }
+    return count;
+}
+
 bool RoutingTable_addRoute(node_address_t dst, node_address_t nextHop) {
     // Filtrem si ja existeix
-    if(_getIndexInRoutingTable(dst) != -1) {
+    if(nextHops[dst] != NODE_ADDRESS_NULL) {
         _PW("[RTABLE] Route for 0x%02X already exists", dst);
         return false;
     }
-
-    // Si no existeix: incrementar mida taula, reassignar memòria de routingtable, guardar registre i guardar a NVS
-    RoutingTableSize++;
-    RoutingTable = (routing_entry_t*)realloc(RoutingTable, RoutingTableSize * sizeof(routing_entry_t));
-    if (!RoutingTable) {
-        _PE("[RTABLE] Error reallocating memory for routing table");
+    if(dst == NODE_ADDRESS_NULL || nextHop == NODE_ADDRESS_NULL) {
+        _PW("[RTABLE] Invalid route 0x%02X -> 0x%02X", dst, nextHop);
         return false;
     }
 
-    // Afegir nova ruta
-    RoutingTable[RoutingTableSize-1].dst = dst;
-    RoutingTable[RoutingTableSize-1].nextHop = nextHop;
+    _setRoute(dst, nextHop);
 
-    // Guardar taula de rutes a NVS. Fer-ho ara i no en deinit per evitar perdre rutes en cas de crash
-    if(_saveTableToNVS()) {
+    // Guardar canvi a NVS. Fer-ho ara i no en deinit per evitar perdre rutes en cas de crash
+    if(_persistRoute(dst)) {
         _PI("[RTABLE] Route added: 0x%02X -> 0x%02X", dst, nextHop);
         return true;
     }
@@ -106,28 +235,15 @@ bool RoutingTable_addRoute(node_address_t dst, node_address_t nextHop) {
 }
 
 bool RoutingTable_removeRoute(node_address_t dst) {
-    int indexToRemove = _getIndexInRoutingTable(dst);
-
-    if (indexToRemove == -1) {
+    if (nextHops[dst] == NODE_ADDRESS_NULL) {
         _PW("[RTABLE] Route for 0x%02X not found", dst);
         return false;
     }
 
-    // Moure les entrades posteriors una posició cap endavant
-    for (int i = indexToRemove; i < RoutingTableSize - 1; ++i) {
-        RoutingTable[i] = RoutingTable[i + 1];
-    }
-
-    // Reduir la mida de la taula de rutes, i reassignar memòria sense la nova ruta
-    RoutingTableSize--;
-    RoutingTable = (routing_entry_t*)realloc(RoutingTable, RoutingTableSize * sizeof(routing_entry_t));
-    if (RoutingTableSize > 0 && !RoutingTable) {
-        _PE("[RTABLE] Error reallocating memory for routing table");
-        return false;
-    }
+    _setRoute(dst, NODE_ADDRESS_NULL);
 
-    // Guardar taula de rutes a NVS; fer-ho aquí i no després a deinit per evitar perdre dades si crash
-    if(_saveTableToNVS()) {
+    // Guardar canvi a NVS; fer-ho aquí i no després a deinit per evitar perdre dades si crash
+    if(_persistRoute(dst)) {
         _PI("[RTABLE] Route for 0x%02X removed", dst);
         return true;
     }
@@ -135,52 +251,274 @@ bool RoutingTable_removeRoute(node_address_t dst) {
 }
 
 bool RoutingTable_clear() {
-    // Alliberar memòria
-    free(RoutingTable);
-    RoutingTable = nullptr;
+    memset(nextHops, NODE_ADDRESS_NULL, sizeof(nextHops));
     RoutingTableSize = 0;
+    rangeCount = 0;
+    backupCount = 0;
 
-    // Esborrar taula de rutes de NVS
-    preferences.remove("routingTable");
+    // Esborrar taula de rutes i diari de NVS (l'espai de noms només conté la taula)
+    preferences.clear();
+    journalBase = journalNext = 0;
     _PI("[RTABLE] Routing table cleared. Heap: %d", ESP.getFreeHeap());
     return true;
 }
 
 bool RoutingTable_updateRoute(node_address_t dst, node_address_t nextHop) {
     // Si no existeix, creem ruta
-    int index = _getIndexInRoutingTable(dst);
-    if (index == -1) {
+    if (nextHops[dst] == NODE_ADDRESS_NULL) {
         return RoutingTable_addRoute(dst, nextHop);
     }
     // Si existeix, actualitzar nextHop i guardar a NVS
-    if(RoutingTable[index].nextHop == nextHop) {
+    if(nextHops[dst] == nextHop) {
         _PI("[RTABLE] No update for 0x%02X required", dst, nextHop);
         return true;
     }
-    RoutingTable[index].nextHop = nextHop;
-    if(_saveTableToNVS()) {
+    if(nextHop == NODE_ADDRESS_NULL) {
+        _PW("[RTABLE] Invalid next hop for 0x%02X", dst);
+        return false;
+    }
+    _setRoute(dst, nextHop);
+    if(_persistRoute(dst)) {
         _PI("[RTABLE] Route for 0x%02X updated. New nextHop: 0x%02X", dst, nextHop);
         return true;
     }
     return false;
 }
 
-static int _getIndexInRoutingTable(node_address_t dst) {
-    for (int i = 0; i < RoutingTableSize; ++i) {
-        if (RoutingTable[i].dst == dst) {
+bool RoutingTable_setRangeRoute(node_address_t dstLo, node_address_t dstHi, node_address_t nextHop) {
+    if (dstLo > dstHi || nextHop == NODE_ADDRESS_NULL) {
+        _PW("[RTABLE] Invalid range route 0x%02X..0x%02X -> 0x%02X", dstLo, dstHi, nextHop);
+        return false;
+    }
+    int index = _findRange(dstLo, dstHi);
+    if (index != -1 && ranges[index].nextHop == nextHop) {
+        _PI("[RTABLE] No update for 0x%02X..0x%02X required", dstLo, dstHi);
+        return true;
+    }
+    if (index == -1) {
+        if (rangeCount >= ROUTING_TABLE_MAX_RANGES) {
+            _PW("[RTABLE] Range routes full (%d)", ROUTING_TABLE_MAX_RANGES);
+            return false;
+        }
+        index = rangeCount++;
+        ranges[index].dstLo = dstLo;
+        ranges[index].dstHi = dstHi;
+    }
+    ranges[index].nextHop = nextHop;
+    if (_saveRangesToNVS()) {
+        _PI("[RTABLE] Range route set: 0x%02X..0x%02X -> 0x%02X", dstLo, dstHi, nextHop);
+        return true;
+    }
+    return false;
+}
+
+bool RoutingTable_removeRangeRoute(node_address_t dstLo, node_address_t dstHi) {
+    int index = _findRange(dstLo, dstHi);
+    if (index == -1) {
+        _PW("[RTABLE] Range route 0x%02X..0x%02X not found", dstLo, dstHi);
+        return false;
+    }
+    ranges[index] = ranges[--rangeCount];
+    if (_saveRangesToNVS()) {
+        _PI("[RTABLE] Range route 0x%02X..0x%02X removed", dstLo, dstHi);
+        return true;
+    }
+    return false;
+}
+
+bool RoutingTable_setDefaultRoute(node_address_t nextHop) {
+    return RoutingTable_setRangeRoute(0x00, 0xFF, nextHop);
+}
+
+bool RoutingTable_removeDefaultRoute() {
+    return RoutingTable_removeRangeRoute(0x00, 0xFF);
+}
+
+bool RoutingTable_setBackupRoutes(node_address_t dst, const node_address_t* hops, size_t count) {
+    if (dst == NODE_ADDRESS_NULL || count > ROUTING_TABLE_MAX_BACKUPS) {
+        _PW("[RTABLE] Invalid backup routes for 0x%02X (%d)", dst, count);
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (hops[i] == NODE_ADDRESS_NULL) {
+            _PW("[RTABLE] Invalid backup next hop for 0x%02X", dst);
+            return false;
+        }
+    }
+    int index = _findBackups(dst);
+    if (count == 0) {
+        if (index == -1) {
+            return true;
+        }
+        backups[index] = backups[--backupCount];
+    }
+    else {
+        if (index == -1) {
+            if (backupCount >= ROUTING_TABLE_MAX_BACKUP_ROUTES) {
+                _PW("[RTABLE] Backup routes full (%d)", ROUTING_TABLE_MAX_BACKUP_ROUTES);
+                return false;
+            }
+            index = backupCount++;
+            backups[index].dst = dst;
+        }
+        memset(backups[index].nextHops, NODE_ADDRESS_NULL, sizeof(backups[index].nextHops));
+        memcpy(backups[index].nextHops, hops, count * sizeof(node_address_t));
+    }
+    if (_saveBackupsToNVS()) {
+        _PI("[RTABLE] Backup routes for 0x%02X set (%d)", dst, count);
+        return true;
+    }
+    return false;
+}
+
+bool RoutingTable_commit() {
+    if (journalNext == journalBase) {
+        return true;
+    }
+    if (!_saveTableToNVS()) {
+        return false;
+    }
+    unsigned long start = micros();
+    if (preferences.putUInt("rtJournalBase", journalNext) == 0) {
+        _PE("[RTABLE] Error writing journal base to NVS");
+        return false; // Els registres es tornaran a aplicar sobre la nova còpia, amb el mateix resultat
+    }
+    _recordWrite(&stats.journalWrites, &stats.journalWriteUs, start);
+    uint32_t compacted = journalBase;
+    journalBase = journalNext;
+
+    char key[RTABLE_KEY_SIZE];
+    for (; compacted < journalBase; compacted++) {
+        _journalKey(compacted, key);
+        preferences.remove(key);
+    }
+    stats.commits++;
+    _PI("[RTABLE] Journal compacted (%d routes)", RoutingTableSize);
+    return true;
+}
+
+routing_table_stats_t RoutingTable_getStats() { return stats; }
+
+// Afegeix al diari el valor actual de la ruta cap a `dst`. Quan el diari és ple, el compacta a la còpia sencera
+static bool _persistRoute(node_address_t dst) {
+    char key[RTABLE_KEY_SIZE];
+    _journalKey(journalNext, key);
+    uint16_t record = (dst << 8) | nextHops[dst];
+    unsigned long start = micros();
+    if (preferences.putUShort(key, record) != sizeof(record)) {
+        _PE("[RTABLE] Error writing journal record %d to NVS", journalNext);
+        return false;
+    }
+    _recordWrite(&stats.journalWrites, &stats.journalWriteUs, start);
+    journalNext++;
+
+    if (journalNext - journalBase >= ROUTING_TABLE_JOURNAL_SIZE) {
+        return RoutingTable_commit();
+    }
+    return true;
+}
+
+static void _journalKey(uint32_t index, char* key) {
+    snprintf(key, RTABLE_KEY_SIZE, "rj%lX", (unsigned long)index);
+}
+
+static int _findRange(node_address_t dstLo, node_address_t dstHi) {
+    for (size_t i = 0; i < rangeCount; i++) {
+        if (ranges[i].dstLo == dstLo && ranges[i].dstHi == dstHi) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Següent salt del rang més estret que conté el destí (coincidència més llarga), o `NODE_ADDRESS_NULL`
+static node_address_t _getRangeRoute(node_address_t dst) {
+    node_address_t nextHop = NODE_ADDRESS_NULL;
+    int bestWidth = 0x100;
+    for (size_t i = 0; i < rangeCount; i++) {
+        int width = ranges[i].dstHi - ranges[i].dstLo;
+        if (dst >= ranges[i].dstLo && dst <= ranges[i].dstHi && width < bestWidth) {
+            nextHop = ranges[i].nextHop;
+            bestWidth = width;
+        }
+    }
+    return nextHop;
+}
+
+static bool _saveRangesToNVS() {
+    unsigned long start = micros();
+    if (rangeCount == 0) {
+        preferences.remove("rtRanges");
+    }
+    else if (preferences.putBytes("rtRanges", ranges, rangeCount * sizeof(routing_range_entry_t)) != rangeCount * sizeof(routing_range_entry_t)) {
+        _PE("[RTABLE] Error writing range routes to NVS");
+        return false;
+    }
+    _recordWrite(&stats.snapshotWrites, &stats.snapshotWriteUs, start);
+    return true;
+}
+
+static int _findBackups(node_address_t dst) {
+    for (size_t i = 0; i < backupCount; i++) {
+        if (backups[i].dst == dst) {
             return i;
         }
     }
     return -1;
 }
 
+static bool _saveBackupsToNVS() {
+    unsigned long start = micros();
+    if (backupCount == 0) {
+        preferences.remove("rtBackups");
+    }
+    else if (preferences.putBytes("rtBackups", backups, backupCount * sizeof(routing_backup_entry_t)) != backupCount * sizeof(routing_backup_entry_t)) {
+        _PE("[RTABLE] Error writing backup routes to NVS");
+        return false;
+    }
+    _recordWrite(&stats.snapshotWrites, &stats.snapshotWriteUs, start);
+    return true;
+}
+
+// Acumula una escriptura a NVS que ha començat a `startUs`
+static void _recordWrite(uint32_t* count, uint32_t* sumUs, unsigned long startUs) {
+    uint32_t elapsed = micros() - startUs;
+    (*count)++;
+    *sumUs += elapsed;
+    stats.maxWriteUs = MAX(stats.maxWriteUs, elapsed);
+}
+
+// Estableix (o esborra, amb `NODE_ADDRESS_NULL`) el següent salt cap a `dst`, mantenint el recompte de rutes
+static void _setRoute(node_address_t dst, node_address_t nextHop) {
+    RoutingTableSize += (nextHop != NODE_ADDRESS_NULL) - (nextHops[dst] != NODE_ADDRESS_NULL);
+    nextHops[dst] = nextHop;
+}
+
 static bool _saveTableToNVS() {
+    // Es guarda en el mateix format que es llegeix: parelles dst/nextHop, ara per ordre de destí
+    size_t count = 0;
+    for (size_t dst = 0; dst < sizeof(nextHops); ++dst) {
+        if (nextHops[dst] != NODE_ADDRESS_NULL) {
+            nvsBuffer[count].dst = dst;
+            nvsBuffer[count].nextHop = nextHops[dst];
+            count++;
+        }
+    }
+    // Sense rutes, s'esborra (no es pot guardar un blob buit)
+    unsigned long start = micros();
+    if (count == 0) {
+        preferences.remove("routingTable");
+        _recordWrite(&stats.snapshotWrites, &stats.snapshotWriteUs, start);
+        _PI("[RTABLE] Empty routing table removed from NVS");
+        return true;
+    }
     // Guardar taula de rutes a NVS. Verifica que l'escriptura sigui la correcta
-    int bWritten = preferences.putBytes("routingTable", (uint8_t*)RoutingTable, RoutingTableSize * sizeof(routing_entry_t));
-    if (bWritten != RoutingTableSize * sizeof(routing_entry_t)) {
-        _PE("[RTABLE] Error writing routing table to NVS (Bytes written: %d, expected %d)", bWritten, RoutingTableSize * sizeof(routing_entry_t));
+    size_t bWritten = preferences.putBytes("routingTable", (uint8_t*)nvsBuffer, count * sizeof(routing_entry_t));
+    if (bWritten != count * sizeof(routing_entry_t)) {
+        _PE("[RTABLE] Error writing routing table to NVS (Bytes written: %d, expected %d)", bWritten, count * sizeof(routing_entry_t));
         return false;
     }
+    _recordWrite(&stats.snapshotWrites, &stats.snapshotWriteUs, start);
     _PI("[RTABLE] Routing table saved to NVS (Bytes written: %d)", bWritten);
     return true;
 }
@@ -24,6 +24,15 @@ static sleep_callback_t onSync = nullptr;
 // Instant en que s'ha rebut el SYNC, en `milisegons`
 static unsigned long tempsSync = 0;
 
+#ifdef SLEEP_TDMA
+// Error de sincronització mesurat: diferència entre l'instant esperat de recepció del SYNC i el real, en `ms`
+// Puja immediatament amb errors grans, i baixa a la meitat amb cada cicle. Fins que no es mesura, es considera SLEEP_EXTRA_TIME
+static RTC_DATA_ATTR uint64_t syncError = SLEEP_EXTRA_TIME / 2;
+
+// Instant esperat de recepció del SYNC després de despertar, en `ms` (0 si no s'esperava cap SYNC)
+static RTC_DATA_ATTR uint64_t expectedSyncAt = 0;
+#endif
+
 typedef enum {
     SLEEP_WAIT_FIRST_SYNC,
     SLEEP_PROPAGATE,
@@ -50,6 +59,11 @@ static void received();
 static void sent();
 static void sendError();
 static long computeDeltaTime();
+#ifdef SLEEP_TDMA
+static uint64_t tdmaSlotTime();
+static uint64_t tdmaGuardTime();
+static void tdmaSetSlot();
+#endif
 static void forwardSync();
 static void sleep_fsm(sleep_event_t);
 
@@ -135,7 +149,12 @@ static void sleep_fsm(sleep_event_t event) {
                 case SLEEP_NON_INITIATOR_E:
                     // Si no som iniciadors, iniciem timer d'espera SYNC
                     sleepState = SLEEP_WAIT_SYNC;   
+                    #ifdef SLEEP_TDMA
+                    // Només cal esperar el slot del node anterior, amb guarda a banda i banda
+                    unsigned long timeout_ms = 2*tdmaGuardTime() + tdmaSlotTime();
+                    #else
                     unsigned long timeout_ms = MAX(0, 2*deltaTime + 2*SLEEP_EXTRA_TIME);
+                    #endif
                     timeoutTask = scheduler_once(syncTimeout, timeout_ms);
                     _PI("[SLEEP] Non-initiator. Waiting for sync with timeout %lu ms", timeout_ms);
                     break;
@@ -163,6 +182,9 @@ static void sleep_fsm(sleep_event_t event) {
                     receivedPDU.dataLen = 0;
                     // L'instant de sincronització és 0 si no rebem SYNC
                     tempsSync = 0;
+                    #ifdef SLEEP_TDMA
+                    expectedSyncAt = 0; // No es coneix el slot propi; s'envia amb CSMA
+                    #endif
                     forwardSync();
                     break;
             }
@@ -179,14 +201,58 @@ static long computeDeltaTime() {
     // N · (R+1) · TX dona temps TX total; N · (R+1) · ACK · TXACK dona temps espera ACK
     // N · (R+1) · TX + N · (R+1) · ACK · TXACK = N · (R+1) · (TX + ACK · TXACK)
     
-    uint64_t max_ack_time_ms = US_TO_MS(LoRaRAW_getTimeOnAir(MAC_PDU_HEADER_SIZE)); // Un ACK de MAC té mida del header
+    uint64_t max_ack_time_ms = US_TO_MS(LoRaRAW_getTimeOnAir(MAC_ACK_FRAME_SIZE));
     uint64_t tx_time_ms = US_TO_MS(LoRaRAW_getTimeOnAir(LORA_MAX_SIZE));
-    deltaTime = SLEEP_QUANTITAT_DISPOSITIUS * (MAC_MAX_RETRIES + 1) * (tx_time_ms + MAC_ACK_TIMEOUT_FACTOR * max_ack_time_ms);
+    deltaTime = SLEEP_QUANTITAT_DISPOSITIUS * (MAC_MAX_RETRIES + 1) * (tx_time_ms + MAC_ACK_IFS_MS + MAC_ACK_TIMEOUT_FACTOR * max_ack_time_ms);
     deltaTime = deltaTime * (1 + SLEEP_DELTA_EXTRA); // 25% marge per CSMA
     _PI("[SLEEP] Delta time compute: TX time = %llu ms + ACK time = %llu ms (%d ACK factor) for %d nodes up to (%d+1) txs, with %.2f extra", tx_time_ms, max_ack_time_ms, MAC_ACK_TIMEOUT_FACTOR, SLEEP_QUANTITAT_DISPOSITIUS, MAC_MAX_RETRIES, SLEEP_DELTA_EXTRA);
     return deltaTime;
 }
 
+#ifdef SLEEP_TDMA
+// Durada d'un slot TDMA: el pitjor cas d'un únic node (tots els intents, amb espera d'ACK), sense marge per CSMA
+static uint64_t tdmaSlotTime() {
+    uint64_t max_ack_time_ms = US_TO_MS(LoRaRAW_getTimeOnAir(MAC_ACK_FRAME_SIZE));
+    uint64_t tx_time_ms = US_TO_MS(LoRaRAW_getTimeOnAir(LORA_MAX_SIZE));
+    return (MAC_MAX_RETRIES + 1) * (tx_time_ms + MAC_ACK_IFS_MS + MAC_ACK_TIMEOUT_FACTOR * max_ack_time_ms);
+}
+
+static uint64_t tdmaGuardTime() {
+    return MAX((uint64_t)SLEEP_TDMA_MIN_GUARD_MS, 2*syncError);
+}
+
+// Actualitza l'error de sincronització mesurat i reserva el slot de transmissió propi a capa MAC.
+// La posició a la cadena (hop index) és el nombre de nodes que han afegit dades al SYNC. Cal executar-ho
+// en rebre el SYNC, abans d'afegir-hi les dades pròpies
+static void tdmaSetSlot() {
+    if (SLEEP_IS_INITIATOR) { // Iniciador: primer slot, a partir d'ara
+        unsigned long start = millis();
+        MAC_setTxSlot(start, tdmaSlotTime());
+        // Després de la ronda de SYNC, les dades es reenvien en pipeline a partir de la mateixa referència
+        MAC_setPipeline(start + SLEEP_QUANTITAT_DISPOSITIUS * tdmaSlotTime(), 0, tdmaGuardTime());
+        _PI("[SLEEP-TDMA] Hop: 0\tSlot: %llu ms", tdmaSlotTime());
+        return;
+    }
+
+    if (expectedSyncAt > 0) {
+        uint64_t error = tempsSync > expectedSyncAt ? tempsSync - expectedSyncAt : expectedSyncAt - tempsSync;
+        syncError = MAX(error, syncError / 2);
+    }
+
+    // L'anterior node transmet a l'inici del seu slot; el nostre comença un slot després
+    uint8_t hop = receivedPDU.dataLen / SLEEP_DATASIZE_PER_NODE;
+    uint64_t slot = tdmaSlotTime();
+    uint64_t syncAirtime = US_TO_MS(LoRaRAW_getTimeOnAir(receivedPDU.dataLen + SLEEP_STACK_HEADERS_SIZE));
+    unsigned long slotStart = tempsSync - syncAirtime + slot;
+    MAC_setTxSlot(slotStart, slot);
+    // Referència comuna: el slot del node `hop` comença `hop` slots després del de l'iniciador
+    MAC_setPipeline(slotStart - hop * slot + SLEEP_QUANTITAT_DISPOSITIUS * slot, hop, tdmaGuardTime());
+
+    _PE("[SLEEP-TDMA] Hop: %d\tSlot: %llu ms\tGuard: %llu ms\tSync error: %llu ms\tExpected: %llu ms\tReceived: %lu ms",
+        hop, slot, tdmaGuardTime(), syncError, expectedSyncAt, tempsSync);
+}
+#endif
+
 // Descodifica una PDU de Sleep i la processa.
 // Poca utilitat actualment (únicament ordre SYNC)
 // però es manté per si es volen afegir més ordres
@@ -218,6 +284,10 @@ static void onSyncReceived() {
     // En qualsevol cas el node ja estarà sincronitzat a la xarxa
     isSync = true;
 
+    #ifdef SLEEP_TDMA
+    tdmaSetSlot();
+    #endif
+
     // Propaguem SYNC
     forwardSync();
 }
@@ -267,6 +337,10 @@ static void goToSleep() {
     uint64_t sleepTime = 0;
 
     // Posar radio a dormir
+    #ifdef SLEEP_TDMA
+    MAC_clearTxSlot();
+    MAC_clearPipeline();
+    #endif
     LoRaRAW_sleep();
     Transport_deinit(SLEEP_PORT);
 
@@ -274,13 +348,20 @@ static void goToSleep() {
     // Nomes calculem cicle si no som iniciadors i hem rebut sincronització
     if (!SLEEP_IS_INITIATOR && isSync) {
         // Mida de les dades que espera rebre el node, per calcular temps de transmissió (que ha d'estar despert abans)
-        uint8_t expectedRcvSize = SLEEP_QUANTITAT_DISPOSITIUS * SLEEP_DATASIZE_PER_NODE + LORA_MAX_SIZE - SLEEP_MAX_DATA_SIZE;
+        uint8_t expectedRcvSize = SLEEP_QUANTITAT_DISPOSITIUS * SLEEP_DATASIZE_PER_NODE + SLEEP_STACK_HEADERS_SIZE;
         long transmitTime = US_TO_MS(LoRaRAW_getTimeOnAir(expectedRcvSize));
 
         // Obtenim el tempsDone (fi) tant a prop com sigui possible de dormir
         tempsDone = millis();
         // sleep time intenta compensar l'error que el propi micro introdueix amb el clock. No podem predir el clock de l'anterior node: s'ha vist com un dispositiu pot tenir 2000ppm, però un altre en pot tenir 25000ppm
+        #ifdef SLEEP_TDMA
+        // El SYNC arriba dins del slot de l'anterior node, i no cal esperar el pitjor cas de tots els anteriors
+        uint64_t guard = tdmaGuardTime();
+        sleepTime = SLEEP_CYCLE_DURATION - (tempsDone - tempsSync) - transmitTime - guard + SLEEP_CLOCK_CORRECTION;
+        expectedSyncAt = guard + transmitTime;
+        #else
         sleepTime = SLEEP_CYCLE_DURATION - (tempsDone - tempsSync) - transmitTime - deltaTime - SLEEP_EXTRA_TIME + SLEEP_CLOCK_CORRECTION;
+        #endif
         _PI("[SLEEP] Expected reception: %d B, Transmission time: %lu ms", expectedRcvSize, transmitTime);
         _PI("[SLEEP] Sleep breakdown: %llu ms = %llu ms - (%lu ms - %lu ms) - %lu ms - %llu ms - %llu ms + %lld ms", 
             sleepTime, SLEEP_CYCLE_DURATION, tempsDone, tempsSync, transmitTime, deltaTime, SLEEP_EXTRA_TIME, SLEEP_CLOCK_CORRECTION);
@@ -297,6 +378,10 @@ static void goToSleep() {
 
     _PE("[SLEEP-STATS] Sync: %d\tSleep time: %llu ms\tSync time: %lu ms\tDone time: %lu ms\tDelta Time: %llu ms\tClk correction: %llu ms\t",
         isSync, sleepTime, tempsSync, tempsDone, deltaTime, SLEEP_CLOCK_CORRECTION);
+    mac_stats_t macStats = MAC_getStats();
+    _PE("[SLEEP-ACK] ACKs: %lu\tLate: %lu\tTurnaround min: %lu us\tavg: %lu us\tmax: %lu us",
+        macStats.acksSent, macStats.acksLate, macStats.ackTurnaroundMinUs,
+        macStats.acksSent > 0 ? (uint32_t)(macStats.ackTurnaroundSumUs / macStats.acksSent) : 0, macStats.ackTurnaroundMaxUs);
     
     // Iniciem deep sleep
     _PW("[SLEEP] Extra %llu ms (%llu)", (millis()-tempsDone), sleepTime-(millis()-tempsDone));
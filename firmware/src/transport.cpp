@@ -30,25 +30,31 @@ typedef struct {
     bool isSent = false;
     long ackTimeout = -1;
     uint8_t retries = 0;
+    bool noAck = false;     // Entrega sense garanties a MAC (també pels reintents)
     Task* ackTask;
 } transport_tx_metadata;
 
 static std::vector<transport_tx_metadata> txQueue;
 
 static transport_pdu_t rxPDU; // PDU per guardar segment rebut
+
+// Segment serialitzat per passar a (o obtenir de) encaminament. Estàtic per no ocupar `ROUTING_MAX_DATA_SIZE` a la pila
+static routing_data_t segmentBuffer;
 static node_address_t rxAddress = NODE_ADDRESS_NULL; // Adreça de node que ha enviat el segment rebut
 
 static void _onRoutingReceived();
 static void _onRoutingSent(uint16_t id);
 static void _onRoutingTxError(uint16_t id);
 static size_t _buildAck(transport_pdu_t* pdu, node_address_t rx, transport_id_t id);
+static size_t _segmentToBytes(const transport_pdu_t* const pdu, uint8_t* out);
+static bool _bytesToSegment(const uint8_t* in, size_t length, transport_pdu_t* pdu);
 static void _printSegment(const transport_pdu_t* const pdu);
 static void _segmentReceived(transport_port_t port);
 static void _segmentSent(transport_port_t port);
 static void _segmentSentError(transport_port_t port);
 static void _ackReceived(transport_pdu_t* pdu);
 static void _checkTxQueueMetadata(void);
-static void _resendSegment(transport_tx_metadata* meta);
+static bool _resendSegment(transport_tx_metadata* meta);
 
 bool Transport_init(node_address_t selfAddr, bool is_gateway) {
     _PI("[TRANSPORT] Initializing...");
@@ -71,7 +77,7 @@ bool Transport_init(node_address_t selfAddr, bool is_gateway) {
     // Permet reservar memòria només iniciar. Avantatge que no cal realloc inicialment per cada segment
     // txQueue.reserve(10);
 
-    _PI("[TRANSPORT] Initialized");
+    _PI("[TRANSPORT] Initialized (header: %d B)", TRANSPORT_HEADER_SIZE);
     return true;
 }
 
@@ -89,7 +95,7 @@ void Transport_deinit(transport_port_t port) {
     }
 }
 
-transport_err_t Transport_send(node_address_t rx, transport_port_t port, const transport_data_t data, size_t length, bool ackRequested) {
+transport_err_t Transport_send(node_address_t rx, transport_port_t port, const transport_data_t data, size_t length, bool ackRequested, bool noAck) {
     _PI("[TRANSPORT] Preparing to send");
 
     if(length > TRANSPORT_MAX_DATA_SIZE) {
@@ -102,6 +108,12 @@ transport_err_t Transport_send(node_address_t rx, transport_port_t port, const t
         return TRANSPORT_ERR;
     }
 
+    // Tots els veïns respondrien amb ACK, i no hi ha un únic segment a reconèixer
+    if(rx == NODE_ADDRESS_BROADCAST && ackRequested) {
+        _PW("[TRANSPORT] Broadcast segments cannot request ACK");
+        return TRANSPORT_ERR;
+    }
+
     transport_pdu_t pdu;
     pdu.flags.port = port;
     pdu.flags.ACKRequest = ackRequested;
@@ -113,11 +125,12 @@ transport_err_t Transport_send(node_address_t rx, transport_port_t port, const t
     _printSegment(&pdu);
 
     uint16_t segmentID; 
-    routing_err_t state = Routing_send(rx, (const uint8_t*) &pdu, length+TRANSPORT_HEADER_SIZE, &segmentID);
+    size_t segmentLength = _segmentToBytes(&pdu, segmentBuffer);
+    routing_err_t state = Routing_send(rx, segmentBuffer, segmentLength, &segmentID, noAck);
 
     if(state != ROUTING_SUCCESS) {
         _PW("[TRANSPORT] Error sending segment (state: %d)", state);
-        return TRANSPORT_ERR;
+        return state == ROUTING_ERR_UNREACHABLE ? TRANSPORT_ERR_UNREACHABLE : TRANSPORT_ERR;
     }
 
     // Guardem metadades per poder notificar sobre esdeveniments a capa superior
@@ -126,6 +139,7 @@ transport_err_t Transport_send(node_address_t rx, transport_port_t port, const t
     pduMeta.id = segmentID;
     pduMeta.rx = rx;
     pduMeta.isSent = false;
+    pduMeta.noAck = noAck;
     txQueue.push_back(pduMeta);
 
     _PI("[TRANSPORT] Scheduled to send segment (Segment ID: %d, Frame ID: %d)", pdu.ID, segmentID);
@@ -177,10 +191,10 @@ static void _onRoutingReceived() {
 
     transport_pdu_t pdu;
     size_t RoutingLength;
-    rxAddress = Routing_receive((routing_data_t*)&pdu, &RoutingLength);
+    rxAddress = Routing_receive(&segmentBuffer, &RoutingLength);
 
     // La mida ha de ser com a mínim la del header, si no no és vàlid
-    if (RoutingLength < TRANSPORT_HEADER_SIZE) {
+    if (!_bytesToSegment(segmentBuffer, RoutingLength, &pdu)) {
         _PW("[TRANSPORT] Segment too short (%d)", RoutingLength);
         return;
     }
@@ -191,8 +205,9 @@ static void _onRoutingReceived() {
     if (pdu.flags.ACKRequest) { 
         _PI("[TRANSPORT] ACK requested for segment %d", pdu.ID);
         transport_pdu_t ack;
-        size_t length = _buildAck(&ack, rxAddress, pdu.ID);
-        routing_err_t state = Routing_send(rxAddress, (const uint8_t*) &ack, length);
+        _buildAck(&ack, rxAddress, pdu.ID);
+        size_t length = _segmentToBytes(&ack, segmentBuffer);
+        routing_err_t state = Routing_send(rxAddress, segmentBuffer, length);
     }
     else {
         _PI("[TRANSPORT] ACK not requested for segment %d", pdu.ID);
@@ -279,6 +294,14 @@ static void _onRoutingTxError(uint16_t id) {
                 return;
             }
             // Si s'han esgotat intents, no té sentit esperar TOUT (txerror implica que no s'ha pogut ni enviar, tampoc rebrem ack)
+            // Tampoc si MAC ha marcat el següent salt com a inaccessible: els reintents fallarien immediatament
+            if(!Routing_isReachable(meta.rx)) {
+                _PW("[TRANSPORT] TX Error for TCP segment %d (frame %d). Next hop unreachable", meta.pdu.ID, id);
+                transport_port_t port = meta.pdu.flags.port;
+                txQueue.erase(txQueue.begin() + i);
+                _segmentSentError(port);
+                return;
+            }
             if(meta.retries >= TRANSPORT_MAX_RETRIES) {
                 _PW("[TRANSPORT] TX Error for TCP segment %d (frame %d). Max retries reached", meta.pdu.ID, id);
                 txQueue.erase(txQueue.begin() + i);
@@ -320,28 +343,35 @@ static void _checkTxQueueMetadata(void) {
                 return;
             }
             _PI("[TRANSPORT] ACK timeout for segment %d. Retrying... (retry %d)", meta.id, meta.retries);
-            _resendSegment(&txQueue[pos]);
+            if(!_resendSegment(&txQueue[pos])) { // No es tornarà a intentar: sense registre, quedaria a la cua per sempre
+                transport_port_t port = meta.pdu.flags.port;
+                txQueue.erase(txQueue.begin() + pos);
+                _segmentSentError(port);
+            }
             return;
         }
     }
     _PE("[TRANSPORT] ACK timeout callback without any pending segment. This should not happen. Check guard ms at TOUT");
 }
 
-static void _resendSegment(transport_tx_metadata* meta) {
+// Torna a enviar el segment. Retorna `false` si encaminament no l'ha acceptat (sense ruta, o següent salt inaccessible)
+static bool _resendSegment(transport_tx_metadata* meta) {
     meta->isSent = false;
     meta->ackTimeout = -1;
     uint16_t segmentID;
-    routing_err_t state = Routing_send(meta->rx, (const uint8_t*) &meta->pdu, meta->pdu.dataLength+TRANSPORT_HEADER_SIZE, &segmentID);
+    size_t segmentLength = _segmentToBytes(&meta->pdu, segmentBuffer);
+    routing_err_t state = Routing_send(meta->rx, segmentBuffer, segmentLength, &segmentID, meta->noAck);
 
     if(state != ROUTING_SUCCESS) {
         _PW("[TRANSPORT] Error re-sending segment (state: %d)", state);
-        return;
+        return false;
     }
 
     _PI("[TRANSPORT] Scheduled to resend segment (ID: %d -> %d) (%d retries)", meta->id, segmentID, meta->retries);
 
     // Actualitzar a nou id (ja que és nova transmissió)
     meta->id = segmentID;
+    return true;
 }
     
 static size_t _buildAck(transport_pdu_t* pdu, node_address_t rx, transport_id_t id) {
@@ -354,6 +384,61 @@ static size_t _buildAck(transport_pdu_t* pdu, node_address_t rx, transport_id_t
     return TRANSPORT_HEADER_SIZE;
 }
 
+// Serialitza el segment al format que s'envia a capa inferior. Retorna la mida total
+static size_t _segmentToBytes(const transport_pdu_t* const pdu, uint8_t* out) {
+#ifdef COMPACT_HEADERS
+    // Format compacte: [ID_L|ID_H|FLAGS|DATA|...|DATA]. Mida de dades implícita
+    size_t index = 0;
+    memcpy(&out[index], &pdu->ID, sizeof(transport_id_t));
+    index += sizeof(transport_id_t);
+    memcpy(&out[index], &pdu->flags, sizeof(transport_pdu_flags_t));
+    index += sizeof(transport_pdu_flags_t);
+    memcpy(&out[index], pdu->data, pdu->dataLength);
+    return index + pdu->dataLength;
+#else
+    // Format estàndard: [ID_L|ID_H|FLAGS|LEN|DATA|...|DATA]. LEN ocupa TRANSPORT_LENGTH_FIELD_SIZE bytes (little-endian)
+    size_t index = 0;
+    memcpy(&out[index], &pdu->ID, sizeof(transport_id_t));
+    index += sizeof(transport_id_t);
+    memcpy(&out[index], &pdu->flags, sizeof(transport_pdu_flags_t));
+    index += sizeof(transport_pdu_flags_t);
+    memcpy(&out[index], &pdu->dataLength, TRANSPORT_LENGTH_FIELD_SIZE);
+    index += TRANSPORT_LENGTH_FIELD_SIZE;
+    memcpy(&out[index], pdu->data, pdu->dataLength);
+    return index + pdu->dataLength;
+#endif
+}
+
+// Obté el segment a partir de les dades de capa inferior. Retorna `false` si no és vàlid
+static bool _bytesToSegment(const uint8_t* in, size_t length, transport_pdu_t* pdu) {
+    if (length < TRANSPORT_HEADER_SIZE || length > TRANSPORT_HEADER_SIZE + TRANSPORT_MAX_DATA_SIZE) {
+        return false;
+    }
+#ifdef COMPACT_HEADERS
+    size_t index = 0;
+    memcpy(&pdu->ID, &in[index], sizeof(transport_id_t));
+    index += sizeof(transport_id_t);
+    memcpy(&pdu->flags, &in[index], sizeof(transport_pdu_flags_t));
+    index += sizeof(transport_pdu_flags_t);
+    pdu->dataLength = length - TRANSPORT_HEADER_SIZE;
+    memcpy(pdu->data, &in[index], pdu->dataLength);
+#else
+    size_t index = 0;
+    memcpy(&pdu->ID, &in[index], sizeof(transport_id_t));
+    index += sizeof(transport_id_t);
+    memcpy(&pdu->flags, &in[index], sizeof(transport_pdu_flags_t));
+    index += sizeof(transport_pdu_flags_t);
+    pdu->dataLength = 0;
+    memcpy(&pdu->dataLength, &in[index], TRANSPORT_LENGTH_FIELD_SIZE);
+    index += TRANSPORT_LENGTH_FIELD_SIZE;
+    if (pdu->dataLength > length - TRANSPORT_HEADER_SIZE) {
+        return false;
+    }
+    memcpy(pdu->data, &in[index], pdu->dataLength);
+#endif
+    return true;
+}
+
 // Notifica recepció de segment a la capa aplicació amb el port corresponent
 static void _segmentReceived(transport_port_t port) {
     if(appHandlers[port].onReceive != nullptr) {
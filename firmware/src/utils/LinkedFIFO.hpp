@@ -1,6 +1,6 @@
 /*
     Implementació Linked List simple, amb format FIFO.
-    Permet inserir elements a la llista (push), eliminar (pop), buscar (find)
+    Permet inserir elements a la llista (push), eliminar (pop), consultar el primer (peek), buscar (find)
 
     En ser templated (osigui `T` es modificarà pel tipus de dades passat en construir-ho), 
     s'utilitza ".hpp" (header + implementació), ja que implementació s'ha de coneixer en compilar-ho (depèn del tipus)
@@ -62,6 +62,13 @@ public:
         return true;
     }
 
+    // Obtenir el primer element de la cua sense eliminar-lo
+    bool peek(T& value) const {
+        if (!head) return false;
+        value = head->data;
+        return true;
+    }
+
     size_t count() {
         return size;
     }
@@ -0,0 +1,120 @@
+/*
+    Micro-benchmark (host) de la cerca a la taula de rutes amb 254 rutes (una per cada adreça, de 0x01 a 0xFE).
+    Compara la taula anterior (array d'entrades dst/nextHop amb cerca lineal, reproduïda aquí tal com era) amb
+    `RoutingTable_getRoute()` del firmware (routing_table.cpp, indexada directament per adreça), compilada amb la NVS
+    simulada de tests/hostStubs, amb la mateixa seqüència de destins aleatoris. Les dues porten la mateixa traça, que es
+    compila però no s'imprimeix.
+    També comprova que la taula del firmware llegeix el blob de NVS de l'anterior (parelles dst/nextHop), i que el que hi
+    torna a escriure es llegeix igual.
+
+    Compilar (des d'aquest directori) i executar:
+        g++ -O2 -std=gnu++17 -D__FILENAME__=__FILE__ -I../hostStubs -I../../firmware/include \
+            benchRoutingTable.cpp ../../firmware/src/routing_table.cpp -o benchRoutingTable
+        ./benchRoutingTable [cerques]
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "Preferences.h"
+#include "routing_table.h"
+#include "utils.h"
+
+// --- Taula anterior: array d'entrades, cerca lineal ---
+static routing_entry_t* linearTable = nullptr;
+static int linearSize = 0;
+
+static int linear_getIndex(node_address_t dst) {
+    for (int i = 0; i < linearSize; ++i) {
+        if (linearTable[i].dst == dst) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static node_address_t linear_getRoute(node_address_t dst) {
+    int index = linear_getIndex(dst);
+    if (index != -1) {
+        _PI("[RTABLE] Queried route for 0x%02X, through 0x%02X", dst, linearTable[index].nextHop);
+        return linearTable[index].nextHop;
+    }
+    _PW("[RTABLE] Route for %d not found", dst);
+    return NODE_ADDRESS_NULL;
+}
+
+// Comprova que la taula del firmware té les mateixes rutes que la taula anterior
+static bool same_routes() {
+    for (int i = 0; i < linearSize; i++) {
+        if (RoutingTable_getRoute(linearTable[i].dst) != linearTable[i].nextHop) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename F>
+static double bench(F getRoute, const std::vector<node_address_t>& queries, uint32_t* checksum) {
+    auto start = std::chrono::steady_clock::now();
+    uint32_t sum = 0;
+    for (node_address_t dst : queries) {
+        sum += getRoute(dst);
+    }
+    auto end = std::chrono::steady_clock::now();
+    *checksum = sum;
+    return std::chrono::duration<double, std::nano>(end - start).count() / queries.size();
+}
+
+int main(int argc, char** argv) {
+    size_t lookups = argc > 1 ? strtoul(argv[1], nullptr, 10) : 10000000;
+
+    // 254 rutes: totes les adreces menys NULL (0x00) i broadcast (0xFF). En ordre d'inserció aleatori,
+    // com si s'haguessin afegit en temps d'execució
+    std::mt19937 rng(1234);
+    std::vector<node_address_t> dsts;
+    for (int a = 0x01; a < 0xFF; a++) {
+        dsts.push_back(a);
+    }
+    std::shuffle(dsts.begin(), dsts.end(), rng);
+
+    linearSize = dsts.size();
+    linearTable = (routing_entry_t*)malloc(linearSize * sizeof(routing_entry_t));
+    for (int i = 0; i < linearSize; i++) {
+        linearTable[i].dst = dsts[i];
+        linearTable[i].nextHop = 0x03 + (dsts[i] & 0x01); // Dos veïns
+    }
+
+    // El blob de NVS de la taula anterior és directament l'array d'entrades
+    Preferences nvs;
+    nvs.begin("routingTable");
+    nvs.putBytes("routingTable", linearTable, linearSize * sizeof(routing_entry_t));
+    bool compatible = RoutingTable_init() && same_routes();
+
+    // Un canvi (desfet) i compactació: el firmware hi reescriu la taula sencera, que s'ha de tornar a llegir igual
+    node_address_t first = linearTable[0].dst;
+    compatible = compatible && RoutingTable_updateRoute(first, 0x05) && RoutingTable_updateRoute(first, linearTable[0].nextHop);
+    compatible = compatible && RoutingTable_commit();
+    size_t savedBytes = nvs.getBytesLength("routingTable");
+    RoutingTable_deinit();
+    compatible = compatible && savedBytes == linearSize * sizeof(routing_entry_t) && RoutingTable_init() && same_routes();
+
+    std::uniform_int_distribution<int> dist(0, dsts.size() - 1);
+    std::vector<node_address_t> queries(lookups);
+    for (auto& q : queries) {
+        q = dsts[dist(rng)];
+    }
+
+    uint32_t linearSum, directSum;
+    double linearNs = bench(linear_getRoute, queries, &linearSum);
+    double directNs = bench(RoutingTable_getRoute, queries, &directSum);
+
+    printf("Routes: %d, lookups: %zu\n", linearSize, lookups);
+    printf("NVS blob compatible: %s (%zu B)\n", compatible ? "yes" : "NO", savedBytes);
+    printf("Linear scan:          %8.2f ns/lookup\n", linearNs);
+    printf("RoutingTable_getRoute: %7.2f ns/lookup (x%.1f)\n", directNs, linearNs / directNs);
+    printf("Same results: %s\n", linearSum == directSum ? "yes" : "NO");
+
+    free(linearTable);
+    return compatible && linearSum == directSum ? 0 : 1;
+}
@@ -0,0 +1,67 @@
+/*
+    Stub mínim d'Arduino/ESP32 per compilar el firmware al host (benchmarks de tests/). Només declara el que fan servir
+    les capes MAC i d'encaminament; les traces (`Serial`) no s'imprimeixen.
+*/
+
+#ifndef _HOST_STUBS_ARDUINO_H
+#define _HOST_STUBS_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+#include <chrono>
+
+#define RTC_DATA_ATTR
+#define IRAM_ATTR
+#define ICACHE_RAM_ATTR
+
+struct HostSerial {
+    void begin(long) {}
+    template <typename... A> void printf(const char*, A...) {}
+    template <typename T> void print(T) {}
+    template <typename T> void println(T) {}
+    void println() {}
+};
+inline HostSerial Serial;
+
+inline unsigned long micros() {
+    static const auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+// Resolució de 1-4 ms, però molt més ràpid: les traces (encara que no s'imprimeixin) l'avaluen a cada crida
+inline unsigned long _coarseMillis() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+    return now.tv_sec * 1000UL + now.tv_nsec / 1000000;
+}
+inline unsigned long millis() {
+    static const unsigned long start = _coarseMillis();
+    return _coarseMillis() - start;
+}
+inline void delayMicroseconds(unsigned int us) {
+    unsigned long start = micros();
+    while (micros() - start < us) {}
+}
+inline void delay(unsigned long ms) { delayMicroseconds(ms * 1000); }
+
+inline long random(long max) { return max > 0 ? rand() % max : 0; }
+inline long random(long min, long max) { return min + random(max - min); }
+inline uint32_t esp_random() { return ((uint32_t)rand() << 16) ^ (uint32_t)rand(); }
+
+typedef enum { ESP_RST_UNKNOWN, ESP_RST_POWERON, ESP_RST_BROWNOUT, ESP_RST_DEEPSLEEP } esp_reset_reason_t;
+inline esp_reset_reason_t esp_reset_reason() { return ESP_RST_POWERON; }
+
+struct HostESP {
+    uint32_t getFreeHeap() { return 0; }
+};
+inline HostESP ESP;
+
+using std::min;
+using std::max;
+
+#endif
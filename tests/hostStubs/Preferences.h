@@ -0,0 +1,60 @@
+/*
+    Stub de Preferences (NVS) per al host: guarda les claus en memòria, compartides entre instàncies amb el mateix
+    espai de noms, de forma que un `begin()` posterior (p. ex. en tornar a inicialitzar la taula de rutes) hi troba
+    el que s'hi ha escrit. Les escriptures no tenen el cost de la flash.
+*/
+
+#ifndef _HOST_STUBS_PREFERENCES_H
+#define _HOST_STUBS_PREFERENCES_H
+
+#include <Arduino.h>
+#include <map>
+#include <string>
+#include <vector>
+
+class Preferences {
+    typedef std::map<std::string, std::vector<uint8_t>> store_t;
+    store_t* store = nullptr;
+
+    static std::map<std::string, store_t>& _namespaces() {
+        static std::map<std::string, store_t> namespaces;
+        return namespaces;
+    }
+    template <typename T> T _get(const char* key, T defaultValue) {
+        T value = defaultValue;
+        getBytes(key, &value, sizeof(T));
+        return value;
+    }
+
+public:
+    bool begin(const char* name, bool readOnly = false) {
+        store = &_namespaces()[name];
+        return true;
+    }
+    void end() { store = nullptr; }
+    bool isKey(const char* key) { return store->count(key) > 0; }
+    bool remove(const char* key) { return store->erase(key) > 0; }
+    bool clear() {
+        store->clear();
+        return true;
+    }
+    size_t getBytesLength(const char* key) { return isKey(key) ? (*store)[key].size() : 0; }
+    size_t getBytes(const char* key, void* buf, size_t maxLen) {
+        if (!isKey(key) || (*store)[key].size() > maxLen) {
+            return 0;
+        }
+        const std::vector<uint8_t>& value = (*store)[key];
+        memcpy(buf, value.data(), value.size());
+        return value.size();
+    }
+    size_t putBytes(const char* key, const void* value, size_t len) {
+        (*store)[key].assign((const uint8_t*)value, (const uint8_t*)value + len);
+        return len;
+    }
+    uint32_t getUInt(const char* key, uint32_t defaultValue = 0) { return _get(key, defaultValue); }
+    size_t putUInt(const char* key, uint32_t value) { return putBytes(key, &value, sizeof(value)); }
+    uint16_t getUShort(const char* key, uint16_t defaultValue = 0) { return _get(key, defaultValue); }
+    size_t putUShort(const char* key, uint16_t value) { return putBytes(key, &value, sizeof(value)); }
+};
+
+#endif
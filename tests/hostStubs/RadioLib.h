@@ -0,0 +1,14 @@
+/*
+    Stub de RadioLib per al host: només el que necessiten les capçaleres de la capa LoRa. La ràdio la simula hostStubs.cpp
+*/
+
+#ifndef _HOST_STUBS_RADIOLIB_H
+#define _HOST_STUBS_RADIOLIB_H
+
+#include <Arduino.h>
+
+#define RADIOLIB_SX126X_MAX_PACKET_LENGTH 255
+
+class SX1262 {};
+
+#endif
@@ -0,0 +1,16 @@
+/*
+    Stub de TaskScheduler per al host: les tasques programades les guarda hostStubs.cpp, i s'executen amb `HostStubs_runTasks()`
+*/
+
+#ifndef _HOST_STUBS_TASKSCHEDULER_H
+#define _HOST_STUBS_TASKSCHEDULER_H
+
+typedef void (*TaskCallback)();
+
+class Task {
+public:
+    TaskCallback callback = nullptr;
+    bool enabled = false;
+};
+
+#endif
@@ -0,0 +1,148 @@
+#include <deque>
+#include <math.h>
+#include "hostStubs.h"
+#include "lora.h"
+#include "scheduler.h"
+#include "utils.h"
+
+SX1262 radio;
+bool isLoraInitialized = false;
+
+static lora_data_t rxFrame;
+static size_t rxLength = 0;
+static unsigned long rxTime = 0;
+static size_t sentFrames = 0;
+static lora_callback_t onRawReceive = nullptr;
+static lora_callback_t onWANReceive = nullptr;
+
+static std::deque<Task*> tasks;
+
+void HostStubs_receive(const uint8_t* frame, size_t length) {
+    memcpy(rxFrame, frame, length);
+    rxLength = length;
+    rxTime = micros();
+    if (onRawReceive != nullptr) {
+        onRawReceive();
+    }
+}
+
+size_t HostStubs_getSentFrames() { return sentFrames; }
+
+void HostStubs_runTasks() {
+    size_t pending = tasks.size();
+    for (size_t i = 0; i < pending; i++) {
+        Task* task = tasks.front();
+        tasks.pop_front();
+        if (task->enabled) {
+            task->callback();
+        }
+        delete task;
+    }
+}
+
+void HostStubs_discardTasks() {
+    for (Task* task : tasks) {
+        delete task;
+    }
+    tasks.clear();
+}
+
+/* ****************** */
+/* * LORA (RÀDIO)   * */
+/* ****************** */
+
+bool LoRa_init() { return isLoraInitialized = true; }
+void LoRa_deinit() { isLoraInitialized = false; }
+void LoRa_setModeRAW() {}
+void LoRa_setModeWAN() {}
+
+bool LoRaRAW_init() { return true; }
+void LoRaRAW_deinit() {}
+
+lora_tx_error_t LoRaRAW_send(const lora_data_t data, size_t length, bool checkChannel) {
+    sentFrames++;
+    return LORA_SUCCESS;
+}
+
+lora_tx_error_t LoRaRAW_sendImmediate(const lora_data_t data, size_t length) {
+    sentFrames++;
+    return LORA_SUCCESS;
+}
+
+unsigned long LoRaRAW_getLastRxTime() { return rxTime; }
+
+bool LoRaRAW_receiveHeader(uint8_t* data, size_t maxLength, size_t* length) {
+    memcpy(data, rxFrame, MIN(maxLength, rxLength));
+    *length = rxLength;
+    return true;
+}
+
+void LoRaRAW_discard() {}
+
+bool LoRaRAW_receive(lora_data_t data, size_t* length) {
+    memcpy(data, rxFrame, rxLength);
+    *length = rxLength;
+    return true;
+}
+
+bool LoRaRAW_isAvailable() { return true; }
+bool LoRaRAW_isBusy() { return false; }
+int16_t LoRaRAW_getLastRSSI() { return -60; }
+int16_t LoRaRAW_getLastSNR() { return 10; }
+bool LoRaRAW_sleep() { return true; }
+bool LoRaRAW_wakeup() { return true; }
+bool LoRaRAW_setFrequency(float frequency) { return true; }
+bool LoRaRAW_setTxPower(int power) { return true; }
+
+// Temps en l'aire (us) amb la configuració de config.h, segons la fórmula de Semtech (header explícit, CRC activat)
+long LoRaRAW_getTimeOnAir(int length) {
+    double symbolUs = (1 << LORA_SF) * 1000.0 / LORA_BW;
+    int lowDataRate = symbolUs > 16000 ? 1 : 0;
+    double payloadSymbols = ceil((8.0 * length - 4 * LORA_SF + 28 + 16) / (4 * (LORA_SF - 2 * lowDataRate)));
+    payloadSymbols = 8 + MAX(payloadSymbols * LORA_CODERATE, 0.0);
+    return (long)((8 + 4.25 + payloadSymbols) * symbolUs);
+}
+
+void LoRaRAW_startReceiving() {}
+void LoRaRAW_stopReceiving() {}
+void LoRaRAW_onReceive(lora_callback_t cb) { onRawReceive = cb; }
+
+/* ****************** */
+/* * LORAWAN        * */
+/* ****************** */
+
+bool LW_init() { return false; }
+void LW_deinit() {}
+bool LW_send(const lora_data_t data, size_t length, uint8_t port, bool confirmed) { return false; }
+bool LW_receive(lora_data_t data, size_t* length, uint8_t* port) { return false; }
+bool LW_isConnected() { return false; }
+void LW_onReceive(lora_callback_t cb) { onWANReceive = cb; }
+
+/* ****************** */
+/* * SCHEDULER      * */
+/* ****************** */
+
+// Com el del firmware, cada tasca es crea amb `new`: el cost de programar-la es manté
+Task* scheduler_once(TaskCallback callback, unsigned long startDelay) {
+    Task* task = new Task();
+    task->callback = callback;
+    task->enabled = true;
+    tasks.push_back(task);
+    return task;
+}
+
+Task* scheduler_infinite(unsigned long interval, TaskCallback cb, unsigned long startDelay) {
+    return scheduler_once(cb, startDelay);
+}
+
+Task* scheduler_repeat(unsigned long interval, unsigned int repetition, TaskCallback cb, unsigned long startDelay) {
+    return scheduler_once(cb, startDelay);
+}
+
+void scheduler_stop(Task* task) {
+    if (task != nullptr) {
+        task->enabled = false;
+    }
+}
+
+void scheduler_run() { HostStubs_runTasks(); }
@@ -0,0 +1,27 @@
+/*
+    Capa LoRa (ràdio i LoRaWAN) i gestor de tasques simulats, per executar al host el codi del firmware a partir de MAC.
+    Compilar hostStubs.cpp amb els fitxers del firmware, i aquest directori al davant dels includes del firmware.
+*/
+
+#ifndef _HOST_STUBS_H
+#define _HOST_STUBS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/// @brief Simula la recepció d'un frame per la ràdio: el deixa disponible per `LoRaRAW_receive()` i executa el callback
+/// de recepció (el de MAC, `_onLoraReceived`)
+/// @param frame Frame tal com arriba per l'aire (amb CRC)
+/// @param length Mida del frame
+void HostStubs_receive(const uint8_t* frame, size_t length);
+
+/// @brief Obté el nombre de frames enviats per la ràdio (`LoRaRAW_send()` i `LoRaRAW_sendImmediate()`)
+size_t HostStubs_getSentFrames();
+
+/// @brief Executa una vegada les tasques programades pendents, sense esperar-ne el retard
+void HostStubs_runTasks();
+
+/// @brief Descarta les tasques programades pendents sense executar-les
+void HostStubs_discardTasks();
+
+#endif
@@ -0,0 +1,95 @@
+/*
+    Proves del diari de NVS de la taula de rutes (ROUTING_TABLE_JOURNAL_SIZE).
+
+    Arrencada 0: esborra la taula, hi afegeix 50 rutes, i mostra el nombre d'escriptures a NVS i el temps que han
+    bloquejat (`RoutingTable_getStats()`), abans i després de `RoutingTable_commit()`. Per comparar, també mesura
+    una única escriptura de la taula sencera, que abans es feia per cada canvi.
+    Arrencada 1: afegeix 10 rutes més i en modifica 5, i es reinicia sense compactar (com si es reiniciés a mig diari).
+    Arrencada 2: comprova que la taula recuperada (còpia sencera + diari) té les 60 rutes amb els valors esperats.
+    L'arrencada es guarda a NVS (les variables RTC es reinicien amb `esp_restart()`). Esborrar "rtTest" per repetir-la.
+*/
+
+#include <Arduino.h>
+#include "Preferences.h"
+#include "routing_table.h"
+
+static Preferences testPrefs;
+
+#define ROUTES 50
+
+static node_address_t expectedNextHop(node_address_t dst) {
+    if (dst >= 0x10 + ROUTES && dst < 0x10 + ROUTES + 5) {
+        return 0x04; // Modificades a l'arrencada 1
+    }
+    return 0x02 + (dst & 0x01);
+}
+
+static void printStats(const char* label) {
+    routing_table_stats_t stats = RoutingTable_getStats();
+    Serial.printf("%s: journal %u writes (%u us), snapshot %u writes (%u us), max %u us, commits %u\n", label,
+        stats.journalWrites, stats.journalWriteUs, stats.snapshotWrites, stats.snapshotWriteUs, stats.maxWriteUs, stats.commits);
+}
+
+void setup() {
+    Serial.begin(115200);
+    delay(1000);
+
+    testPrefs.begin("rtTest");
+    uint32_t boot = testPrefs.getUInt("boot", 0);
+    Serial.printf("Boot %d\n", boot);
+
+    if (!RoutingTable_init()) {
+        Serial.println("Routing table init failed");
+        while(1) delay(1);
+    }
+
+    if (boot == 0) {
+        RoutingTable_clear();
+        unsigned long start = micros();
+        for (int i = 0; i < ROUTES; i++) {
+            RoutingTable_addRoute(0x10 + i, expectedNextHop(0x10 + i));
+        }
+        Serial.printf("%d routes added in %lu us\n", ROUTES, micros() - start);
+        printStats("Before commit");
+        RoutingTable_commit();
+        printStats("After commit");
+
+        // Referència: una escriptura de la taula sencera, com es feia per cada canvi
+        uint8_t blob[2 * ROUTES] = { 0 };
+        Preferences prefs;
+        prefs.begin("rtBench");
+        start = micros();
+        prefs.putBytes("blob", blob, sizeof(blob));
+        Serial.printf("Full table write (%d B): %lu us\n", sizeof(blob), micros() - start);
+        prefs.clear();
+        prefs.end();
+    }
+    else if (boot == 1) {
+        for (int i = ROUTES; i < ROUTES + 10; i++) {
+            RoutingTable_addRoute(0x10 + i, 0x02 + ((0x10 + i) & 0x01));
+        }
+        for (int i = ROUTES; i < ROUTES + 5; i++) {
+            RoutingTable_updateRoute(0x10 + i, 0x04);
+        }
+        printStats("Journal only");
+        Serial.println("Restarting without commit");
+    }
+    else {
+        int errors = 0;
+        for (int i = 0; i < ROUTES + 10; i++) {
+            if (RoutingTable_getRoute(0x10 + i) != expectedNextHop(0x10 + i)) {
+                Serial.printf("Route 0x%02X: 0x%02X, expected 0x%02X\n", 0x10 + i, RoutingTable_getRoute(0x10 + i), expectedNextHop(0x10 + i));
+                errors++;
+            }
+        }
+        Serial.printf("Recovered table: %d errors\n", errors);
+        RoutingTable_print();
+        return;
+    }
+    testPrefs.putUInt("boot", boot + 1);
+    delay(100);
+    esp_restart();
+}
+
+void loop() {
+}
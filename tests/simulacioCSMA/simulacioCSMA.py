@@ -0,0 +1,202 @@
+"""
+Simulació de l'accés al medi de la capa MAC: BEB amb slot fix (MAC_BEB_SLOT_MS) contra CSMA adaptatiu
+(slot segons airtime d'ACK, p-persistència segons ocupació i finestra de contenció segons col·lisions), amb càrrega creixent.
+
+Model:
+- N nodes, tots a l'abast de tots, que envien frames de dades a un mateix receptor (que respon amb ACK).
+- Arribades de Poisson a cada node; cua FIFO per node, com la cua de TX de MAC.
+- CAD ideal, però només detecta transmissions que ja porten com a mínim un símbol a l'aire.
+- Dues transmissions que se solapen (dades o ACK) es perden les dues.
+- Reintents, timeout d'ACK i esperes segueixen els valors de config.h.
+
+Ús: python3 simulacioCSMA.py [SF] [nodes] [mida dades]
+"""
+import heapq
+import math
+import random
+import sys
+
+# Valors de config.h
+MAC_MAX_RETRIES = 3
+MAC_MAX_BEB_RETRY = 10
+MAC_BEB_SLOT_MS = 100
+MAC_ACK_TIMEOUT_FACTOR = 3
+MAC_CSMA_SLOT_FACTOR = 1
+MAC_CSMA_CW_MIN = 4
+MAC_CSMA_CW_MAX = 256
+MAC_CSMA_MIN_PERSISTENCE = 20
+MAC_CSMA_BUSY_ALPHA = 0.125
+MAC_HEADER_SIZE = 8
+MAC_ACK_SIZE = 7
+
+BW = 125e3
+CR = 1  # 4/5
+PREAMBLE = 8
+SIM_TIME_MS = 15*60*1000
+
+
+def time_on_air_ms(sf, length):
+    # Semtech AN1200.13, header explícit i CRC
+    t_sym = (2 ** sf) / BW * 1000
+    de = 1 if sf >= 11 else 0
+    payload_symb = 8 + max(math.ceil((8 * length - 4 * sf + 28 + 16) / (4 * (sf - 2 * de))) * (CR + 4), 0)
+    return (PREAMBLE + 4.25) * t_sym + payload_symb * t_sym
+
+
+class Channel:
+    def __init__(self, t_sym):
+        self.tx = []  # (inici, fi, id)
+        self.t_sym = t_sym
+        self.next_id = 0
+
+    def purge(self, now):
+        self.tx = [t for t in self.tx if t[1] > now - 10000]
+
+    def busy(self, now):
+        return any(start + self.t_sym <= now < end for start, end, _ in self.tx)
+
+    def start(self, now, duration):
+        self.next_id += 1
+        self.tx.append((now, now + duration, self.next_id))
+        return self.next_id
+
+    def collided(self, tx_id):
+        start, end, _ = next(t for t in self.tx if t[2] == tx_id)
+        return any(o[2] != tx_id and o[0] < end and start < o[1] for o in self.tx)
+
+
+class Node:
+    def __init__(self, adaptive, slot_ms):
+        self.adaptive = adaptive
+        self.slot_ms = slot_ms
+        self.queue = []
+        self.busy_tx = False
+        self.retry = 0
+        self.beb = 0
+        self.cw = MAC_CSMA_CW_MIN
+        self.busy_ratio = 0.0
+
+    def backoff_ms(self):
+        attempt = min(self.beb, MAC_MAX_BEB_RETRY)
+        self.beb += 1
+        window = self.cw if self.adaptive else 1 << attempt
+        return random.randint(0, window) * self.slot_ms
+
+    def sample(self, busy):
+        self.busy_ratio += MAC_CSMA_BUSY_ALPHA * ((1.0 if busy else 0.0) - self.busy_ratio)
+
+    def persist(self):
+        if not self.adaptive:
+            return True
+        p = max(int(100 * (1 - self.busy_ratio)), MAC_CSMA_MIN_PERSISTENCE)
+        return random.randrange(100) < p
+
+
+def simulate(adaptive, sf, nodes, length, rate_per_node_s, seed=1):
+    random.seed(seed)
+    t_sym = (2 ** sf) / BW * 1000
+    t_data = time_on_air_ms(sf, length + MAC_HEADER_SIZE)
+    t_ack = time_on_air_ms(sf, MAC_ACK_SIZE)
+    slot = max(1, int(MAC_CSMA_SLOT_FACTOR * t_ack)) if adaptive else MAC_BEB_SLOT_MS
+    t_cad = 2 * t_sym
+    ack_timeout = MAC_ACK_TIMEOUT_FACTOR * t_ack
+
+    ch = Channel(t_sym)
+    ns = [Node(adaptive, slot) for _ in range(nodes)]
+    events = []
+    seq = 0
+
+    def push(t, kind, n, arg=None):
+        nonlocal seq
+        seq += 1
+        heapq.heappush(events, (t, seq, kind, n, arg))
+
+    for i in range(nodes):
+        push(random.expovariate(rate_per_node_s) * 1000, "arrival", i)
+
+    delivered, dropped, latencies = 0, 0, []
+
+    def access(now, i):
+        node = ns[i]
+        busy = ch.busy(now + t_cad)
+        node.sample(busy)
+        if not busy and node.persist():
+            tx_id = ch.start(now + t_cad, t_data)
+            push(now + t_cad + t_data, "tx_end", i, tx_id)
+        elif not busy:
+            push(now + t_cad + slot, "access", i)
+        else:
+            push(now + t_cad + node.backoff_ms(), "access", i)
+
+    def next_frame(now, i):
+        node = ns[i]
+        if node.queue:
+            node.busy_tx = True
+            node.retry = 0
+            node.beb = 0
+            access(now, i)
+        else:
+            node.busy_tx = False
+
+    while events:
+        now, _, kind, i, arg = heapq.heappop(events)
+        if now > SIM_TIME_MS:
+            break
+        node = ns[i]
+        if kind == "arrival":
+            node.queue.append(now)
+            push(now + random.expovariate(rate_per_node_s) * 1000, "arrival", i)
+            if not node.busy_tx:
+                next_frame(now, i)
+        elif kind == "access":
+            access(now, i)
+        elif kind == "tx_end":
+            node.retry += 1
+            node.beb = 0
+            ok = not ch.collided(arg)
+            if ok:  # El receptor respon immediatament amb ACK
+                ack_id = ch.start(now, t_ack)
+                push(now + t_ack, "ack_end", i, ack_id)
+            else:
+                push(now + ack_timeout, "ack_timeout", i)
+        elif kind == "ack_end":
+            if ch.collided(arg):
+                push(now - t_ack + ack_timeout, "ack_timeout", i)
+                continue
+            node.cw = max(node.cw // 2, MAC_CSMA_CW_MIN)
+            delivered += 1
+            latencies.append(now - node.queue.pop(0))
+            next_frame(now, i)
+        elif kind == "ack_timeout":
+            node.cw = min(node.cw * 2, MAC_CSMA_CW_MAX)
+            if node.retry > MAC_MAX_RETRIES:
+                dropped += 1
+                node.queue.pop(0)
+                next_frame(now, i)
+            else:
+                access(now, i)
+        ch.purge(now)
+
+    offered = sum(len(n.queue) for n in ns) + delivered + dropped
+    return {
+        "throughput": delivered / (SIM_TIME_MS / 1000),
+        "latency": sum(latencies) / len(latencies) if latencies else float("nan"),
+        "pdr": delivered / offered if offered else float("nan"),
+        "slot": slot,
+    }
+
+
+if __name__ == "__main__":
+    sf = int(sys.argv[1]) if len(sys.argv) > 1 else 7
+    nodes = int(sys.argv[2]) if len(sys.argv) > 2 else 5
+    length = int(sys.argv[3]) if len(sys.argv) > 3 else 20
+    t_data = time_on_air_ms(sf, length + MAC_HEADER_SIZE)
+    print(f"SF{sf}, {nodes} nodes, {length} B de dades (airtime: {t_data:.1f} ms, ACK: {time_on_air_ms(sf, MAC_ACK_SIZE):.1f} ms)")
+    print(f"{'Càrrega':>8} | {'BEB tput':>9} {'lat (ms)':>9} {'PDR':>5} | {'Adapt tput':>10} {'lat (ms)':>9} {'PDR':>5}")
+    # Càrrega oferta total, en fracció de la capacitat del canal (1 = canal ocupat tot el temps amb dades)
+    for load in (0.05, 0.1, 0.2, 0.4, 0.6, 0.8, 1.0):
+        rate = load / (t_data / 1000) / nodes
+        beb = simulate(False, sf, nodes, length, rate)
+        ada = simulate(True, sf, nodes, length, rate)
+        print(f"{load:>8.2f} | {beb['throughput']:>9.2f} {beb['latency']:>9.0f} {beb['pdr']:>5.2f} | "
+              f"{ada['throughput']:>10.2f} {ada['latency']:>9.0f} {ada['pdr']:>5.2f}")
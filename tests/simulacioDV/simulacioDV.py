@@ -0,0 +1,240 @@
+"""
+Simulació de l'aprenentatge de rutes per vector de distàncies (ROUTING_DV) en una línia de N nodes amb enllaços de
+salt (N -> N+2): temps de convergència en arrencar, temps de recuperació quan cau un relé, i canvis de ruta en règim
+estable amb i sense histèresi. També, quan cauen dos relés seguits i la línia queda partida, el temps fins que cap node
+manté rutes cap als destins inaccessibles, amb el límit de cost (ROUTING_DV_MAX_ETX) i amb el retall anterior a 254,
+que no arribava mai a infinit i deixava bucles de 3 o més nodes anunciant-se entre ells indefinidament.
+
+Model:
+- Nodes en línia, separats un salt. Cada anunci arriba a un veí a distància 1 amb probabilitat P1, a distància 2
+  (enllaç de salt, a més potència) amb P2, i a més distància mai. Sense col·lisions (els anuncis són curts i amb
+  retard aleatori). Sense trànsit de dades: df = dr, com al firmware fins que hi ha prou intents de dades.
+- Cada node anuncia cada ROUTING_DV_INTERVAL_MS més fins a un 25% aleatori; el primer, entre 0 i el 25% de l'interval.
+- La lògica de cada node és la de routing_dv.cpp: ETX en 1/8, dr amb mitjana exponencial (1/8) a partir de 1/2,
+  split horizon, histèresi, caducitat i anunci de les rutes caducades com a inaccessibles.
+- Convergit: tots els parells de nodes vius tenen una ruta que, seguint els següents salts, arriba al destí sense bucles.
+- A T_FALLADA cau el node del mig. La recuperació es compta fins que tornen a convergir tots els parells de nodes vius.
+- Partició: a T_FALLADA cauen els dos nodes del mig, i cap enllaç (de fins a 2 salts) uneix les dues meitats. Es compta
+  el temps fins que cap node viu té una ruta vigent (no caducada) cap a un node caigut o de l'altra meitat, i els
+  parells amb bucle de rutes que queden al final de la simulació.
+
+Ús: python3 simulacioDV.py [llavors]
+"""
+import heapq
+import random
+import sys
+
+# Valors de config.h i routing_dv.cpp
+ROUTING_DV_INTERVAL_MS = 60000
+ROUTING_DV_ROUTE_TIMEOUT_MS = 4 * ROUTING_DV_INTERVAL_MS
+ROUTING_DV_HYSTERESIS = 8
+ROUTING_DV_HYSTERESIS_PERCENT = 25
+ROUTING_DV_MAX_ETX = 31
+METRIC_UNIT = 8
+METRIC_INF = 0xFF
+METRIC_MAX = ROUTING_DV_MAX_ETX * METRIC_UNIT - 1
+LEGACY_MAX = METRIC_INF - 1     # Retall anterior: el cost no arribava mai a infinit
+INITIAL_DELIVERY = 128
+
+P1 = 0.9    # Entrega a un salt
+P2 = 0.6    # Entrega a dos salts (enllaç de salt). ETX similar al de dos salts curts: cas desfavorable per oscil·lacions
+T_FALLADA = 60 * 60 * 1000
+T_FINAL = 3 * 60 * 60 * 1000
+
+
+class Node:
+    def __init__(self, addr, rng, legacy=False):
+        self.addr = addr
+        self.legacy = legacy
+        self.seq = rng.randrange(256)
+        self.neighbors = {}     # addr -> [lastSeq, delivery]
+        self.routes = {}        # dst -> [nextHop, metric, updatedAt]
+        self.changes = 0
+
+    def link_metric(self, nb):
+        dr = self.neighbors[nb][1]
+        if dr == 0:
+            return METRIC_INF
+        etx = METRIC_UNIT * 256 * 256 // (dr * dr)
+        if self.legacy:
+            return min(etx, LEGACY_MAX)
+        return METRIC_INF if etx > METRIC_MAX else etx
+
+    def add_metric(self, metric, link):
+        if self.legacy:
+            return min(metric + link, LEGACY_MAX)
+        return METRIC_INF if metric > METRIC_MAX or metric + link > METRIC_MAX else metric + link
+
+    def expired(self, route, now):
+        return route[1] == METRIC_INF or now - route[2] > ROUTING_DV_ROUTE_TIMEOUT_MS
+
+    def build_advert(self, now):
+        self.seq = (self.seq + 1) % 256
+        return self.seq, [(dst, r[0], METRIC_INF if self.expired(r, now) else r[1]) for dst, r in self.routes.items()]
+
+    def process(self, prev, seq, entries, now, hysteresis, percent):
+        if prev in self.neighbors:
+            nb = self.neighbors[prev]
+            missed = min((seq - nb[0] - 1) % 256, 8)
+            for _ in range(missed):
+                nb[1] -= nb[1] // 8
+            nb[1] += (256 - nb[1]) // 8
+            nb[0] = seq
+        else:
+            self.neighbors[prev] = [seq, INITIAL_DELIVERY]
+        link = self.link_metric(prev)
+        self.consider(prev, prev, link, now, hysteresis, percent)
+        for dst, hop, metric in entries:
+            if dst in (self.addr, prev):
+                continue
+            unreachable = hop == self.addr or metric == METRIC_INF or link == METRIC_INF
+            self.consider(dst, prev, METRIC_INF if unreachable else self.add_metric(metric, link), now, hysteresis, percent)
+
+    def consider(self, dst, via, cost, now, hysteresis, percent):
+        route = self.routes.get(dst)
+        if route is None:
+            if cost != METRIC_INF:
+                self.routes[dst] = [via, cost, now]
+                self.changes += 1
+            return
+        if route[0] == via:
+            route[1] = cost
+            if cost != METRIC_INF:
+                route[2] = now
+            return
+        if cost == METRIC_INF:
+            return
+        if not self.expired(route, now) and cost + max(hysteresis, route[1] * percent // 100) > route[1]:
+            return
+        self.routes[dst] = [via, cost, now]
+        self.changes += 1
+
+
+def components(n, alive):
+    """Component (mínima adreça) de cada node viu, amb enllaços de fins a 2 salts entre nodes vius"""
+    comp = {}
+    for a in sorted(alive):
+        comp[a] = next((comp[b] for b in (a - 1, a - 2) if b in comp), a)
+    return comp
+
+
+def converged(nodes, alive, comp):
+    for src in alive:
+        for dst in alive:
+            if src == dst or comp[src] != comp[dst]:
+                continue
+            current, visited = src, set()
+            while current != dst:
+                if current in visited or current not in alive:
+                    return False
+                visited.add(current)
+                route = nodes[current].routes.get(dst)
+                if route is None:
+                    return False
+                current = route[0]
+    return True
+
+
+def stale_routes(nodes, alive, comp, now):
+    """Parells (node viu, destí inaccessible) amb ruta vigent, i quants d'ells segueixen un bucle de rutes"""
+    stale = loops = 0
+    for src in alive:
+        for dst in range(len(nodes)):
+            if dst == src or comp.get(dst) == comp[src]:
+                continue
+            route = nodes[src].routes.get(dst)
+            if route is None or nodes[src].expired(route, now):
+                continue
+            stale += 1
+            current, visited = src, set()
+            while current in alive and current not in visited:
+                visited.add(current)
+                route = nodes[current].routes.get(dst)
+                if route is None or nodes[current].expired(route, now):
+                    break
+                current = route[0]
+            else:
+                loops += current in visited
+    return stale, loops
+
+
+def simulate(n, hysteresis, percent, seed, failed=None, legacy=False):
+    rng = random.Random(seed)
+    nodes = [Node(a, rng, legacy) for a in range(n)]
+    alive = set(range(n))
+    comp = components(n, alive)
+    failed = failed if failed is not None else {n // 2}
+    events = [(rng.uniform(0, ROUTING_DV_INTERVAL_MS / 4), a) for a in range(n)]
+    heapq.heapify(events)
+
+    convergence = recovery = cleared = None
+    changes_stable = 0
+    failure_done = False
+    while events:
+        now, a = heapq.heappop(events)
+        if now > T_FINAL:
+            break
+        if not failure_done and now >= T_FALLADA:
+            failure_done = True
+            alive -= failed
+            comp = components(n, alive)
+        if a not in alive:
+            continue
+        seq, entries = nodes[a].build_advert(now)
+        for b in alive:
+            p = {1: P1, 2: P2}.get(abs(a - b), 0)
+            if b != a and rng.random() < p:
+                nodes[b].process(a, seq, entries, now, hysteresis, percent)
+        heapq.heappush(events, (now + ROUTING_DV_INTERVAL_MS + rng.uniform(0, ROUTING_DV_INTERVAL_MS / 4), a))
+
+        if convergence is None and converged(nodes, alive, comp):
+            convergence = now
+            changes_at_convergence = sum(nd.changes for nd in nodes)
+        if failure_done and recovery is None and converged(nodes, alive, comp):
+            recovery = now - T_FALLADA
+        if failure_done and cleared is None and stale_routes(nodes, alive, comp, now)[0] == 0:
+            cleared = now - T_FALLADA
+        if convergence is not None and not failure_done:
+            changes_stable = sum(nd.changes for nd in nodes) - changes_at_convergence
+
+    # Canvis de ruta per node i hora en règim estable (entre la convergència i la fallada)
+    stable_hours = (T_FALLADA - convergence) / 3600000 if convergence is not None else 0
+    flaps = changes_stable / n / stable_hours if stable_hours > 0 else float('nan')
+    loops = stale_routes(nodes, alive, comp, T_FINAL)[1]
+    return convergence, recovery, flaps, cleared, loops
+
+
+def fmt(v):
+    return f"{sum(v) / len(v):5.1f} / {max(v):5.1f}" if v else "     -"
+
+
+if __name__ == '__main__':
+    seeds = int(sys.argv[1]) if len(sys.argv) > 1 else 20
+
+    print(f"Línia de N nodes, P1={P1}, P2={P2}, anuncis cada {ROUTING_DV_INTERVAL_MS / 1000:.0f} s, "
+          f"caducitat {ROUTING_DV_ROUTE_TIMEOUT_MS / 1000:.0f} s, {seeds} llavors. Temps en minuts (mitjana / màxim)")
+    print(f"{'N':>3} {'Histèresi':>12} | {'Convergència':>14} | {'Recuperació':>14} | {'Canvis/node/h':>13}")
+    for n in (5, 10, 20):
+        for hysteresis, percent in ((0, 0), (ROUTING_DV_HYSTERESIS, ROUTING_DV_HYSTERESIS_PERCENT)):
+            results = [simulate(n, hysteresis, percent, seed) for seed in range(seeds)]
+            conv = [r[0] / 60000 for r in results if r[0] is not None]
+            rec = [r[1] / 60000 for r in results if r[1] is not None]
+            flaps = [r[2] for r in results if r[2] == r[2]]
+            missing = seeds - len(rec)
+            label = f"{hysteresis / METRIC_UNIT:.0f} ETX, {percent}%" if hysteresis else "no"
+            print(f"{n:>3} {label:>12} | {fmt(conv):>14} | {fmt(rec):>14}"
+                  f"{'' if missing == 0 else f' ({missing} sense)'} | {sum(flaps) / len(flaps) if flaps else float('nan'):>13.2f}")
+
+    print()
+    print(f"Partició: cauen els 2 nodes del mig. Temps fins que cap node té rutes vigents cap a destins inaccessibles, "
+          f"i parells en bucle al final ({(T_FINAL - T_FALLADA) / 60000:.0f} min després)")
+    print(f"{'N':>3} {'Límit de cost':>16} | {'Sense rutes':>14} | {'Bucles al final':>15}")
+    for n in (10, 20):
+        for legacy in (True, False):
+            results = [simulate(n, ROUTING_DV_HYSTERESIS, ROUTING_DV_HYSTERESIS_PERCENT, seed, {n // 2, n // 2 + 1}, legacy)
+                       for seed in range(seeds)]
+            cleared = [r[3] / 60000 for r in results if r[3] is not None]
+            missing = seeds - len(cleared)
+            loops = sum(r[4] for r in results) / seeds
+            label = "retall a 254" if legacy else f"{ROUTING_DV_MAX_ETX} ETX"
+            print(f"{n:>3} {label:>16} | {fmt(cleared):>14}{'' if missing == 0 else f' ({missing} mai)'} | {loops:>15.1f}")
@@ -0,0 +1,124 @@
+"""
+Simulació de la codificació de xarxa (XOR) al node intermedi d'una cadena A - R - B amb trànsit bidireccional
+(ROUTING_NETWORK_CODING): throughput extrem a extrem amb i sense codificació, amb pèrdues creixents.
+
+Model:
+- A i B no s'escolten entre ells; R és l'únic camí. Tots tres comparteixen el canal (el de R), sense col·lisions:
+  l'accés és per torns entre els nodes que tenen alguna cosa a enviar (CSMA ideal), amb un CAD abans de cada accés.
+- A i B sempre tenen dades (saturats). R té una cua limitada (ROUTING_NC_QUEUE_SIZE + cua de TX de MAC); si és plena,
+  el paquet que arriba es descarta.
+- Cada frame es perd amb probabilitat p, independentment a cada receptor. Els ACK no es perden.
+- Unicast: ACK i fins a MAC_MAX_RETRIES reintents. Codificat: un únic broadcast, sense ACK ni reintents;
+  cada extrem el descodifica si el rep (el paquet propi sempre està retingut).
+- Sense codificació, R envia per ordre d'arribada. Amb codificació, si té paquets en tots dos sentits, envia el
+  més antic de cada sentit en un únic paquet codificat.
+
+Com que l'accés al canal és equitatiu entre nodes, sense codificació R (que ha de reenviar el trànsit de tots dos
+extrems) és el coll d'ampolla i descarta paquets; el guany pot superar el 4/3 de transmissions estalviades.
+
+Ús: python3 simulacioNC.py [SF] [mida dades]
+"""
+import math
+import random
+import sys
+from collections import deque
+
+# Valors de config.h
+MAC_MAX_RETRIES = 3
+MAC_ACK_TIMEOUT_FACTOR = 3
+MAC_ACK_IFS_MS = 5
+MAC_HEADER_SIZE = 7
+MAC_ACK_SIZE = 7
+MAC_TX_QUEUE_SIZE = 4
+ROUTING_HEADER_SIZE = 5
+ROUTING_NC_QUEUE_SIZE = 4
+ROUTING_NC_CODED_HEADER_SIZE = 10
+ROUTING_NC_CANONICAL_HEADER_SIZE = 5
+
+BW = 125e3
+CR = 1  # 4/5
+PREAMBLE = 8
+SIM_TIME_MS = 15*60*1000
+
+
+def time_on_air_ms(sf, length):
+    # Semtech AN1200.13, header explícit i CRC
+    t_sym = (2 ** sf) / BW * 1000
+    de = 1 if sf >= 11 else 0
+    payload_symb = 8 + max(math.ceil((8 * length - 4 * sf + 28 + 16) / (4 * (sf - 2 * de))) * (CR + 4), 0)
+    return (PREAMBLE + 4.25) * t_sym + payload_symb * t_sym
+
+
+def unicast(sf, length, p, rng):
+    """Envia un frame amb ACK i reintents. Retorna (temps ocupat, entregat)."""
+    t_data = time_on_air_ms(sf, MAC_HEADER_SIZE + length)
+    t_ack = time_on_air_ms(sf, MAC_ACK_SIZE)
+    elapsed = 0
+    for _ in range(MAC_MAX_RETRIES + 1):
+        if rng.random() >= p:
+            return elapsed + t_data + MAC_ACK_IFS_MS + t_ack, True
+        elapsed += t_data + MAC_ACK_IFS_MS + MAC_ACK_TIMEOUT_FACTOR * t_ack
+    return elapsed, False
+
+
+def simulate(sf, length, p, coding, seed=1):
+    rng = random.Random(seed)
+    t_cad = 2 * (2 ** sf) / BW * 1000
+    native = ROUTING_HEADER_SIZE + length
+    coded = ROUTING_HEADER_SIZE + ROUTING_NC_CODED_HEADER_SIZE + ROUTING_NC_CANONICAL_HEADER_SIZE + length
+    capacity = ROUTING_NC_QUEUE_SIZE + MAC_TX_QUEUE_SIZE
+
+    relay = deque()  # sentits dels paquets a reenviar ('AB' o 'BA'), per ordre d'arribada
+    delivered = {'AB': 0, 'BA': 0}
+    stats = {'tx': 0, 'coded': 0, 'relayDrops': 0}
+    now = 0
+    turn = 0
+    while now < SIM_TIME_MS:
+        # Torn rotatiu entre A, R i B; R només si té paquets
+        node = ['A', 'R', 'B'][turn % 3]
+        turn += 1
+        if node == 'R' and not relay:
+            continue
+        now += t_cad
+        stats['tx'] += 1
+
+        if node in ('A', 'B'):
+            busy, ok = unicast(sf, native, p, rng)
+            now += busy
+            if ok:
+                if len(relay) < capacity:
+                    relay.append('AB' if node == 'A' else 'BA')
+                else:
+                    stats['relayDrops'] += 1
+            continue
+
+        if coding and 'AB' in relay and 'BA' in relay:
+            relay.remove('AB')
+            relay.remove('BA')
+            now += time_on_air_ms(sf, MAC_HEADER_SIZE + coded)
+            stats['coded'] += 1
+            for direction in ('AB', 'BA'):
+                if rng.random() >= p:
+                    delivered[direction] += 1
+            continue
+
+        direction = relay.popleft()
+        busy, ok = unicast(sf, native, p, rng)
+        now += busy
+        if ok:
+            delivered[direction] += 1
+
+    seconds = now / 1000
+    return (delivered['AB'] + delivered['BA']) / seconds, stats
+
+
+if __name__ == '__main__':
+    sf = int(sys.argv[1]) if len(sys.argv) > 1 else 7
+    length = int(sys.argv[2]) if len(sys.argv) > 2 else 20
+
+    print(f"SF{sf}, cadena A - R - B, {length} B de dades (airtime: {time_on_air_ms(sf, MAC_HEADER_SIZE + ROUTING_HEADER_SIZE + length):.1f} ms)")
+    print(f"{'Pèrdues':>8} | {'Sense (pkt/s)':>13} | {'Amb (pkt/s)':>11} {'Codificats':>10} | {'Guany':>6}")
+    for p in (0.0, 0.05, 0.1, 0.2, 0.3):
+        plain, _ = simulate(sf, length, p, coding=False)
+        withNC, stats = simulate(sf, length, p, coding=True)
+        print(f"{p:>8.2f} | {plain:>13.2f} | {withNC:>11.2f} {stats['coded']:>10} | {withNC / plain:>5.2f}x")